@@ -7,7 +7,251 @@
 #include <memory>
 #include <ctime>
 #include <map>
+#include <set>
 #include <sstream>
+#include <unordered_map>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string_view>
+#include <type_traits>
+#include <queue>
+#include <tuple>
+#include <cmath>
+#include <sys/resource.h>
+#include <atomic>
+#include <array>
+#include <shared_mutex>
+#include <deque>
+#include <numeric>
+#include <csignal>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <new>
+#include <charconv>
+#include <limits>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/futex.h>
+
+// Heap allocations made by this thread, for the memory benchmarks. Per thread so that
+// counting costs the terminal threads nothing shared. Counting replaces the global
+// operator new, so it is only built in with -DRMS_COUNT_ALLOCATIONS.
+thread_local uint64_t heapAllocations = 0;
+
+#ifdef RMS_COUNT_ALLOCATIONS
+// Out of line so the compiler does not pair an inlined free() with the new-expression
+__attribute__((noinline)) void* operator new(size_t size) {
+    heapAllocations++;
+    if (void* block = std::malloc(size ? size : 1)) return block;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* block) noexcept { std::free(block); }
+__attribute__((noinline)) void operator delete(void* block, size_t) noexcept { std::free(block); }
+#endif
+
+// Timed operations, for the metrics export
+enum class Operation : uint8_t {
+    PlaceOrder,
+    SetStatus,
+    Reserve,
+    SeatTable,
+    DailyReport,
+    MenuScreen,
+    OrdersScreen,
+    AvailabilityScreen,
+    SalesQuery,
+};
+
+const size_t kOperationCount = 9;
+
+inline const char* operationName(Operation operation) {
+    static const char* names[kOperationCount] = {"place_order", "set_status", "reserve", "seat_table",
+                                                 "daily_report", "menu_screen", "orders_screen",
+                                                 "availability_screen", "sales_query"};
+    return names[static_cast<size_t>(operation)];
+}
+
+#ifndef RMS_NO_METRICS
+// Latency histogram of nanosecond durations in the style of HdrHistogram: each power of
+// two is split into 16 linear sub-buckets, so a value is recorded to within 1/16 of
+// itself in a few kilobytes. Only its thread records into it; any thread may read it.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40; // 2^40 ns is about 18 minutes; longer goes in the last bucket
+    static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets + 1;
+
+    static int bucketOf(uint64_t nanos) {
+        if (nanos < uint64_t(kSubBuckets)) return static_cast<int>(nanos);
+        int exponent = std::min(63 - __builtin_clzll(nanos), kMaxExponent);
+        if (exponent == kMaxExponent) return kBucketCount - 1;
+        int sub = static_cast<int>((nanos >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+    }
+
+    // Smallest duration too long for the bucket
+    static uint64_t bucketLimit(int bucket) {
+        if (bucket == kBucketCount - 1) return UINT64_MAX;
+        if (bucket < kSubBuckets) return bucket + 1;
+        int exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+        uint64_t sub = bucket % kSubBuckets;
+        return (kSubBuckets + sub + 1) << (exponent - kSubBucketBits);
+    }
+
+    void record(uint64_t nanos) {
+        // One writer, so plain load-and-store increments are enough
+        auto& count = counts[bucketOf(nanos)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        totalNanos.store(totalNanos.load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+    }
+
+    uint64_t count(int bucket) const { return counts[bucket].load(std::memory_order_relaxed); }
+    uint64_t sum() const { return totalNanos.load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> counts{};
+    std::atomic<uint64_t> totalNanos{0};
+};
+
+// One thread's histograms and failure counts. Threads register theirs on first use; the
+// registry keeps them after the thread exits so nothing recorded is lost.
+struct ThreadMetrics {
+    std::array<LatencyHistogram, kOperationCount> latency;
+    std::array<std::atomic<uint64_t>, kOperationCount> failures{};
+};
+
+class MetricsRegistry {
+private:
+    static std::mutex& lock() {
+        static std::mutex registryLock;
+        return registryLock;
+    }
+
+    static std::vector<std::shared_ptr<ThreadMetrics>>& threads() {
+        static std::vector<std::shared_ptr<ThreadMetrics>> registered;
+        return registered;
+    }
+
+public:
+    // Off until an export is configured; timers check it before reading the clock
+    static std::atomic<bool>& enabled() {
+        static std::atomic<bool> on{false};
+        return on;
+    }
+
+    static ThreadMetrics& local() {
+        thread_local std::shared_ptr<ThreadMetrics> mine = [] {
+            auto metrics = std::make_shared<ThreadMetrics>();
+            std::lock_guard<std::mutex> guard(lock());
+            threads().push_back(metrics);
+            return metrics;
+        }();
+        return *mine;
+    }
+
+    static std::vector<std::shared_ptr<ThreadMetrics>> all() {
+        std::lock_guard<std::mutex> guard(lock());
+        return threads();
+    }
+};
+
+// Times one operation into this thread's histogram. Call failed() on the way out of an
+// operation that did not succeed.
+class OperationTimer {
+private:
+    Operation operation;
+    bool active;
+    bool failure = false;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit OperationTimer(Operation op)
+        : operation(op), active(MetricsRegistry::enabled().load(std::memory_order_relaxed)) {
+        if (active) start = std::chrono::steady_clock::now();
+    }
+
+    ~OperationTimer() {
+        if (!active) return;
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        ThreadMetrics& metrics = MetricsRegistry::local();
+        size_t index = static_cast<size_t>(operation);
+        metrics.latency[index].record(static_cast<uint64_t>(nanos));
+        if (failure) {
+            auto& failures = metrics.failures[index];
+            failures.store(failures.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+
+    void failed() { failure = true; }
+};
+#else
+class OperationTimer {
+public:
+    explicit OperationTimer(Operation) {}
+    void failed() {}
+};
+#endif
+
+// Money is kept in whole cents and only turned into dollars for display
+int64_t toCents(double amount) {
+    return std::llround(amount * 100);
+}
+
+// 12.50, or -3.05 for a negative amount
+std::string formatMoney(int64_t cents) {
+    char text[32];
+    uint64_t magnitude = cents < 0 ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+    std::snprintf(text, sizeof(text), "%s%llu.%02llu", cents < 0 ? "-" : "",
+                  static_cast<unsigned long long>(magnitude / 100), static_cast<unsigned long long>(magnitude % 100));
+    return text;
+}
+
+// Cents for a non-negative amount such as 12, 12.5 or 12.50, read digit by digit so
+// no rounding is involved; false for anything else, or more than two decimals
+bool parseCents(std::string_view text, int64_t& cents) {
+    size_t dot = text.find('.');
+    std::string_view whole = text.substr(0, dot);
+    std::string_view fraction = dot == std::string_view::npos ? std::string_view() : text.substr(dot + 1);
+    if (whole.empty() || whole.size() > 12 || fraction.size() > 2 || (dot != std::string_view::npos && fraction.empty())) {
+        return false;
+    }
+    int64_t value = 0;
+    for (char c : whole) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        value = value * 10 + (c - '0');
+    }
+    for (size_t i = 0; i < 2; i++) {
+        char c = i < fraction.size() ? fraction[i] : '0';
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        value = value * 10 + (c - '0');
+    }
+    cents = value;
+    return true;
+}
 
 class MenuItem {
 private:
@@ -45,36 +289,537 @@ public:
         price = newPrice;
     }
 
-    void displayInfo() const {
-        std::cout << "\n=== " << name << " ===" << std::endl;
-        std::cout << "ID: " << itemId << " | Category: " << category << std::endl;
-        std::cout << "Description: " << description << std::endl;
-        std::cout << "Price: $" << std::fixed << std::setprecision(2) << price << std::endl;
-        std::cout << "Preparation Time: " << preparationTime << " minutes" << std::endl;
-        std::cout << "Status: " << (isAvailable ? "Available" : "Unavailable") << std::endl;
-        std::cout << "Spice Level: " << spiceLevel << "/5" << std::endl;
-        if (calories > 0) std::cout << "Calories: " << calories << std::endl;
+    void displayInfo(std::ostream& out = std::cout) const {
+        out << "\n=== " << name << " ===\n";
+        out << "ID: " << itemId << " | Category: " << category << '\n';
+        out << "Description: " << description << '\n';
+        out << "Price: $" << std::fixed << std::setprecision(2) << price << '\n';
+        out << "Preparation Time: " << preparationTime << " minutes\n";
+        out << "Status: " << (isAvailable ? "Available" : "Unavailable") << '\n';
+        out << "Spice Level: " << spiceLevel << "/5\n";
+        if (calories > 0) out << "Calories: " << calories << '\n';
         
         if (!ingredients.empty()) {
-            std::cout << "Ingredients: ";
-            for (const auto& ing : ingredients) std::cout << ing << ", ";
-            std::cout << std::endl;
+            out << "Ingredients: ";
+            for (const auto& ing : ingredients) out << ing << ", ";
+            out << '\n';
         }
         
         if (!allergens.empty()) {
-            std::cout << "Allergens: ";
-            for (const auto& alg : allergens) std::cout << alg << ", ";
-            std::cout << std::endl;
+            out << "Allergens: ";
+            for (const auto& alg : allergens) out << alg << ", ";
+            out << '\n';
         }
     }
 
-    std::string getItemId() const { return itemId; }
-    std::string getName() const { return name; }
-    std::string getCategory() const { return category; }
+    const std::string& getItemId() const { return itemId; }
+    const std::string& getName() const { return name; }
+    const std::string& getCategory() const { return category; }
+    const std::string& getDescription() const { return description; }
     double getPrice() const { return price; }
     int getPreparationTime() const { return preparationTime; }
     bool getAvailability() const { return isAvailable; }
+    int getSpiceLevel() const { return spiceLevel; }
     int getCalories() const { return calories; }
+    const std::vector<std::string>& getIngredients() const { return ingredients; }
+    const std::vector<std::string>& getAllergens() const { return allergens; }
+};
+
+// Interned strings: each distinct string is stored once and named by a dense 32-bit
+// symbol, so equal strings compare as integers and names come back as views. Interned
+// strings never move. Interning is setup-time only; lookups may run concurrently.
+class SymbolTable {
+private:
+    std::deque<std::string> strings; // by symbol; a deque so the views below stay valid
+    std::unordered_map<std::string_view, uint32_t> symbols;
+
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    SymbolTable() = default;
+
+    // The index holds views into `strings`, so a copy rebuilds it over its own strings
+    SymbolTable(const SymbolTable& other) : strings(other.strings) {
+        for (uint32_t symbol = 0; symbol < strings.size(); symbol++) symbols.emplace(strings[symbol], symbol);
+    }
+
+    SymbolTable& operator=(const SymbolTable& other) {
+        if (this != &other) {
+            SymbolTable copy(other);
+            std::swap(strings, copy.strings);
+            std::swap(symbols, copy.symbols);
+        }
+        return *this;
+    }
+
+    SymbolTable(SymbolTable&&) = default;
+    SymbolTable& operator=(SymbolTable&&) = default;
+
+    uint32_t intern(std::string_view text) {
+        auto it = symbols.find(text);
+        if (it != symbols.end()) return it->second;
+        strings.emplace_back(text);
+        uint32_t symbol = static_cast<uint32_t>(strings.size() - 1);
+        symbols.emplace(strings.back(), symbol);
+        return symbol;
+    }
+
+    // kNone if the text was never interned
+    uint32_t find(std::string_view text) const {
+        auto it = symbols.find(text);
+        return it != symbols.end() ? it->second : kNone;
+    }
+
+    std::string_view name(uint32_t symbol) const { return strings[symbol]; }
+    size_t size() const { return strings.size(); }
+
+    void clear() {
+        symbols.clear();
+        strings.clear();
+    }
+};
+
+// A compound menu query: the items that pass every condition given
+struct MenuQuery {
+    std::vector<std::string> withoutAllergens;
+    std::vector<std::string> withoutIngredients;
+    std::string category; // empty for every category
+    int maxCalories = -1; // -1 for no limit; items with unknown (0) calories fail any limit
+    int maxSpice = -1;    // -1 for no limit
+    int64_t maxCents = -1; // -1 for no limit
+    bool includeUnavailable = false;
+};
+
+// The menu stored column by column, indexed by menu position. The numeric fields that
+// scans and filters read sit in their own contiguous arrays; the strings are symbols in
+// one table and are returned as views. Changed at setup time, or copied, changed and
+// swapped in whole by a menu import.
+class MenuCatalog {
+public:
+    static constexpr uint32_t kNone = SymbolTable::kNone;
+
+    // The symbols of one item's ingredients or allergens
+    struct SymbolRange {
+        const uint32_t* first;
+        const uint32_t* last;
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+private:
+    SymbolTable symbols;
+
+    // Hot columns
+    std::vector<int64_t> prices; // cents
+    std::vector<int32_t> prepMinutes;
+    std::vector<int32_t> calorieCounts;
+    std::vector<uint8_t> spiceLevels;
+    std::vector<uint8_t> availability;
+    std::vector<uint32_t> categories;
+
+    // Cold columns
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> names;
+    std::vector<uint32_t> descriptions;
+    std::vector<uint32_t> firstIngredient, ingredientCounts;
+    std::vector<uint32_t> firstAllergen, allergenCounts;
+    std::vector<uint32_t> symbolLists; // ingredient and allergen symbols, ranges per item
+
+    std::vector<uint32_t> itemBySymbol; // menu position by ID symbol, kNone for other symbols
+
+    // Bitmaps over menu positions (item i is bit i % 64 of word i / 64): one per allergen,
+    // ingredient and category, one per spice level 0-5 and one of the available items.
+    // A query is a few ANDs over these, 64 items per operation. Bitmaps grow on demand;
+    // missing trailing words are zero.
+    using Bitmap = std::vector<uint64_t>;
+    std::vector<Bitmap> bitmaps;
+    std::vector<uint32_t> allergenBitmap, ingredientBitmap, categoryBitmap; // bitmap by symbol, or kNone
+    Bitmap availableItems;
+    std::array<Bitmap, 6> spiceItems;
+
+    // Every position, ordered by category name and then menu position: the order the
+    // menu screen and query results are listed in. Kept up to date by add().
+    std::vector<uint32_t> ranked;
+
+    uint64_t changes = 0; // bumped by every change, so renderings can tell they are stale
+
+    SymbolRange range(uint32_t first, uint32_t count) const {
+        const uint32_t* start = symbolLists.data() + first;
+        return {start, start + count};
+    }
+
+    static void setBit(Bitmap& bits, uint32_t index, bool value) {
+        if (bits.size() <= index / 64) bits.resize(index / 64 + 1, 0);
+        uint64_t bit = uint64_t(1) << (index % 64);
+        if (value) bits[index / 64] |= bit;
+        else bits[index / 64] &= ~bit;
+    }
+
+    Bitmap& bitmapFor(std::vector<uint32_t>& bySymbol, uint32_t symbol) {
+        if (bySymbol.size() <= symbol) bySymbol.resize(symbol + 1, kNone);
+        if (bySymbol[symbol] == kNone) {
+            bySymbol[symbol] = static_cast<uint32_t>(bitmaps.size());
+            bitmaps.emplace_back();
+        }
+        return bitmaps[bySymbol[symbol]];
+    }
+
+    // Null if no item has ever had the named allergen/ingredient/category
+    const Bitmap* findBitmap(const std::vector<uint32_t>& bySymbol, std::string_view name) const {
+        uint32_t symbol = symbols.find(name);
+        return symbol < bySymbol.size() && bySymbol[symbol] != kNone ? &bitmaps[bySymbol[symbol]] : nullptr;
+    }
+
+    // Sets or clears the item's bit in every bitmap that describes it
+    void markItem(uint32_t index, bool value) {
+        setBit(bitmapFor(categoryBitmap, categories[index]), index, value);
+        for (uint32_t symbol : ingredients(index)) setBit(bitmapFor(ingredientBitmap, symbol), index, value);
+        for (uint32_t symbol : allergens(index)) setBit(bitmapFor(allergenBitmap, symbol), index, value);
+        setBit(availableItems, index, value && availability[index]);
+        if (spiceLevels[index] < spiceItems.size()) setBit(spiceItems[spiceLevels[index]], index, value);
+    }
+
+    bool rankedBefore(uint32_t a, uint32_t b) const {
+        if (categories[a] != categories[b]) return category(a) < category(b);
+        return a < b;
+    }
+
+    // Writes the item's columns and bitmaps, leaving `ranked` to the caller. replaced
+    // says whether the ID was already on the menu.
+    uint32_t store(const MenuItem& item, bool& replaced) {
+        uint32_t id = symbols.intern(item.getItemId());
+        if (itemBySymbol.size() <= id) itemBySymbol.resize(id + 1, kNone);
+        uint32_t index = itemBySymbol[id];
+        replaced = index != kNone;
+        if (index == kNone) {
+            index = itemBySymbol[id] = static_cast<uint32_t>(ids.size());
+            for (auto* column : {&categories, &ids, &names, &descriptions, &firstIngredient, &ingredientCounts,
+                                 &firstAllergen, &allergenCounts}) {
+                column->push_back(0);
+            }
+            prices.push_back(0);
+            prepMinutes.push_back(0);
+            calorieCounts.push_back(0);
+            spiceLevels.push_back(0);
+            availability.push_back(0);
+        } else {
+            markItem(index, false);
+        }
+
+        prices[index] = toCents(item.getPrice());
+        prepMinutes[index] = item.getPreparationTime();
+        calorieCounts[index] = item.getCalories();
+        spiceLevels[index] = static_cast<uint8_t>(item.getSpiceLevel());
+        availability[index] = item.getAvailability();
+        categories[index] = symbols.intern(item.getCategory());
+        ids[index] = id;
+        names[index] = symbols.intern(item.getName());
+        descriptions[index] = symbols.intern(item.getDescription());
+        // A replaced item's old lists stay behind unused; replacing is rare
+        firstIngredient[index] = static_cast<uint32_t>(symbolLists.size());
+        ingredientCounts[index] = static_cast<uint32_t>(item.getIngredients().size());
+        for (const auto& ingredient : item.getIngredients()) symbolLists.push_back(symbols.intern(ingredient));
+        firstAllergen[index] = static_cast<uint32_t>(symbolLists.size());
+        allergenCounts[index] = static_cast<uint32_t>(item.getAllergens().size());
+        for (const auto& allergen : item.getAllergens()) symbolLists.push_back(symbols.intern(allergen));
+        if (itemBySymbol.size() < symbols.size()) itemBySymbol.resize(symbols.size(), kNone);
+        markItem(index, true);
+        changes++;
+        return index;
+    }
+
+public:
+    // Appends the item, or overwrites the one with the same ID in place. Returns its
+    // position, which never changes once assigned.
+    uint32_t add(const MenuItem& item) {
+        bool replaced = false;
+        uint32_t index = store(item, replaced);
+        if (replaced) ranked.erase(std::find(ranked.begin(), ranked.end(), index)); // its category may change
+        ranked.insert(std::upper_bound(ranked.begin(), ranked.end(), index,
+                                       [this](uint32_t a, uint32_t b) { return rankedBefore(a, b); }),
+                      index);
+        return index;
+    }
+
+    // add() for many items, ranking them once at the end instead of one insert each.
+    // Returns each item's position; replaced counts the IDs that were already on the menu.
+    std::vector<uint32_t> addAll(const std::vector<MenuItem>& items, size_t& replaced) {
+        std::vector<uint32_t> positions;
+        positions.reserve(items.size());
+        replaced = 0;
+        for (const auto& item : items) {
+            bool existed = false;
+            positions.push_back(store(item, existed));
+            replaced += existed;
+        }
+        ranked.resize(ids.size());
+        std::iota(ranked.begin(), ranked.end(), 0);
+        std::sort(ranked.begin(), ranked.end(), [this](uint32_t a, uint32_t b) { return rankedBefore(a, b); });
+        return positions;
+    }
+
+    void updatePrice(uint32_t index, int64_t cents) {
+        prices[index] = cents;
+        changes++;
+    }
+
+    void updateAvailability(uint32_t index, bool available) {
+        availability[index] = available;
+        setBit(availableItems, index, available);
+        changes++;
+    }
+
+    // Differs from any earlier value whenever the menu has changed since
+    uint64_t version() const { return changes; }
+
+    // Menu position of the item, or kNone
+    uint32_t find(std::string_view itemId) const {
+        uint32_t id = symbols.find(itemId);
+        return id < itemBySymbol.size() ? itemBySymbol[id] : kNone;
+    }
+
+    void clear() {
+        symbols.clear();
+        for (auto* column : {&categories, &ids, &names, &descriptions, &firstIngredient, &ingredientCounts,
+                             &firstAllergen, &allergenCounts, &symbolLists, &itemBySymbol, &ranked,
+                             &allergenBitmap, &ingredientBitmap, &categoryBitmap}) {
+            column->clear();
+        }
+        bitmaps.clear();
+        availableItems.clear();
+        for (auto& level : spiceItems) level.clear();
+        prices.clear();
+        prepMinutes.clear();
+        calorieCounts.clear();
+        spiceLevels.clear();
+        availability.clear();
+        changes++;
+    }
+
+    size_t size() const { return ids.size(); }
+
+    std::string_view itemId(uint32_t index) const { return symbols.name(ids[index]); }
+    std::string_view name(uint32_t index) const { return symbols.name(names[index]); }
+    std::string_view category(uint32_t index) const { return symbols.name(categories[index]); }
+    std::string_view description(uint32_t index) const { return symbols.name(descriptions[index]); }
+    uint32_t categorySymbol(uint32_t index) const { return categories[index]; }
+    int64_t priceCents(uint32_t index) const { return prices[index]; }
+    int preparationTime(uint32_t index) const { return prepMinutes[index]; }
+    bool available(uint32_t index) const { return availability[index] != 0; }
+    int spiceLevel(uint32_t index) const { return spiceLevels[index]; }
+    int calories(uint32_t index) const { return calorieCounts[index]; }
+    SymbolRange ingredients(uint32_t index) const { return range(firstIngredient[index], ingredientCounts[index]); }
+    SymbolRange allergens(uint32_t index) const { return range(firstAllergen[index], allergenCounts[index]); }
+    std::string_view symbolName(uint32_t symbol) const { return symbols.name(symbol); }
+
+    // Positions of the matching items in ranked order. The set conditions are ANDed
+    // together over the bitmaps; only the surviving items have their calories and price
+    // read. Walking the precomputed ranking then lists them without sorting.
+    std::vector<uint32_t> filter(const MenuQuery& query) const {
+        size_t count = ids.size(), words = (count + 63) / 64;
+        Bitmap matches(words, ~uint64_t(0));
+        if (count % 64) matches.back() = (uint64_t(1) << (count % 64)) - 1;
+        auto keepOnly = [&matches, words](const Bitmap* bits) { // null keeps nothing
+            size_t known = bits ? std::min(words, bits->size()) : 0;
+            for (size_t w = 0; w < known; w++) matches[w] &= (*bits)[w];
+            for (size_t w = known; w < words; w++) matches[w] = 0;
+        };
+        auto drop = [&matches, words](const Bitmap* bits) {
+            if (!bits) return;
+            for (size_t w = 0; w < std::min(words, bits->size()); w++) matches[w] &= ~(*bits)[w];
+        };
+
+        if (!query.includeUnavailable) keepOnly(&availableItems);
+        if (!query.category.empty()) keepOnly(findBitmap(categoryBitmap, query.category));
+        for (const auto& name : query.withoutAllergens) drop(findBitmap(allergenBitmap, name));
+        for (const auto& name : query.withoutIngredients) drop(findBitmap(ingredientBitmap, name));
+        if (query.maxSpice >= 0) {
+            Bitmap allowed(words, 0);
+            for (size_t level = 0; level < spiceItems.size() && static_cast<int>(level) <= query.maxSpice; level++) {
+                for (size_t w = 0; w < std::min(words, spiceItems[level].size()); w++) {
+                    allowed[w] |= spiceItems[level][w];
+                }
+            }
+            keepOnly(&allowed);
+        }
+        if (query.maxCalories >= 0 || query.maxCents >= 0) {
+            int maxCalories = query.maxCalories >= 0 ? query.maxCalories : INT32_MAX;
+            int minCalories = query.maxCalories >= 0 ? 1 : 0;
+            int64_t maxCents = query.maxCents >= 0 ? query.maxCents : INT64_MAX;
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t bits = matches[w]; bits; bits &= bits - 1) {
+                    size_t index = w * 64 + __builtin_ctzll(bits);
+                    if (calorieCounts[index] < minCalories || calorieCounts[index] > maxCalories ||
+                        prices[index] > maxCents) {
+                        matches[w] &= ~(uint64_t(1) << (index % 64));
+                    }
+                }
+            }
+        }
+
+        // No branch per item, so the walk costs the same whatever the hit pattern
+        std::vector<uint32_t> listed(count);
+        size_t found = 0;
+        for (uint32_t index : ranked) {
+            listed[found] = index;
+            found += (matches[index / 64] >> (index % 64)) & 1;
+        }
+        listed.resize(found);
+        return listed;
+    }
+};
+
+// Ingredient stock and the recipe of each menu item, with a reverse index from each
+// ingredient to the items that use it. Quantities are whole units of the kitchen's
+// choosing (portions, grams, bottles). An ingredient is tracked once it is given a stock
+// level; until then it never runs out. An item is short while some tracked ingredient
+// has less than one portion of it needs, and each item keeps a count of such
+// ingredients, so a stock change only visits the items that use that ingredient.
+// Not synchronized.
+class Inventory {
+public:
+    struct Component {
+        uint32_t ingredient;
+        int32_t amount; // per portion
+    };
+
+    // Portions of a menu item sold
+    struct Portion {
+        uint32_t item;
+        int32_t quantity;
+    };
+
+    // An item that has just run short (available false) or can be made again
+    struct Change {
+        uint32_t item;
+        bool available;
+    };
+
+private:
+    struct Use {
+        uint32_t item;
+        int32_t amount;
+    };
+
+    SymbolTable names;                           // ingredient names, by ingredient
+    std::vector<int64_t> stock;                  // by ingredient; untracked ones run negative
+    std::vector<uint8_t> tracked;                // by ingredient
+    std::vector<std::vector<Use>> users;         // by ingredient: the reverse index
+    std::vector<std::vector<Component>> recipes; // by menu position
+    std::vector<uint32_t> shortages;             // by menu position: ingredients it is short of
+    std::vector<int64_t> batchTotals;            // by ingredient, scratch for consume()
+    uint64_t batches = 0, portionsConsumed = 0;
+
+    static bool isShort(bool isTracked, int64_t level, int32_t amount) {
+        return isTracked && level < amount;
+    }
+
+    // Moves one ingredient's stock and recounts the shortages of each item that uses it
+    void moveStock(uint32_t ingredient, int64_t level, bool track, std::vector<Change>& changes) {
+        bool wasTracked = tracked[ingredient];
+        int64_t previous = stock[ingredient];
+        stock[ingredient] = level;
+        tracked[ingredient] = track;
+        for (const Use& use : users[ingredient]) {
+            bool was = isShort(wasTracked, previous, use.amount), now = isShort(track, level, use.amount);
+            if (was == now) continue;
+            uint32_t& count = shortages[use.item];
+            if (now && count++ == 0) changes.push_back({use.item, false});
+            if (!now && --count == 0) changes.push_back({use.item, true});
+        }
+    }
+
+public:
+    static constexpr uint32_t kNone = SymbolTable::kNone;
+
+    uint32_t ingredient(std::string_view name) {
+        uint32_t id = names.intern(name);
+        if (id == stock.size()) {
+            stock.push_back(0);
+            tracked.push_back(0);
+            users.emplace_back();
+            batchTotals.push_back(0);
+        }
+        return id;
+    }
+
+    // kNone if no recipe or stock level has named the ingredient
+    uint32_t findIngredient(std::string_view name) const { return names.find(name); }
+
+    // Replaces the item's recipe; an ingredient listed twice needs both amounts
+    void setRecipe(uint32_t item, const std::vector<Component>& components, std::vector<Change>& changes) {
+        if (recipes.size() <= item) {
+            recipes.resize(item + 1);
+            shortages.resize(item + 1, 0);
+        }
+        for (const Component& component : recipes[item]) {
+            auto& list = users[component.ingredient];
+            list.erase(std::find_if(list.begin(), list.end(), [item](const Use& use) { return use.item == item; }));
+        }
+        bool wasShort = shortages[item] > 0;
+        std::vector<Component>& recipe = recipes[item];
+        recipe.clear();
+        for (const Component& component : components) {
+            auto same = std::find_if(recipe.begin(), recipe.end(),
+                [&component](const Component& c) { return c.ingredient == component.ingredient; });
+            if (same != recipe.end()) same->amount += component.amount;
+            else recipe.push_back(component);
+        }
+        shortages[item] = 0;
+        for (const Component& component : recipe) {
+            users[component.ingredient].push_back({item, component.amount});
+            shortages[item] += isShort(tracked[component.ingredient], stock[component.ingredient], component.amount);
+        }
+        if (wasShort != (shortages[item] > 0)) changes.push_back({item, wasShort});
+    }
+
+    // Sets the stock level; the ingredient is tracked from then on unless restoring an
+    // untracked one's running total
+    void setStock(uint32_t ingredient, int64_t level, std::vector<Change>& changes, bool track = true) {
+        moveStock(ingredient, level, track, changes);
+    }
+
+    // Takes a batch of sold portions off the stock. Totals per ingredient come first,
+    // so each ingredient's users are visited once per batch however many orders it holds.
+    void consume(const std::vector<Portion>& portions, std::vector<Change>& changes) {
+        std::vector<uint32_t> touched;
+        for (const Portion& portion : portions) {
+            if (portion.item >= recipes.size()) continue;
+            for (const Component& component : recipes[portion.item]) {
+                if (batchTotals[component.ingredient] == 0) touched.push_back(component.ingredient);
+                batchTotals[component.ingredient] += static_cast<int64_t>(component.amount) * portion.quantity;
+            }
+            portionsConsumed += portion.quantity;
+        }
+        for (uint32_t ingredient : touched) {
+            moveStock(ingredient, stock[ingredient] - batchTotals[ingredient], tracked[ingredient], changes);
+            batchTotals[ingredient] = 0;
+        }
+        batches++;
+    }
+
+    void clear() {
+        names.clear();
+        for (auto* column : {&stock, &batchTotals}) column->clear();
+        tracked.clear();
+        users.clear();
+        recipes.clear();
+        shortages.clear();
+    }
+
+    size_t size() const { return stock.size(); }
+    std::string_view name(uint32_t ingredient) const { return names.name(ingredient); }
+    int64_t onHand(uint32_t ingredient) const { return stock[ingredient]; }
+    bool isTracked(uint32_t ingredient) const { return tracked[ingredient] != 0; }
+    bool isShort(uint32_t item) const { return item < shortages.size() && shortages[item] > 0; }
+    uint64_t batchCount() const { return batches; }
+    uint64_t portionCount() const { return portionsConsumed; }
+
+    const std::vector<Component>& recipe(uint32_t item) const {
+        static const std::vector<Component> none;
+        return item < recipes.size() ? recipes[item] : none;
+    }
 };
 
 class Table {
@@ -102,13 +847,13 @@ public:
         isOccupied = false;
     }
 
-    void displayInfo() const {
-        std::cout << "\nTable " << tableNumber << std::endl;
-        std::cout << "Capacity: " << capacity << " people" << std::endl;
-        std::cout << "Location: " << location << std::endl;
-        std::cout << "Status: " << (isOccupied ? "Occupied" : "Available") << std::endl;
+    void displayInfo(std::ostream& out = std::cout) const {
+        out << "\nTable " << tableNumber << '\n';
+        out << "Capacity: " << capacity << " people\n";
+        out << "Location: " << location << '\n';
+        out << "Status: " << (isOccupied ? "Occupied" : "Available") << '\n';
         if (!specialFeatures.empty()) {
-            std::cout << "Features: " << specialFeatures << std::endl;
+            out << "Features: " << specialFeatures << '\n';
         }
     }
 
@@ -116,443 +861,8386 @@ public:
     int getCapacity() const { return capacity; }
     bool getOccupancy() const { return isOccupied; }
     std::string getLocation() const { return location; }
+    std::string getSpecialFeatures() const { return specialFeatures; }
+};
+
+// Days since 1970-01-01 for a civil date
+int daysFromCivil(int year, int month, int dayOfMonth) {
+    // Civil-to-days conversion on a calendar that starts in March
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + dayOfMonth - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Days since 1970-01-01 for a YYYY-MM-DD date; false if it is not a valid date
+bool parseDate(const std::string& text, int& day) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) return false;
+    }
+    int year = std::atoi(text.c_str()), month = std::atoi(text.c_str() + 5), dayOfMonth = std::atoi(text.c_str() + 8);
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (month < 1 || month > 12 || dayOfMonth < 1 ||
+        dayOfMonth > daysInMonth[month - 1] + (month == 2 && leap ? 1 : 0)) {
+        return false;
+    }
+    day = daysFromCivil(year, month, dayOfMonth);
+    return true;
+}
+
+// YYYY-MM-DD for days since 1970-01-01
+std::string formatDate(int day) {
+    day += 719468;
+    int era = (day >= 0 ? day : day - 146096) / 146097;
+    int dayOfEra = day - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    int dayOfMonth = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int year = yearOfEra + era * 400 + (month <= 2);
+    char text[40];
+    std::snprintf(text, sizeof(text), "%04d-%02d-%02d", year, month, dayOfMonth);
+    return text;
+}
+
+// Minute of day for HH:MM; false if malformed
+bool parseClock(const std::string& text, int& minute) {
+    if (text.size() != 5 || text[2] != ':' || !std::isdigit(static_cast<unsigned char>(text[0])) ||
+        !std::isdigit(static_cast<unsigned char>(text[1])) || !std::isdigit(static_cast<unsigned char>(text[3])) ||
+        !std::isdigit(static_cast<unsigned char>(text[4]))) {
+        return false;
+    }
+    int hours = (text[0] - '0') * 10 + (text[1] - '0');
+    int minutes = (text[3] - '0') * 10 + (text[4] - '0');
+    if (hours > 23 || minutes > 59) return false;
+    minute = hours * 60 + minutes;
+    return true;
+}
+
+std::string formatClock(int minute) {
+    char text[8] = {char('0' + minute / 600), char('0' + minute / 60 % 10), ':',
+                    char('0' + minute % 60 / 10), char('0' + minute % 10), '\0'};
+    return text;
+}
+
+// The local date and minute, worked out once a minute instead of on every call. The
+// reading is packed into one atomic word (epoch minute, day, minute of day), so readers
+// never lock; the first caller to see the minute turn over redoes the localtime() call.
+class ServiceClock {
+public:
+    struct Reading {
+        int day;    // local date, days since 1970-01-01
+        int minute; // local minute of day
+    };
+
+private:
+    static std::atomic<uint64_t>& cache() {
+        static std::atomic<uint64_t> packed(0);
+        return packed;
+    }
+
+    static uint64_t refresh(uint64_t epochMinute) {
+        time_t now = static_cast<time_t>(epochMinute * 60);
+        tm localTime;
+        localtime_r(&now, &localTime);
+        uint64_t day = static_cast<uint64_t>(daysFromCivil(1900 + localTime.tm_year, 1 + localTime.tm_mon,
+                                                           localTime.tm_mday));
+        uint64_t packed = epochMinute << 32 | (day & 0x1fffff) << 11 | (localTime.tm_hour * 60 + localTime.tm_min);
+        cache().store(packed, std::memory_order_relaxed);
+        return packed;
+    }
+
+public:
+    static Reading now() {
+        uint64_t epochMinute = static_cast<uint64_t>(time(0)) / 60;
+        uint64_t packed = cache().load(std::memory_order_relaxed);
+        if (packed >> 32 != epochMinute) packed = refresh(epochMinute);
+        return {static_cast<int>(packed >> 11 & 0x1fffff), static_cast<int>(packed & 0x7ff)};
+    }
+
+    // Minutes since 1970-01-01, local time
+    static int64_t localMinute() {
+        Reading reading = now();
+        return static_cast<int64_t>(reading.day) * 1440 + reading.minute;
+    }
+};
+
+struct OrderLine {
+    uint32_t menuIndex; // position in the Restaurant's menu
+    int32_t quantity;
+    int64_t unitCents;  // price charged when the item was ordered
 };
 
+// Vector that keeps its first N elements inside the object and only goes to the heap
+// past that. For plain records.
+template <typename T, size_t N>
+class InlineVector {
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "InlineVector holds plain records");
+    T local[N] = {};
+    std::vector<T> spilled; // all elements, once there are more than N
+    uint32_t count = 0;
+
+public:
+    void push_back(const T& value) {
+        if (count < N) {
+            local[count++] = value;
+            return;
+        }
+        if (count == N) spilled.assign(local, local + N);
+        spilled.push_back(value);
+        count++;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return count <= N ? local : spilled.data(); }
+    const T* end() const { return begin() + count; }
+    const T& operator[](size_t i) const { return begin()[i]; }
+};
+
+// One line of an order as requested, before prices are looked up
+struct OrderRequestLine {
+    std::string itemId;
+    int quantity;
+};
+
+// Order lifecycle. Service moves forward through pending..paid; void cancels an unpaid
+// order and refunded reverses a paid one.
+enum class OrderStatus : uint8_t { Pending, Cooking, Ready, Served, Paid, Void, Refunded };
+const size_t kOrderStatusCount = 7;
+
+const char* statusName(OrderStatus status) {
+    static const char* names[kOrderStatusCount] = {"pending", "cooking", "ready", "served", "paid", "void", "refunded"};
+    return names[static_cast<size_t>(status)];
+}
+
+bool parseStatus(const std::string& text, OrderStatus& status) {
+    for (size_t i = 0; i < kOrderStatusCount; i++) {
+        if (text == statusName(static_cast<OrderStatus>(i))) {
+            status = static_cast<OrderStatus>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Still being prepared or served, as opposed to settled (paid, void or refunded)
+bool isOpenStatus(OrderStatus status) {
+    return status <= OrderStatus::Served;
+}
+
+// Forward through the service, steps may be skipped (a counter order can go straight
+// to paid); void from any open status; refunded only from paid
+bool canTransition(OrderStatus from, OrderStatus to) {
+    if (isOpenStatus(from)) return to == OrderStatus::Void || (to > from && to <= OrderStatus::Paid);
+    return from == OrderStatus::Paid && to == OrderStatus::Refunded;
+}
+
 class Order {
 private:
     std::string orderId;
     int tableNumber;
-    std::vector<std::pair<std::string, int>> items; // item ID and quantity
-    std::string orderTime;
-    std::string status; // pending, cooking, ready, served, paid
-    double totalAmount;
+    InlineVector<OrderLine, 8> items; // nearly every order fits inline
+    int32_t orderDay;    // business date, days since 1970-01-01
+    int32_t orderMinute; // local minute of day it was placed
+    OrderStatus status;
+    std::array<int64_t, kOrderStatusCount> statusTimes; // unix seconds each status was entered, 0 if never
+    int64_t totalCents;
     std::string specialInstructions;
     int customerCount;
 
+    // Links in the Restaurant's list of orders with the same status
+    friend class OrderStatusLists;
+    Order* statusPrev = nullptr;
+    Order* statusNext = nullptr;
+
 public:
-    Order(std::string id, int table, std::string time, int customers)
-        : orderId(id), tableNumber(table), orderTime(time), 
-          status("pending"), totalAmount(0.0), customerCount(customers) {}
+    Order(std::string id, int table, int day, int minute, int customers, int64_t placedAt = 0)
+        : orderId(id), tableNumber(table), orderDay(day), orderMinute(minute),
+          status(OrderStatus::Pending), statusTimes{}, totalCents(0), customerCount(customers) {
+        statusTimes[0] = placedAt;
+    }
 
-    void addItem(const std::string& itemId, int quantity, double price) {
-        items.push_back({itemId, quantity});
-        totalAmount += price * quantity;
+    void addItem(uint32_t menuIndex, int quantity, int64_t unitCents) {
+        items.push_back({menuIndex, quantity, unitCents});
+        totalCents += unitCents * quantity;
     }
 
-    void updateStatus(const std::string& newStatus) {
+    // Sets the status as given; callers check canTransition() first where it matters
+    void updateStatus(OrderStatus newStatus, int64_t when) {
         status = newStatus;
+        statusTimes[static_cast<size_t>(newStatus)] = when;
     }
 
     void addSpecialInstructions(const std::string& instructions) {
         specialInstructions = instructions;
     }
 
-    void displayInfo() const {
-        std::cout << "\n=== Order " << orderId << " ===" << std::endl;
-        std::cout << "Table: " << tableNumber << " | Customers: " << customerCount << std::endl;
-        std::cout << "Time: " << orderTime << " | Status: " << status << std::endl;
-        std::cout << "Total: $" << std::fixed << std::setprecision(2) << totalAmount << std::endl;
+    // The menu resolves the item on each line
+    void displayInfo(const MenuCatalog& menu, std::ostream& out = std::cout) const {
+        out << "\n=== Order " << orderId << " ===\n";
+        out << "Table: " << tableNumber << " | Customers: " << customerCount << '\n';
+        out << "Time: " << formatClock(orderMinute) << " | Status: " << statusName(status) << '\n';
+        out << "Total: $" << formatMoney(totalCents) << '\n';
+
+        std::string timeline;
+        for (size_t i = 0; i < kOrderStatusCount; i++) {
+            if (statusTimes[i] == 0) continue;
+            time_t when = static_cast<time_t>(statusTimes[i]);
+            tm localTime;
+            localtime_r(&when, &localTime);
+            char clock[8];
+            std::strftime(clock, sizeof(clock), "%H:%M", &localTime);
+            if (!timeline.empty()) timeline += ", ";
+            timeline += std::string(statusName(static_cast<OrderStatus>(i))) + " " + clock;
+        }
+        if (!timeline.empty()) out << "Timeline: " << timeline << '\n';
         
         if (!specialInstructions.empty()) {
-            std::cout << "Special Instructions: " << specialInstructions << std::endl;
+            out << "Special Instructions: " << specialInstructions << '\n';
         }
         
-        std::cout << "Items:" << std::endl;
+        out << "Items:\n";
         for (const auto& item : items) {
-            std::cout << "  Item: " << item.first << " - Qty: " << item.second << std::endl;
+            out << "  Item: " << menu.itemId(item.menuIndex) << " - Qty: " << item.quantity << '\n';
         }
     }
 
     std::string getOrderId() const { return orderId; }
     int getTableNumber() const { return tableNumber; }
-    std::string getStatus() const { return status; }
-    double getTotalAmount() const { return totalAmount; }
-    std::vector<std::pair<std::string, int>> getItems() const { return items; }
+    int getOrderDay() const { return orderDay; }
+    int getOrderMinute() const { return orderMinute; }
+    OrderStatus getStatus() const { return status; }
+    int64_t getStatusTime(OrderStatus s) const { return statusTimes[static_cast<size_t>(s)]; }
+    int64_t getTotalCents() const { return totalCents; }
+    std::string getSpecialInstructions() const { return specialInstructions; }
+    int getCustomerCount() const { return customerCount; }
+    const InlineVector<OrderLine, 8>& getItems() const { return items; }
 };
 
-class Reservation {
+// Bump allocator for orders. Memory is handed out from 64 KB blocks and never returned
+// piecemeal: the blocks are freed together once the arena and everything allocated from
+// it are gone. Thread-safe.
+class OrderArena {
 private:
-    std::string reservationId;
-    std::string customerName;
-    std::string phone;
-    int partySize;
-    std::string reservationDate;
-    std::string reservationTime;
-    int tableNumber;
-    std::string specialRequests;
+    static constexpr size_t kBlockSize = 64 * 1024;
+    std::mutex lock;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t used = kBlockSize; // in the last block
 
 public:
-    Reservation(std::string id, std::string name, std::string ph, int size,
-                std::string date, std::string time, int table)
-        : reservationId(id), customerName(name), phone(ph), partySize(size),
-          reservationDate(date), reservationTime(time), tableNumber(table) {}
-
-    void addSpecialRequests(const std::string& requests) {
-        specialRequests = requests;
+    void* allocate(size_t size, size_t alignment) {
+        std::lock_guard<std::mutex> guard(lock);
+        used = (used + alignment - 1) & ~(alignment - 1);
+        if (used + size > kBlockSize) {
+            blocks.emplace_back(new char[std::max(size, kBlockSize)]);
+            used = 0;
+        }
+        void* block = blocks.back().get() + used;
+        used += size;
+        return block;
     }
 
-    void displayInfo() const {
-        std::cout << "\n=== Reservation " << reservationId << " ===" << std::endl;
-        std::cout << "Customer: " << customerName << " | Phone: " << phone << std::endl;
-        std::cout << "Party Size: " << partySize << " | Table: " << tableNumber << std::endl;
-        std::cout << "Date: " << reservationDate << " | Time: " << reservationTime << std::endl;
-        if (!specialRequests.empty()) {
-            std::cout << "Special Requests: " << specialRequests << std::endl;
-        }
+    size_t bytesReserved() {
+        std::lock_guard<std::mutex> guard(lock);
+        return blocks.size() * kBlockSize;
     }
+};
 
-    std::string getReservationId() const { return reservationId; }
-    std::string getCustomerName() const { return customerName; }
-    std::string getReservationDate() const { return reservationDate; }
-    std::string getReservationTime() const { return reservationTime; }
-    int getTableNumber() const { return tableNumber; }
+// For std::allocate_shared: the order and its control block come out of the arena, and
+// the control block keeps the arena alive for as long as the order is.
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    std::shared_ptr<OrderArena> arena;
+
+    explicit ArenaAllocator(std::shared_ptr<OrderArena> from) : arena(std::move(from)) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// Orders threaded through their own links, one doubly linked list per status in the
+// order they entered it, so listing the orders in a status costs O(that status) rather
+// than O(history). Not synchronized.
+class OrderStatusLists {
+private:
+    std::array<Order*, kOrderStatusCount> heads{};
+    std::array<Order*, kOrderStatusCount> tails{};
+    std::array<size_t, kOrderStatusCount> counts{};
+
+public:
+    // Appends the order to the list for its current status
+    void link(Order& order) {
+        size_t list = static_cast<size_t>(order.status);
+        order.statusPrev = tails[list];
+        order.statusNext = nullptr;
+        if (tails[list]) tails[list]->statusNext = &order;
+        else heads[list] = &order;
+        tails[list] = &order;
+        counts[list]++;
+    }
+
+    // Removes the order from the list for its current status
+    void unlink(Order& order) {
+        size_t list = static_cast<size_t>(order.status);
+        if (order.statusPrev) order.statusPrev->statusNext = order.statusNext;
+        else heads[list] = order.statusNext;
+        if (order.statusNext) order.statusNext->statusPrev = order.statusPrev;
+        else tails[list] = order.statusPrev;
+        order.statusPrev = order.statusNext = nullptr;
+        counts[list]--;
+    }
+
+    void move(Order& order, OrderStatus newStatus, int64_t when) {
+        unlink(order);
+        order.updateStatus(newStatus, when);
+        link(order);
+    }
+
+    void clear() {
+        heads.fill(nullptr);
+        tails.fill(nullptr);
+        counts.fill(0);
+    }
+
+    size_t count(OrderStatus status) const { return counts[static_cast<size_t>(status)]; }
+
+    template <typename Visit>
+    void forEach(OrderStatus status, Visit visit) const {
+        for (const Order* order = heads[static_cast<size_t>(status)]; order; order = order->statusNext) {
+            visit(*order);
+        }
+    }
+};
+
+class Reservation {
+private:
+    std::string reservationId;
+    std::string customerName;
+    std::string phone;
+    int partySize;
+    int reservationDay;    // days since 1970-01-01
+    int reservationMinute; // minute of day
+    int durationMinutes;
+    int tableNumber;
+    std::string specialRequests;
+
+public:
+    Reservation(std::string id, std::string name, std::string ph, int size,
+                int day, int minute, int table, int duration = 120)
+        : reservationId(id), customerName(name), phone(ph), partySize(size),
+          reservationDay(day), reservationMinute(minute), durationMinutes(duration), tableNumber(table) {}
+
+    void addSpecialRequests(const std::string& requests) {
+        specialRequests = requests;
+    }
+
+    void displayInfo(std::ostream& out = std::cout) const {
+        out << "\n=== Reservation " << reservationId << " ===\n";
+        out << "Customer: " << customerName << " | Phone: " << phone << '\n';
+        out << "Party Size: " << partySize << " | Table: " << tableNumber << '\n';
+        out << "Date: " << formatDate(reservationDay) << " | Time: " << formatClock(reservationMinute)
+                  << " (" << durationMinutes << " min)\n";
+        if (!specialRequests.empty()) {
+            out << "Special Requests: " << specialRequests << '\n';
+        }
+    }
+
+    std::string getReservationId() const { return reservationId; }
+    std::string getCustomerName() const { return customerName; }
+    std::string getPhone() const { return phone; }
+    int getReservationDay() const { return reservationDay; }
+    int getReservationMinute() const { return reservationMinute; }
+    // Minutes since 1970-01-01 when the seating starts
+    int64_t getStartMinute() const { return static_cast<int64_t>(reservationDay) * 1440 + reservationMinute; }
+    int getDurationMinutes() const { return durationMinutes; }
+    int getTableNumber() const { return tableNumber; }
     int getPartySize() const { return partySize; }
+    std::string getSpecialRequests() const { return specialRequests; }
 };
 
-class Restaurant {
+// Reservations indexed by table and time. Each table keeps its bookings in a map keyed by
+// start minute (minutes since 1970-01-01), so a conflict check is one lower_bound, and
+// tables are ordered by capacity so the first free table at or above the party size is the
+// best fit. A per-day index serves the daily listing.
+class ReservationBook {
 private:
-    std::vector<std::shared_ptr<MenuItem>> menu;
-    std::vector<std::shared_ptr<Table>> tables;
-    std::vector<std::shared_ptr<Order>> orders;
-    std::vector<std::shared_ptr<Reservation>> reservations;
-    std::string restaurantName;
-    int nextOrderId;
-    int nextReservationId;
+    struct Booking {
+        int64_t end;
+        std::shared_ptr<Reservation> reservation;
+    };
+
+    std::unordered_map<int, std::map<int64_t, Booking>> schedule; // table -> start -> booking
+    std::multimap<int, int> tablesByCapacity;                      // capacity -> table number
+    std::unordered_map<int, int> capacityOf;
+    std::map<int, std::multimap<int, std::shared_ptr<Reservation>>> byDay; // day -> minute -> reservation
+
+public:
+    void addTable(int tableNumber, int capacity) {
+        removeTable(tableNumber);
+        tablesByCapacity.insert({capacity, tableNumber});
+        capacityOf[tableNumber] = capacity;
+    }
+
+    void removeTable(int tableNumber) {
+        auto it = capacityOf.find(tableNumber);
+        if (it == capacityOf.end()) return;
+        auto range = tablesByCapacity.equal_range(it->second);
+        for (auto t = range.first; t != range.second; ++t) {
+            if (t->second == tableNumber) {
+                tablesByCapacity.erase(t);
+                break;
+            }
+        }
+        capacityOf.erase(it);
+    }
+
+    void clear() {
+        schedule.clear();
+        tablesByCapacity.clear();
+        capacityOf.clear();
+        byDay.clear();
+    }
+
+    // True if no booking on the table overlaps [start, end)
+    bool isFree(int tableNumber, int64_t start, int64_t end) const {
+        auto it = schedule.find(tableNumber);
+        if (it == schedule.end()) return true;
+        const auto& bookings = it->second;
+        auto next = bookings.lower_bound(start);
+        if (next != bookings.end() && next->first < end) return false;
+        if (next != bookings.begin() && std::prev(next)->second.end > start) return false;
+        return true;
+    }
+
+    // Every table that seats the party and is free for the interval, smallest first.
+    // One O(log bookings) probe per table that seats the party: the answer lists up to
+    // that many tables anyway, and a floor has tens of tables against thousands of
+    // bookings, so an index across tables would cost more to keep than it saves.
+    std::vector<int> freeTables(int partySize, int64_t start, int64_t end) const {
+        std::vector<int> result;
+        for (auto it = tablesByCapacity.lower_bound(partySize); it != tablesByCapacity.end(); ++it) {
+            if (isFree(it->second, start, end)) result.push_back(it->second);
+        }
+        return result;
+    }
+
+    // Smallest free table that seats the party, so an 8-top is not spent on a couple; -1 if
+    // none. Probes tables smallest first like freeTables and stops at the first free one.
+    int bestFit(int partySize, int64_t start, int64_t end) const {
+        for (auto it = tablesByCapacity.lower_bound(partySize); it != tablesByCapacity.end(); ++it) {
+            if (isFree(it->second, start, end)) return it->second;
+        }
+        return -1;
+    }
+
+    // The first booking on the table still to come or under way at from, for a party
+    // larger than capacity; null if there is none
+    std::shared_ptr<Reservation> firstLargerThan(int tableNumber, int capacity, int64_t from) const {
+        auto it = schedule.find(tableNumber);
+        if (it == schedule.end()) return nullptr;
+        const auto& bookings = it->second;
+        auto booking = bookings.lower_bound(from);
+        if (booking != bookings.begin() && std::prev(booking)->second.end > from) --booking;
+        for (; booking != bookings.end(); ++booking) {
+            if (booking->second.reservation->getPartySize() > capacity) return booking->second.reservation;
+        }
+        return nullptr;
+    }
+
+    // False, adding nothing, if the table already has a booking starting at the same time
+    bool add(const std::shared_ptr<Reservation>& reservation, int day, int minute) {
+        int64_t start = static_cast<int64_t>(day) * 1440 + minute;
+        auto [booking, inserted] = schedule[reservation->getTableNumber()].emplace(
+            start, Booking{start + reservation->getDurationMinutes(), reservation});
+        if (!inserted) return false;
+        byDay[day].insert({minute, reservation});
+        return true;
+    }
+
+    // Reservations on the day ordered by time, or null if there are none
+    const std::multimap<int, std::shared_ptr<Reservation>>* reservationsOn(int day) const {
+        auto it = byDay.find(day);
+        return it != byDay.end() ? &it->second : nullptr;
+    }
+
+    // Number of tables free for a seating of the given length at each slot of the grid,
+    // per party size. Each table's bookings are swept once and mark the slots they block,
+    // instead of running one query per slot.
+    std::vector<std::vector<int>> availabilityGrid(int day, int firstMinute, int lastMinute, int step,
+                                                   int duration, const std::vector<int>& partySizes) const {
+        int slots = (lastMinute - firstMinute) / step + 1;
+        std::vector<std::vector<int>> grid(slots, std::vector<int>(partySizes.size(), 0));
+        int64_t gridStart = static_cast<int64_t>(day) * 1440 + firstMinute;
+        int64_t gridEnd = gridStart + static_cast<int64_t>(slots - 1) * step + duration;
+
+        for (const auto& [capacity, tableNumber] : tablesByCapacity) {
+            std::vector<int> blocked(slots + 1, 0); // difference array over slots
+            auto it = schedule.find(tableNumber);
+            if (it != schedule.end()) {
+                const auto& bookings = it->second;
+                auto booking = bookings.lower_bound(gridStart);
+                if (booking != bookings.begin()) --booking;
+                for (; booking != bookings.end() && booking->first < gridEnd; ++booking) {
+                    // Slot k starting at s conflicts when s < end and s + duration > start
+                    int64_t from = booking->first - duration + 1 - gridStart;
+                    int64_t to = booking->second.end - 1 - gridStart;
+                    int64_t firstSlot = std::max<int64_t>(0, from <= 0 ? 0 : (from + step - 1) / step);
+                    int64_t lastSlot = to < 0 ? -1 : std::min<int64_t>(slots - 1, to / step);
+                    if (firstSlot <= lastSlot) {
+                        blocked[firstSlot]++;
+                        blocked[lastSlot + 1]--;
+                    }
+                }
+            }
+            int running = 0;
+            for (int k = 0; k < slots; k++) {
+                running += blocked[k];
+                if (running > 0) continue;
+                for (size_t p = 0; p < partySizes.size(); p++) {
+                    if (capacity >= partySizes[p]) grid[k][p]++;
+                }
+            }
+        }
+        return grid;
+    }
+};
+
+// Plans the kitchen: every open order is a ticket of per-item tasks, each cooked at the
+// station for its menu category. Tickets are taken oldest first off a binary heap and
+// packed onto the stations' cooks; each cook's share of a ticket is then pushed as late
+// as it can go so the whole table's food comes up together. Times are minutes since
+// 1970-01-01 in local time, like ReservationBook.
+class KitchenScheduler {
+public:
+    struct Task {
+        std::string itemId;
+        int station;
+        int minutes;
+        int cook = -1; // -1 until scheduled
+        int64_t start = 0;
+        int64_t end = 0;
+    };
+
+private:
+    struct Station {
+        std::string name;
+        std::vector<int64_t> cookFreeAt; // one entry per cook
+    };
+
+    struct Ticket {
+        std::string orderId;
+        int64_t placedAt;
+        uint64_t sequence;
+        std::vector<Task> tasks; // grouped by station, longest first
+        int64_t readyAt = 0;
+        bool moved = true; // readyAt changed since takeMoved() last reported it
+    };
+
+    std::vector<Station> stations;
+    std::unordered_map<std::string, int> stationByCategory;
+    int defaultStation = 0;
+    std::vector<Ticket> tickets;
+    std::unordered_map<std::string, size_t> ticketIndex; // order ID -> position in tickets
+    uint64_t nextSequence = 0;
+    std::vector<std::tuple<int64_t, uint64_t, size_t>> heap; // reused by reschedule()
+
+    // Lays a ticket onto the cooks that free up first, then shifts each cook's run of
+    // tasks right so it ends with the slowest one
+    void place(Ticket& ticket) {
+        int64_t readyAt = 0;
+        for (auto& task : ticket.tasks) {
+            auto& cooks = stations[task.station].cookFreeAt;
+            task.cook = static_cast<int>(std::min_element(cooks.begin(), cooks.end()) - cooks.begin());
+            task.start = cooks[task.cook];
+            task.end = task.start + task.minutes;
+            cooks[task.cook] = task.end;
+            readyAt = std::max(readyAt, task.end);
+        }
+        for (auto& task : ticket.tasks) {
+            int64_t slack = readyAt - stations[task.station].cookFreeAt[task.cook];
+            task.start += slack;
+            task.end += slack;
+        }
+        for (const auto& task : ticket.tasks) {
+            stations[task.station].cookFreeAt[task.cook] = readyAt;
+        }
+        ticket.moved = ticket.moved || readyAt != ticket.readyAt;
+        ticket.readyAt = readyAt;
+    }
+
+public:
+    int addStation(const std::string& name, int cooks) {
+        stations.push_back({name, std::vector<int64_t>(std::max(1, cooks), 0)});
+        return static_cast<int>(stations.size()) - 1;
+    }
+
+    // Categories with no station of their own go to the default one
+    void assignCategory(const std::string& category, int station, bool isDefault = false) {
+        stationByCategory[category] = station;
+        if (isDefault) defaultStation = station;
+    }
+
+    int stationFor(const std::string& category) const {
+        auto it = stationByCategory.find(category);
+        return it != stationByCategory.end() ? it->second : defaultStation;
+    }
+
+    const std::string& stationName(int station) const { return stations[station].name; }
+
+    // Queues an order's tasks; call reschedule() to plan it
+    void addTicket(const std::string& orderId, int64_t placedAt, std::vector<Task> tasks) {
+        removeTicket(orderId);
+        std::sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) {
+            return a.station != b.station ? a.station < b.station : a.minutes > b.minutes;
+        });
+        ticketIndex[orderId] = tickets.size();
+        tickets.push_back({orderId, placedAt, nextSequence++, std::move(tasks)});
+    }
+
+    void removeTicket(const std::string& orderId) {
+        auto it = ticketIndex.find(orderId);
+        if (it == ticketIndex.end()) return;
+        size_t position = it->second;
+        ticketIndex.erase(it);
+        if (position != tickets.size() - 1) {
+            tickets[position] = std::move(tickets.back());
+            ticketIndex[tickets[position].orderId] = position;
+        }
+        tickets.pop_back();
+    }
+
+    void clear() {
+        tickets.clear();
+        ticketIndex.clear();
+    }
+
+    // Replans every ticket from now. Tickets with a task already on the stove keep
+    // their plan and hold their cooks; the rest are placed again in arrival order.
+    void reschedule(int64_t now) {
+        for (auto& station : stations) {
+            std::fill(station.cookFreeAt.begin(), station.cookFreeAt.end(), now);
+        }
+        heap.clear();
+        for (size_t i = 0; i < tickets.size(); i++) {
+            const Ticket& ticket = tickets[i];
+            bool started = std::any_of(ticket.tasks.begin(), ticket.tasks.end(),
+                [now](const Task& task) { return task.cook >= 0 && task.start < now; });
+            if (!started) {
+                heap.emplace_back(ticket.placedAt, ticket.sequence, i);
+                continue;
+            }
+            for (const auto& task : ticket.tasks) {
+                int64_t& freeAt = stations[task.station].cookFreeAt[task.cook];
+                freeAt = std::max(freeAt, task.end);
+            }
+        }
+
+        auto later = std::greater<std::tuple<int64_t, uint64_t, size_t>>();
+        std::make_heap(heap.begin(), heap.end(), later);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            place(tickets[std::get<2>(heap.back())]);
+            heap.pop_back();
+        }
+    }
+
+    // Predicted time the order's food is all up, or -1 if it is not in the kitchen
+    int64_t readyAt(const std::string& orderId) const {
+        auto it = ticketIndex.find(orderId);
+        return it != ticketIndex.end() ? tickets[it->second].readyAt : -1;
+    }
+
+    size_t size() const { return tickets.size(); }
+
+    // Calls visit(orderId, readyAt) for every ticket new or replanned to a different
+    // time since the last call
+    template <typename Visit>
+    void takeMoved(Visit visit) {
+        for (auto& ticket : tickets) {
+            if (!ticket.moved) continue;
+            visit(ticket.orderId, ticket.readyAt);
+            ticket.moved = false;
+        }
+    }
+
+    // Tickets in the order they come up, with each task's station and cook time
+    void display(std::ostream& out = std::cout) const {
+        std::vector<const Ticket*> byReady;
+        for (const auto& ticket : tickets) byReady.push_back(&ticket);
+        std::sort(byReady.begin(), byReady.end(), [](const Ticket* a, const Ticket* b) {
+            return std::tie(a->readyAt, a->sequence) < std::tie(b->readyAt, b->sequence);
+        });
+        for (const Ticket* ticket : byReady) {
+            out << ticket->orderId << " ready " << formatClock(static_cast<int>(ticket->readyAt % 1440))
+                      << '\n';
+            for (const auto& task : ticket->tasks) {
+                out << "  " << std::left << std::setw(10) << task.itemId << std::setw(8)
+                          << stations[task.station].name << std::right << " cook " << task.cook + 1 << "  "
+                          << formatClock(static_cast<int>(task.start % 1440)) << "-"
+                          << formatClock(static_cast<int>(task.end % 1440)) << '\n';
+            }
+        }
+    }
+};
+
+// Predicts when each occupied table turns and quotes the parties waiting for one. A
+// table's turn is predicted from what is happening at it: before anyone orders, from
+// when it was seated and the usual stay; while food is still to come, from when the
+// kitchen expects the last of it up; after that, from when it came up. The usual times
+// are learned from tables as they pay, per location and party size. A prediction only
+// changes when something happens at its table, so each event re-files that one table
+// in its capacity's queue of turns; the waiting parties are matched against those
+// queues when someone asks and something has changed since. Times are minutes since
+// 1970-01-01 in local time, like KitchenScheduler.
+class Waitlist {
+public:
+    struct Party {
+        std::string id;
+        std::string name;
+        std::string phone;
+        int size = 0;
+        int64_t joinedAt = 0;
+        int table = -1;       // the table it is expected to get, or -1 if none seats it
+        int64_t seatedBy = 0; // when that table should be ready for it
+    };
+
+private:
+    static constexpr int kMaxParty = 12;        // larger parties learn along with the 12s
+    static constexpr int kMinSamples = 3;       // below this the wider or the default figure is used
+    static constexpr int kSamplesAveraged = 20; // then each new stay counts for 1/20
+    static constexpr int kSeatMinutes = 5;      // a table one seat bigger must turn this much sooner to win
+
+    // Learned minutes from sitting down to paying, and from the food coming up to paying
+    struct Dwell {
+        double seated = 0;
+        double afterFood = 0;
+        int seatedSamples = 0;
+        int afterFoodSamples = 0;
+    };
+
+    struct TableTurn {
+        int capacity = 0;
+        int location = 0;
+        bool occupied = false;
+        bool learnable = false; // seatedAt is when the party sat down, not a guess after a restart
+        int party = 0;
+        int64_t seatedAt = 0;
+        int64_t foodUpAt = -1;  // when the last of the food came up; -1 if it has not
+        std::vector<std::pair<std::string, int64_t>> cooking; // orders in the kitchen, and when each is due up
+        int64_t freeAt = 0;     // the prediction; 0 for a free table
+        uint64_t claimedIn = 0; // the match that gave it to a waiting party
+    };
+
+    std::unordered_map<int, TableTurn> turns;
+    std::map<int, std::set<std::pair<int64_t, int>>> byCapacity; // capacity -> (freeAt, table)
+    std::unordered_map<std::string, int> tableOfOrder;           // orders in the kitchen -> table
+    std::unordered_map<std::string, int> locationIds;
+    std::vector<std::string> locationNames;
+    std::vector<std::array<Dwell, kMaxParty + 1>> dwell; // by location and party size
+    std::array<Dwell, kMaxParty + 1> anyLocation{};
+    std::deque<Party> queue; // in arrival order
+    int nextPartyNumber = 1;
+    bool stale = true;       // something changed since the last match
+    uint64_t matches = 0;
+    int64_t matchedAt = -1;
+
+    static int bucket(int party) { return std::max(1, std::min(party, kMaxParty)); }
+
+    static void average(double& mean, int& samples, double minutes) {
+        samples++;
+        mean += (minutes - mean) / std::min(samples, kSamplesAveraged);
+    }
+
+    int64_t seatedMinutes(int location, int party) const {
+        const Dwell& here = dwell[location][bucket(party)];
+        const Dwell& anywhere = anyLocation[bucket(party)];
+        if (here.seatedSamples >= kMinSamples) return std::llround(here.seated);
+        if (anywhere.seatedSamples >= kMinSamples) return std::llround(anywhere.seated);
+        return 45 + 6 * bucket(party);
+    }
+
+    int64_t afterFoodMinutes(int location, int party) const {
+        const Dwell& here = dwell[location][bucket(party)];
+        const Dwell& anywhere = anyLocation[bucket(party)];
+        if (here.afterFoodSamples >= kMinSamples) return std::llround(here.afterFood);
+        if (anywhere.afterFoodSamples >= kMinSamples) return std::llround(anywhere.afterFood);
+        return 20 + 3 * bucket(party);
+    }
+
+    int64_t predict(const TableTurn& turn) const {
+        if (!turn.occupied) return 0;
+        int64_t foodDue = -1;
+        for (const auto& order : turn.cooking) foodDue = std::max(foodDue, order.second);
+        if (foodDue >= 0) return foodDue + afterFoodMinutes(turn.location, turn.party);
+        if (turn.foodUpAt >= 0) return turn.foodUpAt + afterFoodMinutes(turn.location, turn.party);
+        return turn.seatedAt + seatedMinutes(turn.location, turn.party);
+    }
+
+    // Re-predicts the table and moves it to its new place among its capacity's turns,
+    // reusing its node
+    void refile(int tableNumber, TableTurn& turn) {
+        int64_t freeAt = predict(turn);
+        stale = true;
+        if (freeAt == turn.freeAt) return;
+        auto& line = byCapacity[turn.capacity];
+        auto node = line.extract({turn.freeAt, tableNumber});
+        turn.freeAt = freeAt;
+        if (node.empty()) {
+            line.insert({freeAt, tableNumber});
+            return;
+        }
+        node.value() = {freeAt, tableNumber};
+        line.insert(std::move(node));
+    }
+
+    int locationId(const std::string& name) {
+        auto [it, inserted] = locationIds.insert({name, static_cast<int>(locationNames.size())});
+        if (inserted) {
+            locationNames.push_back(name);
+            dwell.emplace_back();
+        }
+        return it->second;
+    }
+
+    void clearCooking(TableTurn& turn) {
+        for (const auto& order : turn.cooking) tableOfOrder.erase(order.first);
+        turn.cooking.clear();
+    }
+
+    static const char* stage(const TableTurn& turn) {
+        if (!turn.cooking.empty()) return "food to come";
+        return turn.foodUpAt >= 0 ? "eating" : "seated";
+    }
+
+public:
+    // Adds the table, or updates its size and location; what is happening at it stays
+    void addTable(int tableNumber, int capacity, const std::string& location) {
+        auto [it, inserted] = turns.insert({tableNumber, TableTurn()});
+        TableTurn& turn = it->second;
+        if (!inserted) byCapacity[turn.capacity].erase({turn.freeAt, tableNumber});
+        turn.capacity = capacity;
+        turn.location = locationId(location);
+        turn.freeAt = predict(turn);
+        byCapacity[capacity].insert({turn.freeAt, tableNumber});
+        stale = true;
+    }
+
+    // A party sat down; party 0 if its size is not known yet. learnable is false when
+    // the time is a guess, such as for tables found occupied at startup.
+    void seat(int tableNumber, int party, int64_t now, bool learnable = true) {
+        auto it = turns.find(tableNumber);
+        if (it == turns.end()) return;
+        TableTurn& turn = it->second;
+        clearCooking(turn);
+        turn.occupied = true;
+        turn.learnable = learnable;
+        turn.party = party > 0 ? party : turn.capacity;
+        turn.seatedAt = now;
+        turn.foodUpAt = -1;
+        refile(tableNumber, turn);
+    }
+
+    // An order went to the kitchen; due is when its food should be up
+    void ordered(int tableNumber, const std::string& orderId, int customers, int64_t due) {
+        auto it = turns.find(tableNumber);
+        if (it == turns.end() || !it->second.occupied) return;
+        TableTurn& turn = it->second;
+        if (customers > 0) turn.party = customers;
+        turn.cooking.push_back({orderId, due});
+        tableOfOrder[orderId] = tableNumber;
+        refile(tableNumber, turn);
+    }
+
+    // The kitchen replanned and now expects the order's food up at due
+    void kitchenDue(const std::string& orderId, int64_t due) {
+        auto found = tableOfOrder.find(orderId);
+        if (found == tableOfOrder.end()) return;
+        TableTurn& turn = turns[found->second];
+        for (auto& order : turn.cooking) {
+            if (order.first != orderId || order.second == due) continue;
+            order.second = due;
+            refile(found->second, turn);
+        }
+    }
+
+    // The order left the kitchen: its food came up, or (served false) it was voided
+    void leftKitchen(const std::string& orderId, int64_t now, bool served) {
+        auto found = tableOfOrder.find(orderId);
+        if (found == tableOfOrder.end()) return;
+        int tableNumber = found->second;
+        tableOfOrder.erase(found);
+        TableTurn& turn = turns[tableNumber];
+        turn.cooking.erase(std::remove_if(turn.cooking.begin(), turn.cooking.end(),
+            [&orderId](const std::pair<std::string, int64_t>& order) { return order.first == orderId; }),
+            turn.cooking.end());
+        if (served) turn.foodUpAt = now;
+        refile(tableNumber, turn);
+    }
+
+    // The table paid and is free again; how long it took is learned
+    void paid(int tableNumber, int64_t now) {
+        auto it = turns.find(tableNumber);
+        if (it == turns.end() || !it->second.occupied) return;
+        TableTurn& turn = it->second;
+        learn(turn.location, turn.party, turn.learnable ? now - turn.seatedAt : -1,
+              turn.cooking.empty() && turn.foodUpAt >= 0 ? now - turn.foodUpAt : -1);
+        clearCooking(turn);
+        turn.occupied = false;
+        turn.foodUpAt = -1;
+        refile(tableNumber, turn);
+    }
+
+    // Counts one stay; a negative figure is not known. Stays of over eight hours are
+    // taken for tables nobody closed and are ignored.
+    void learn(int location, int party, int64_t seated, int64_t afterFood) {
+        if (seated >= 0 && seated <= 480) {
+            average(dwell[location][bucket(party)].seated, dwell[location][bucket(party)].seatedSamples, seated);
+            average(anyLocation[bucket(party)].seated, anyLocation[bucket(party)].seatedSamples, seated);
+        }
+        if (afterFood >= 0 && afterFood <= 480) {
+            average(dwell[location][bucket(party)].afterFood, dwell[location][bucket(party)].afterFoodSamples,
+                    afterFood);
+            average(anyLocation[bucket(party)].afterFood, anyLocation[bucket(party)].afterFoodSamples, afterFood);
+        }
+        stale = true;
+    }
+
+    void learn(const std::string& location, int party, int64_t seated, int64_t afterFood) {
+        learn(locationId(location), party, seated, afterFood);
+    }
+
+    const Party& join(const std::string& name, const std::string& phone, int size, int64_t now) {
+        Party party;
+        party.id = "W" + std::to_string(nextPartyNumber++);
+        party.name = name;
+        party.phone = phone;
+        party.size = size;
+        party.joinedAt = now;
+        queue.push_back(std::move(party));
+        stale = true;
+        return queue.back();
+    }
+
+    bool leave(const std::string& partyId) {
+        auto it = std::find_if(queue.begin(), queue.end(), [&](const Party& party) { return party.id == partyId; });
+        if (it == queue.end()) return false;
+        queue.erase(it);
+        stale = true;
+        return true;
+    }
+
+    const Party* find(const std::string& partyId) const {
+        auto it = std::find_if(queue.begin(), queue.end(), [&](const Party& party) { return party.id == partyId; });
+        return it != queue.end() ? &*it : nullptr;
+    }
+
+    // When the table is expected free, or 0 if it is free
+    int64_t freeAt(int tableNumber) const {
+        auto it = turns.find(tableNumber);
+        return it != turns.end() ? it->second.freeAt : 0;
+    }
+
+    size_t waiting() const { return queue.size(); }
+
+    // The waiting parties in arrival order, with the tables they were last matched to
+    const std::deque<Party>& parties() const { return queue; }
+
+    // Gives each waiting party, first come first served, the table that can take it
+    // soonest: the first one in each capacity's queue not already promised to a party
+    // ahead and not booked by a reservation for the party's stay, with a seat too many
+    // costing kSeatMinutes. Each capacity's queue is walked from where the previous
+    // party's search stopped, so one match costs about parties x capacities.
+    void match(int64_t now, const ReservationBook& book) {
+        if (!stale && now == matchedAt) return;
+        matches++;
+        std::map<int, std::set<std::pair<int64_t, int>>::const_iterator> cursors;
+        for (const auto& [capacity, line] : byCapacity) cursors[capacity] = line.begin();
+        for (auto& party : queue) {
+            party.table = -1;
+            int64_t bestScore = 0;
+            for (auto line = byCapacity.lower_bound(party.size); line != byCapacity.end(); ++line) {
+                auto& cursor = cursors[line->first];
+                while (cursor != line->second.end() && turns[cursor->second].claimedIn == matches) ++cursor;
+                for (auto entry = cursor; entry != line->second.end(); ++entry) {
+                    TableTurn& turn = turns[entry->second];
+                    if (turn.claimedIn == matches) continue;
+                    int64_t from = std::max(entry->first, now);
+                    if (!book.isFree(entry->second, from, from + seatedMinutes(turn.location, party.size))) continue;
+                    int64_t score = from + static_cast<int64_t>(line->first - party.size) * kSeatMinutes;
+                    if (party.table < 0 || score < bestScore) {
+                        party.table = entry->second;
+                        party.seatedBy = from;
+                        bestScore = score;
+                    }
+                    break;
+                }
+            }
+            if (party.table >= 0) turns[party.table].claimedIn = matches;
+        }
+        stale = false;
+        matchedAt = now;
+    }
+
+    // The occupied tables by when they should turn, then the parties waiting; call
+    // match() first
+    void display(int64_t now, std::ostream& out) const {
+        std::vector<std::pair<int64_t, int>> occupied;
+        for (const auto& [capacity, line] : byCapacity) {
+            for (const auto& entry : line) {
+                if (turns.at(entry.second).occupied) occupied.push_back(entry);
+            }
+        }
+        std::sort(occupied.begin(), occupied.end());
+        auto clock = [now](int64_t at) {
+            return at <= now ? std::string("now") : formatClock(static_cast<int>(at % 1440)) + " (" +
+                                                        std::to_string(at - now) + " min)";
+        };
+        out << "\n=== Table Turns ===\n";
+        if (occupied.empty()) out << "Every table is free.\n";
+        for (const auto& [at, tableNumber] : occupied) {
+            const TableTurn& turn = turns.at(tableNumber);
+            out << "Table " << std::left << std::setw(5) << tableNumber << std::setw(16)
+                << locationNames[turn.location] << "party " << std::setw(4) << turn.party << std::setw(14)
+                << stage(turn) << std::right << "free " << clock(at) << '\n';
+        }
+        out << "\n=== Waitlist ===\n";
+        if (queue.empty()) out << "Nobody is waiting.\n";
+        for (const auto& party : queue) {
+            out << std::left << std::setw(6) << party.id << std::setw(20) << party.name << "party " << std::setw(4)
+                << party.size << "waiting " << std::setw(8) << (std::to_string(now - party.joinedAt) + " min")
+                << std::right;
+            if (party.table < 0) out << "no table seats " << party.size << '\n';
+            else out << "table " << party.table << " " << clock(party.seatedBy) << '\n';
+        }
+    }
+
+    void clearTables() {
+        turns.clear();
+        byCapacity.clear();
+        tableOfOrder.clear();
+        stale = true;
+    }
+};
+
+// Running totals for one business day, updated as orders are paid
+struct DailySummary {
+    int64_t revenueCents = 0;
+    int ordersCompleted = 0;
+    int customersServed = 0;
+    std::unordered_map<std::string, int> itemCounts;     // item ID -> quantity sold
+    std::unordered_map<std::string, int> categoryCounts; // category -> quantity sold
+
+    // In cents, rounded half away from zero
+    int64_t averageTicket() const {
+        if (ordersCompleted <= 0) return 0;
+        int64_t half = (revenueCents < 0 ? -ordersCompleted : ordersCompleted) / 2;
+        return (revenueCents + half) / ordersCompleted;
+    }
+};
+
+// Sales history for analytics: one row per order line of every paid order, each field
+// in its own narrow column. Rows fill blocks of kBlockRows; a full block is sealed and
+// never changes again, so a query copies the block list under the lock and reads it
+// without one. Each block stores its days as runs (rows arrive in day order) and keeps
+// its day range, so date-range queries skip whole blocks. A refund appends the order's
+// rows again with quantity, customers and order count negated.
+class SalesHistory {
+public:
+    static const size_t kBlockRows = 16384;
+
+    struct Line {
+        uint32_t item; // menu position
+        int quantity;
+        int64_t priceCents;
+    };
+
+    // Summed over the rows with one key
+    struct Total {
+        int64_t revenueCents = 0;
+        int64_t quantity = 0;
+        int64_t orders = 0;
+        int64_t customers = 0;
+    };
+
+    struct Block {
+        int firstDay = INT32_MAX;
+        int lastDay = INT32_MIN;
+        std::vector<std::pair<int32_t, uint32_t>> dayRuns; // day, rows in the run
+        std::vector<uint8_t> hours;
+        std::vector<int32_t> tables;
+        std::vector<uint32_t> items;
+        std::vector<int16_t> quantities;
+        std::vector<int32_t> priceCents;
+        std::vector<int16_t> customers; // on an order's first row, 0 on the others
+        std::vector<int8_t> orders;     // 1 on an order's first row (-1 when refunded)
+
+        size_t size() const { return hours.size(); }
+    };
+
+private:
+    mutable std::mutex lock;
+    std::vector<std::shared_ptr<const Block>> sealed;
+    std::shared_ptr<Block> active = std::make_shared<Block>();
+    int maxTable = 0;
+
+public:
+    // Records a paid order (sign 1) or takes it back out (sign -1). placeOrder and the menu
+    // import bound quantities, party sizes and prices, so each fits its narrow column.
+    void addOrder(int day, int hour, int table, int customers, const std::vector<Line>& lines, int sign) {
+        std::lock_guard<std::mutex> guard(lock);
+        maxTable = std::max(maxTable, table);
+        for (size_t i = 0; i < lines.size(); i++) {
+            Block& block = *active;
+            if (block.dayRuns.empty() || block.dayRuns.back().first != day) block.dayRuns.push_back({day, 0});
+            block.dayRuns.back().second++;
+            block.firstDay = std::min(block.firstDay, day);
+            block.lastDay = std::max(block.lastDay, day);
+            block.hours.push_back(static_cast<uint8_t>(hour));
+            block.tables.push_back(table);
+            block.items.push_back(lines[i].item);
+            block.quantities.push_back(static_cast<int16_t>(sign * lines[i].quantity));
+            block.priceCents.push_back(static_cast<int32_t>(lines[i].priceCents));
+            block.customers.push_back(static_cast<int16_t>(i == 0 ? sign * customers : 0));
+            block.orders.push_back(static_cast<int8_t>(i == 0 ? sign : 0));
+            if (block.size() == kBlockRows) {
+                sealed.push_back(std::move(active));
+                active = std::make_shared<Block>();
+            }
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> guard(lock);
+        sealed.clear();
+        active = std::make_shared<Block>();
+        maxTable = 0;
+    }
+
+    size_t rows() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return sealed.size() * kBlockRows + active->size();
+    }
+
+    // Bytes held by the columns
+    size_t bytes() const {
+        std::lock_guard<std::mutex> guard(lock);
+        size_t total = 0;
+        auto add = [&total](const Block& block) {
+            total += block.dayRuns.size() * sizeof(block.dayRuns[0]) +
+                     block.size() * (sizeof(uint8_t) + sizeof(int32_t) + sizeof(uint32_t) + sizeof(int16_t) +
+                                     sizeof(int32_t) + sizeof(int16_t) + sizeof(int8_t));
+        };
+        for (const auto& block : sealed) add(*block);
+        add(*active);
+        return total;
+    }
+
+    int tableLimit() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return maxTable + 1;
+    }
+
+    // Sums the rows from fromDay to toDay (inclusive) into keyCount totals, key(block, row,
+    // day) choosing each row's total. The blocks are split across up to `threads` threads,
+    // each summing into its own totals, which are merged at the end.
+    template <typename Key>
+    std::vector<Total> aggregate(int fromDay, int toDay, size_t keyCount, Key key, unsigned threads) const {
+        std::vector<std::shared_ptr<const Block>> blocks;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (const auto& block : sealed) {
+                if (block->lastDay >= fromDay && block->firstDay <= toDay) blocks.push_back(block);
+            }
+            if (active->size() > 0 && active->lastDay >= fromDay && active->firstDay <= toDay) {
+                blocks.push_back(std::make_shared<Block>(*active)); // still being filled
+            }
+        }
+
+        threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(blocks.size())));
+        std::vector<std::vector<Total>> partial(threads, std::vector<Total>(keyCount));
+        auto work = [&](unsigned worker) {
+            std::vector<Total>& totals = partial[worker];
+            for (size_t b = worker; b < blocks.size(); b += threads) {
+                const Block& block = *blocks[b];
+                size_t row = 0;
+                for (const auto& [day, count] : block.dayRuns) {
+                    size_t end = row + count;
+                    if (day >= fromDay && day <= toDay) {
+                        for (; row < end; row++) {
+                            size_t k = key(block, row, day);
+                            if (k >= keyCount) continue;
+                            Total& total = totals[k];
+                            total.revenueCents += int64_t(block.quantities[row]) * block.priceCents[row];
+                            total.quantity += block.quantities[row];
+                            total.orders += block.orders[row];
+                            total.customers += block.customers[row];
+                        }
+                    }
+                    row = end;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned worker = 1; worker < threads; worker++) workers.emplace_back(work, worker);
+        work(0);
+        for (auto& worker : workers) worker.join();
+
+        for (unsigned worker = 1; worker < threads; worker++) {
+            for (size_t k = 0; k < keyCount; k++) {
+                partial[0][k].revenueCents += partial[worker][k].revenueCents;
+                partial[0][k].quantity += partial[worker][k].quantity;
+                partial[0][k].orders += partial[worker][k].orders;
+                partial[0][k].customers += partial[worker][k].customers;
+            }
+        }
+        return std::move(partial[0]);
+    }
+};
+
+// Compact binary encoding used by the journal.
+// Integers are LEB128 varints (signed ones zigzagged), strings are length-prefixed.
+class RecordWriter {
+private:
+    std::string buffer;
+
+public:
+    void putByte(uint8_t value) {
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    void putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            putByte(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        putByte(static_cast<uint8_t>(value));
+    }
+
+    void putInt(int64_t value) {
+        putVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void putString(std::string_view value) {
+        putVarint(value.size());
+        buffer.append(value.data(), value.size());
+    }
+
+    const std::string& data() const { return buffer; }
+    bool empty() const { return buffer.empty(); }
+    void clear() { buffer.clear(); }
+};
+
+class RecordReader {
+private:
+    const char* pos;
+    const char* end;
+    bool valid;
+
+public:
+    RecordReader(const char* data, size_t length) : pos(data), end(data + length), valid(true) {}
+
+    uint8_t getByte() {
+        if (pos >= end) {
+            valid = false;
+            return 0;
+        }
+        return static_cast<uint8_t>(*pos++);
+    }
+
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = getByte();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        valid = false;
+        return 0;
+    }
+
+    int64_t getInt() {
+        uint64_t raw = getVarint();
+        return static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    }
+
+    // Only journals before version 5 hold doubles
+    double getDouble() {
+        double value = 0.0;
+        if (end - pos < static_cast<ptrdiff_t>(sizeof(double))) {
+            valid = false;
+            return value;
+        }
+        std::memcpy(&value, pos, sizeof(double));
+        pos += sizeof(double);
+        return value;
+    }
+
+    std::string getString() {
+        uint64_t length = getVarint();
+        if (!valid || static_cast<uint64_t>(end - pos) < length) {
+            valid = false;
+            return "";
+        }
+        std::string value(pos, length);
+        pos += length;
+        return value;
+    }
+
+    bool atEnd() const { return pos >= end; }
+    bool ok() const { return valid; }
+};
+
+uint32_t crc32(const char* data, size_t length) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+enum class JournalRecord : uint8_t {
+    OrderCreated = 1,   // orderId, table, business day, minute of day, customers, placed at (unix seconds)
+    ItemAdded,          // orderId, itemId, quantity, unit price in cents
+    InstructionsAdded,  // orderId, text
+    StatusUpdated,      // orderId, OrderStatus, unix seconds
+    ReservationMade,    // reservationId, name, phone, party size, day, minute of day, minutes, table, requests
+    TableOccupied,      // table
+    TableFreed,         // table
+    StockAdjusted,      // ingredient, change in units (a count is journaled as the difference)
+    RecipeSet           // itemId, component count, then ingredient and amount per component
+};
+
+// The journal starts with a 4-byte magic, a 4-byte format version and an 8-byte generation,
+// followed by frames of [length][crc32][records]. A frame holds every record of one operation, so an operation
+// is replayed all or nothing. A snapshot of generation G covers the journal of
+// generation G; a checkpoint moves that journal aside and goes on at G + 1.
+const uint32_t kJournalMagic = 0x4a534d52; // "RMSJ"
+const uint32_t kJournalVersion = 5;
+// Version 4 kept dates and times as strings and prices as doubles; it is still replayed
+const uint32_t kOldestJournalVersion = 4;
+const size_t kJournalHeaderSize = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+const size_t kFrameHeaderSize = 2 * sizeof(uint32_t);
+
+std::string journalHeader(uint64_t generation) {
+    std::string header(kJournalHeaderSize, '\0');
+    std::memcpy(&header[0], &kJournalMagic, sizeof(kJournalMagic));
+    std::memcpy(&header[sizeof(uint32_t)], &kJournalVersion, sizeof(kJournalVersion));
+    std::memcpy(&header[2 * sizeof(uint32_t)], &generation, sizeof(generation));
+    return header;
+}
+
+void appendFrame(std::string& out, const std::string& payload) {
+    uint32_t header[2] = {static_cast<uint32_t>(payload.size()), crc32(payload.data(), payload.size())};
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+    out.append(payload);
+}
+
+// Reads the journal generation and version, then calls apply for every intact frame.
+// Returns the offset just past the last intact frame (0 if the file is missing or empty),
+// or -1 if the file is not a journal of a version this build reads.
+int64_t readFrames(const std::string& path, uint64_t& generation, uint32_t& version,
+                   const std::function<void(RecordReader&)>& apply) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return 0;
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (contents.empty()) return 0;
+
+    uint32_t fileMagic = 0;
+    if (contents.size() < kJournalHeaderSize) return -1;
+    std::memcpy(&fileMagic, contents.data(), sizeof(fileMagic));
+    std::memcpy(&version, contents.data() + sizeof(uint32_t), sizeof(version));
+    if (fileMagic != kJournalMagic || version < kOldestJournalVersion || version > kJournalVersion) return -1;
+    std::memcpy(&generation, contents.data() + 2 * sizeof(uint32_t), sizeof(generation));
+
+    size_t offset = kJournalHeaderSize;
+    while (contents.size() - offset >= kFrameHeaderSize) {
+        uint32_t header[2];
+        std::memcpy(header, contents.data() + offset, sizeof(header));
+        const char* payload = contents.data() + offset + kFrameHeaderSize;
+        if (contents.size() - offset - kFrameHeaderSize < header[0] ||
+            crc32(payload, header[0]) != header[1]) {
+            break; // torn or corrupt tail
+        }
+        RecordReader reader(payload, header[0]);
+        apply(reader);
+        offset += kFrameHeaderSize + header[0];
+    }
+    return static_cast<int64_t>(offset);
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Append-only write-ahead journal with group commit. Callers append a frame and wait
+// for it to become durable; a committer thread writes everything queued since its
+// last pass with a single write() + fdatasync(), so concurrent bursts share one sync.
+class Journal {
+private:
+    int fd;
+    std::string pending;
+    uint64_t appendedSeq;
+    uint64_t durableSeq;
+    bool stopping;
+    bool failed;
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable committed;
+    std::thread committer;
+
+    void commitLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workAvailable.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break; // stopping with nothing left to write
+
+            std::string batch;
+            batch.swap(pending);
+            uint64_t batchSeq = appendedSeq;
+            lock.unlock();
+            bool ok = writeAll(fd, batch) && ::fdatasync(fd) == 0;
+            lock.lock();
+
+            if (!ok && !failed) {
+                failed = true;
+                std::cerr << "Journal write failed; changes are no longer durable." << std::endl;
+            }
+            durableSeq = batchSeq;
+            committed.notify_all();
+        }
+    }
+
+public:
+    // validLength is the replayed prefix of an existing journal; anything after it is a
+    // torn tail from a crash and is cut off before new frames are appended. Without a
+    // usable prefix the file is started over at the given generation.
+    Journal(const std::string& path, int64_t validLength, uint64_t generation)
+        : fd(-1), appendedSeq(0), durableSeq(0), stopping(false), failed(false) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            failed = true;
+            std::cerr << "Could not open journal " << path << std::endl;
+            return;
+        }
+        if (validLength <= 0) {
+            if (::ftruncate(fd, 0) != 0 || !writeAll(fd, journalHeader(generation))) {
+                failed = true;
+            }
+        } else if (::ftruncate(fd, validLength) != 0) {
+            failed = true;
+        }
+        ::fdatasync(fd);
+        committer = std::thread(&Journal::commitLoop, this);
+    }
+
+    ~Journal() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_one();
+        if (committer.joinable()) committer.join();
+        if (fd >= 0) ::close(fd);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    uint64_t append(const RecordWriter& records) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool wasIdle = pending.empty();
+        appendFrame(pending, records.data());
+        if (wasIdle) workAvailable.notify_one();
+        return ++appendedSeq;
+    }
+
+    bool waitDurable(uint64_t seq) {
+        std::unique_lock<std::mutex> lock(mutex);
+        committed.wait(lock, [this, seq] { return durableSeq >= seq || fd < 0; });
+        return !failed;
+    }
+
+    // Waits until every frame appended so far has been written and synced
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        committed.wait(lock, [this] { return (pending.empty() && durableSeq == appendedSeq) || fd < 0; });
+    }
+
+    // Renames the journal to segmentPath and goes on in a new file at path, started at
+    // generation. The segment keeps its frames until a snapshot covers them.
+    bool rotate(const std::string& path, const std::string& segmentPath, uint64_t generation) {
+        std::unique_lock<std::mutex> lock(mutex);
+        committed.wait(lock, [this] { return (pending.empty() && durableSeq == appendedSeq) || fd < 0; });
+        if (fd < 0 || std::rename(path.c_str(), segmentPath.c_str()) != 0) {
+            failed = true;
+            return false;
+        }
+        int next = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_TRUNC, 0644);
+        if (next < 0 || !writeAll(next, journalHeader(generation)) || ::fdatasync(next) != 0) {
+            if (next >= 0) ::close(next);
+            failed = true;
+            return false;
+        }
+        ::close(fd);
+        fd = next;
+        return true;
+    }
+
+    bool healthy() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !failed;
+    }
+};
+
+// Versioned, fixed-layout snapshot of the whole restaurant. The file is a header followed
+// by arrays of the POD records below plus one string pool, all 8-byte aligned, so it is
+// mmapped and read in place: opening it costs page faults, not parsing. Strings are
+// (offset, length) references into the pool.
+const uint32_t kSnapshotMagic = 0x53534d52; // "RMSS"
+const uint32_t kSnapshotVersion = 7;
+const uint32_t kOldestSnapshotVersion = 4; // older files are rewritten at startup, see SnapshotBuilder::upgrade
+
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SnapshotMenuItem {
+    int64_t priceCents;
+    SnapshotString itemId;
+    SnapshotString name;
+    SnapshotString category;
+    SnapshotString description;
+    int32_t preparationTime;
+    int32_t spiceLevel;
+    int32_t calories;
+    uint32_t offered; // on the menu; whether it is 86'd follows from the stock
+    uint32_t firstIngredient; // ranges in the string list section
+    uint32_t ingredientCount;
+    uint32_t firstAllergen;
+    uint32_t allergenCount;
+};
+
+struct SnapshotTable {
+    int32_t tableNumber;
+    int32_t capacity;
+    uint32_t occupied;
+    uint32_t reserved;
+    SnapshotString location;
+    SnapshotString specialFeatures;
+};
+
+// Sorted by orderNumber so a single order is found by binary search
+struct SnapshotOrder {
+    int64_t totalCents;
+    uint32_t orderNumber;
+    int32_t tableNumber;
+    int32_t customerCount;
+    uint32_t lineCount;
+    uint64_t firstLine;
+    int32_t orderDay;    // business day, days since 1970-01-01
+    int32_t orderMinute; // minute of day
+    SnapshotString specialInstructions;
+    uint8_t status; // OrderStatus
+    uint8_t reserved[3];
+    uint32_t statusTimes[kOrderStatusCount]; // unix seconds, 0 if never entered
+};
+
+struct SnapshotOrderLine {
+    int64_t unitCents;
+    SnapshotString itemId;
+    int32_t quantity;
+    uint32_t reserved;
+};
+
+// Per-day report totals, sorted by day
+struct SnapshotDay {
+    int64_t revenueCents;
+    int32_t day;
+    int32_t ordersCompleted;
+    int32_t customersServed;
+    uint32_t firstCount;    // item counts, then category counts, in the count section
+    uint32_t itemCountCount;
+    uint32_t categoryCountCount;
+};
+
+struct SnapshotCount {
+    SnapshotString key;
+    int32_t quantity;
+    uint32_t reserved;
+};
+
+struct SnapshotStock {
+    int64_t quantity;
+    SnapshotString ingredient;
+    uint32_t tracked;
+    uint32_t reserved;
+};
+
+// Grouped by item
+struct SnapshotRecipeLine {
+    SnapshotString itemId;
+    SnapshotString ingredient;
+    int32_t amount;
+    uint32_t reserved;
+};
+
+// Sorted by date and time, so upcoming reservations are a suffix
+struct SnapshotReservation {
+    uint32_t reservationNumber;
+    int32_t partySize;
+    int32_t tableNumber;
+    int32_t durationMinutes;
+    SnapshotString customerName;
+    SnapshotString phone;
+    int32_t day;
+    int32_t minute;
+    SnapshotString specialRequests;
+};
+
+enum SnapshotSectionId {
+    kSnapshotMenu,
+    kSnapshotStringLists, // SnapshotString entries for ingredients and allergens
+    kSnapshotTables,
+    kSnapshotOrders,
+    kSnapshotOrderLines,
+    kSnapshotOpenOrders,  // uint32_t indexes of orders that are not paid yet
+    kSnapshotReservations,
+    kSnapshotDays,
+    kSnapshotCounts,
+    kSnapshotStock,
+    kSnapshotRecipes,
+    kSnapshotStrings,     // raw characters
+    kSnapshotSectionCount
+};
+
+const size_t kSnapshotElementSize[kSnapshotSectionCount] = {
+    sizeof(SnapshotMenuItem), sizeof(SnapshotString), sizeof(SnapshotTable), sizeof(SnapshotOrder),
+    sizeof(SnapshotOrderLine), sizeof(uint32_t), sizeof(SnapshotReservation), sizeof(SnapshotDay),
+    sizeof(SnapshotCount), sizeof(SnapshotStock), sizeof(SnapshotRecipeLine), sizeof(char)
+};
+
+struct SnapshotSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation; // journal generation this snapshot covers
+    uint64_t fileSize;
+    uint32_t nextOrderId;
+    uint32_t nextReservationId;
+    SnapshotSection sections[kSnapshotSectionCount];
+};
+
+static_assert(sizeof(SnapshotMenuItem) == 72 && sizeof(SnapshotTable) == 32 &&
+              sizeof(SnapshotOrder) == 80 && sizeof(SnapshotOrderLine) == 24 &&
+              sizeof(SnapshotReservation) == 48 && sizeof(SnapshotDay) == 32 &&
+              sizeof(SnapshotCount) == 16 && sizeof(SnapshotStock) == 24 &&
+              sizeof(SnapshotRecipeLine) == 24 && sizeof(SnapshotHeader) == 224,
+              "snapshot records must keep their on-disk layout");
+
+// Records as snapshot versions 4 and 5 laid them out, with money as doubles and dates and
+// times as strings; menu items and order lines kept their layout with a double in place
+// of the cents. Read only to upgrade an older file.
+struct SnapshotOrderV5 {
+    double totalAmount;
+    uint32_t orderNumber;
+    int32_t tableNumber;
+    int32_t customerCount;
+    uint32_t lineCount;
+    uint64_t firstLine;
+    SnapshotString orderDate;
+    SnapshotString orderTime;
+    SnapshotString specialInstructions;
+    uint8_t status;
+    uint8_t reserved[3];
+    uint32_t statusTimes[kOrderStatusCount];
+};
+
+struct SnapshotDayV5 {
+    double revenue;
+    SnapshotString date;
+    int32_t ordersCompleted;
+    int32_t customersServed;
+    uint32_t firstCount;
+    uint32_t itemCountCount;
+    uint32_t categoryCountCount;
+    uint32_t reserved;
+};
+
+struct SnapshotReservationV5 {
+    uint32_t reservationNumber;
+    int32_t partySize;
+    int32_t tableNumber;
+    int32_t durationMinutes;
+    SnapshotString customerName;
+    SnapshotString phone;
+    SnapshotString date;
+    SnapshotString time;
+    SnapshotString specialRequests;
+};
+
+static_assert(sizeof(SnapshotOrderV5) == 88 && sizeof(SnapshotDayV5) == 40 && sizeof(SnapshotReservationV5) == 56,
+              "old snapshot records must keep their on-disk layout");
+
+// Read-only mapping of a snapshot file
+class SnapshotFile {
+private:
+    void* base;
+    size_t size;
+
+    SnapshotFile(void* mapping, size_t length) : base(mapping), size(length) {}
+
+    // Whether first + count stays within a section of total entries
+    static bool inRange(uint64_t first, uint64_t count, uint64_t total) {
+        return first <= total && count <= total - first;
+    }
+
+    // Checks every range a record points into another section with, and every value
+    // used as an index, so a damaged file is refused instead of read out of bounds.
+    // Reads each record once; strings need no check, str() bounds them on every use.
+    // Returns what is wrong, or an empty string.
+    std::string checkRecords() const {
+        const SnapshotMenuItem* items = section<SnapshotMenuItem>(kSnapshotMenu);
+        for (size_t i = 0; i < count(kSnapshotMenu); i++) {
+            if (!inRange(items[i].firstIngredient, items[i].ingredientCount, count(kSnapshotStringLists)) ||
+                !inRange(items[i].firstAllergen, items[i].allergenCount, count(kSnapshotStringLists))) {
+                return "a corrupt menu item";
+            }
+        }
+        const SnapshotOrder* orders = section<SnapshotOrder>(kSnapshotOrders);
+        for (size_t i = 0; i < count(kSnapshotOrders); i++) {
+            if (!inRange(orders[i].firstLine, orders[i].lineCount, count(kSnapshotOrderLines)) ||
+                orders[i].status >= kOrderStatusCount) {
+                return "a corrupt order";
+            }
+        }
+        const SnapshotDay* days = section<SnapshotDay>(kSnapshotDays);
+        for (size_t i = 0; i < count(kSnapshotDays); i++) {
+            if (!inRange(days[i].firstCount, uint64_t(days[i].itemCountCount) + days[i].categoryCountCount,
+                         count(kSnapshotCounts))) {
+                return "a corrupt daily summary";
+            }
+        }
+        return {};
+    }
+
+public:
+    ~SnapshotFile() {
+        ::munmap(base, size);
+    }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    // Returns null with an empty error if the file does not exist
+    static std::unique_ptr<SnapshotFile> open(const std::string& path, std::string& error) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+            ::close(fd);
+            error = path + " is too short to be a snapshot";
+            return nullptr;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = "could not map " + path;
+            return nullptr;
+        }
+        std::unique_ptr<SnapshotFile> file(new SnapshotFile(mapping, length));
+
+        const SnapshotHeader& header = file->header();
+        if (header.magic != kSnapshotMagic) {
+            error = path + " is not a snapshot file";
+            return nullptr;
+        }
+        if (header.version != kSnapshotVersion) {
+            error = path + " has snapshot version " + std::to_string(header.version) +
+                    ", expected " + std::to_string(kSnapshotVersion);
+            return nullptr;
+        }
+        if (header.fileSize != length) {
+            error = path + " is truncated";
+            return nullptr;
+        }
+        for (int id = 0; id < kSnapshotSectionCount; id++) {
+            const SnapshotSection& section = header.sections[id];
+            if (section.offset % 8 != 0 || section.offset > length ||
+                section.count > (length - section.offset) / kSnapshotElementSize[id]) {
+                error = path + " has a corrupt section table";
+                return nullptr;
+            }
+        }
+        std::string problem = file->checkRecords();
+        if (!problem.empty()) {
+            error = path + " has " + problem;
+            return nullptr;
+        }
+        return file;
+    }
+
+    const SnapshotHeader& header() const {
+        return *static_cast<const SnapshotHeader*>(base);
+    }
+
+    template <typename T>
+    const T* section(SnapshotSectionId id) const {
+        return reinterpret_cast<const T*>(static_cast<const char*>(base) + header().sections[id].offset);
+    }
+
+    size_t count(SnapshotSectionId id) const {
+        return header().sections[id].count;
+    }
+
+    std::string_view str(SnapshotString ref) const {
+        size_t poolSize = count(kSnapshotStrings);
+        if (ref.offset > poolSize || ref.length > poolSize - ref.offset) return {};
+        return std::string_view(section<char>(kSnapshotStrings) + ref.offset, ref.length);
+    }
+};
+
+// Accumulates records for a new snapshot and lays them out in the file format
+class SnapshotBuilder {
+private:
+    SnapshotHeader header;
+    std::vector<SnapshotMenuItem> menu;
+    std::vector<SnapshotString> stringLists;
+    std::vector<SnapshotTable> tables;
+    std::vector<SnapshotOrder> orders;
+    std::vector<SnapshotOrderLine> orderLines;
+    std::vector<uint32_t> openOrders;
+    std::vector<SnapshotReservation> reservations;
+    std::vector<SnapshotDay> days;
+    std::vector<SnapshotCount> counts;
+    std::vector<SnapshotStock> stock;
+    std::vector<SnapshotRecipeLine> recipes;
+    std::string strings;
+    std::unordered_map<std::string, SnapshotString> pooled; // item ids and names repeat a lot
+
+    template <typename T>
+    static void appendSection(std::string& out, SnapshotSection& section, const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot sections are raw copies");
+        out.resize((out.size() + 7) & ~static_cast<size_t>(7), '\0');
+        section.offset = out.size();
+        section.count = count;
+        out.append(reinterpret_cast<const char*>(items), count * sizeof(T));
+    }
+
+public:
+    SnapshotBuilder(uint64_t generation, int nextOrderId, int nextReservationId) {
+        std::memset(&header, 0, sizeof(header));
+        header.magic = kSnapshotMagic;
+        header.version = kSnapshotVersion;
+        header.generation = generation;
+        header.nextOrderId = static_cast<uint32_t>(nextOrderId);
+        header.nextReservationId = static_cast<uint32_t>(nextReservationId);
+    }
+
+    SnapshotString add(std::string_view value) {
+        if (value.empty()) return {0, 0};
+        auto it = pooled.find(std::string(value));
+        if (it != pooled.end()) return it->second;
+        SnapshotString ref = {static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(value.size())};
+        strings.append(value.data(), value.size());
+        pooled.emplace(std::string(value), ref);
+        return ref;
+    }
+
+    void addMenuItem(const MenuCatalog& catalog, uint32_t index, bool offered) {
+        SnapshotMenuItem record = {};
+        record.priceCents = catalog.priceCents(index);
+        record.itemId = add(catalog.itemId(index));
+        record.name = add(catalog.name(index));
+        record.category = add(catalog.category(index));
+        record.description = add(catalog.description(index));
+        record.preparationTime = catalog.preparationTime(index);
+        record.spiceLevel = catalog.spiceLevel(index);
+        record.calories = catalog.calories(index);
+        record.offered = offered;
+        record.firstIngredient = static_cast<uint32_t>(stringLists.size());
+        record.ingredientCount = static_cast<uint32_t>(catalog.ingredients(index).size());
+        for (uint32_t symbol : catalog.ingredients(index)) stringLists.push_back(add(catalog.symbolName(symbol)));
+        record.firstAllergen = static_cast<uint32_t>(stringLists.size());
+        record.allergenCount = static_cast<uint32_t>(catalog.allergens(index).size());
+        for (uint32_t symbol : catalog.allergens(index)) stringLists.push_back(add(catalog.symbolName(symbol)));
+        menu.push_back(record);
+    }
+
+    void addTable(const Table& table) {
+        SnapshotTable record = {};
+        record.tableNumber = table.getTableNumber();
+        record.capacity = table.getCapacity();
+        record.occupied = table.getOccupancy();
+        record.location = add(table.getLocation());
+        record.specialFeatures = add(table.getSpecialFeatures());
+        tables.push_back(record);
+    }
+
+    // Orders must be added in ascending order number, after the whole menu: their lines
+    // name items by menu position
+    void addOrder(uint32_t orderNumber, const Order& order) {
+        SnapshotOrder record = {};
+        record.totalCents = order.getTotalCents();
+        record.orderNumber = orderNumber;
+        record.tableNumber = order.getTableNumber();
+        record.customerCount = order.getCustomerCount();
+        record.firstLine = orderLines.size();
+        record.lineCount = static_cast<uint32_t>(order.getItems().size());
+        record.orderDay = order.getOrderDay();
+        record.orderMinute = order.getOrderMinute();
+        record.specialInstructions = add(order.getSpecialInstructions());
+        record.status = static_cast<uint8_t>(order.getStatus());
+        for (size_t i = 0; i < kOrderStatusCount; i++) {
+            record.statusTimes[i] = static_cast<uint32_t>(order.getStatusTime(static_cast<OrderStatus>(i)));
+        }
+        for (const auto& line : order.getItems()) {
+            orderLines.push_back({line.unitCents, menu[line.menuIndex].itemId, line.quantity, 0});
+        }
+        if (isOpenStatus(order.getStatus())) openOrders.push_back(static_cast<uint32_t>(orders.size()));
+        orders.push_back(record);
+    }
+
+    // Carries an untouched order over from the previous snapshot
+    void copyOrder(const SnapshotFile& from, const SnapshotOrder& source) {
+        SnapshotOrder record = source;
+        record.firstLine = orderLines.size();
+        record.specialInstructions = add(from.str(source.specialInstructions));
+        const SnapshotOrderLine* lines = from.section<SnapshotOrderLine>(kSnapshotOrderLines) + source.firstLine;
+        for (uint32_t i = 0; i < source.lineCount; i++) {
+            orderLines.push_back({lines[i].unitCents, add(from.str(lines[i].itemId)), lines[i].quantity, 0});
+        }
+        if (isOpenStatus(static_cast<OrderStatus>(source.status))) {
+            openOrders.push_back(static_cast<uint32_t>(orders.size()));
+        }
+        orders.push_back(record);
+    }
+
+    void addReservation(uint32_t reservationNumber, const Reservation& reservation) {
+        SnapshotReservation record = {};
+        record.reservationNumber = reservationNumber;
+        record.partySize = reservation.getPartySize();
+        record.tableNumber = reservation.getTableNumber();
+        record.durationMinutes = reservation.getDurationMinutes();
+        record.customerName = add(reservation.getCustomerName());
+        record.phone = add(reservation.getPhone());
+        record.day = reservation.getReservationDay();
+        record.minute = reservation.getReservationMinute();
+        record.specialRequests = add(reservation.getSpecialRequests());
+        reservations.push_back(record);
+    }
+
+    void copyReservation(const SnapshotFile& from, const SnapshotReservation& source) {
+        SnapshotReservation record = source;
+        record.customerName = add(from.str(source.customerName));
+        record.phone = add(from.str(source.phone));
+        record.specialRequests = add(from.str(source.specialRequests));
+        reservations.push_back(record);
+    }
+
+    // Days must be added in ascending order
+    void addDay(int day, const DailySummary& summary) {
+        SnapshotDay record = {};
+        record.revenueCents = summary.revenueCents;
+        record.day = day;
+        record.ordersCompleted = summary.ordersCompleted;
+        record.customersServed = summary.customersServed;
+        record.firstCount = static_cast<uint32_t>(counts.size());
+        record.itemCountCount = static_cast<uint32_t>(summary.itemCounts.size());
+        record.categoryCountCount = static_cast<uint32_t>(summary.categoryCounts.size());
+        for (const auto& [itemId, quantity] : summary.itemCounts) counts.push_back({add(itemId), quantity, 0});
+        for (const auto& [category, quantity] : summary.categoryCounts) counts.push_back({add(category), quantity, 0});
+        days.push_back(record);
+    }
+
+    void copyDay(const SnapshotFile& from, const SnapshotDay& source) {
+        SnapshotDay record = source;
+        record.firstCount = static_cast<uint32_t>(counts.size());
+        const SnapshotCount* sourceCounts = from.section<SnapshotCount>(kSnapshotCounts) + source.firstCount;
+        for (uint32_t i = 0; i < source.itemCountCount + source.categoryCountCount; i++) {
+            counts.push_back({add(from.str(sourceCounts[i].key)), sourceCounts[i].quantity, 0});
+        }
+        days.push_back(record);
+    }
+
+    void addStock(const Inventory& inventory, uint32_t ingredient) {
+        stock.push_back({inventory.onHand(ingredient), add(inventory.name(ingredient)), inventory.isTracked(ingredient), 0});
+    }
+
+    void addRecipe(const MenuCatalog& catalog, const Inventory& inventory, uint32_t item) {
+        for (const auto& component : inventory.recipe(item)) {
+            recipes.push_back({add(catalog.itemId(item)), add(inventory.name(component.ingredient)), component.amount, 0});
+        }
+    }
+
+    std::string serialize() {
+        std::stable_sort(reservations.begin(), reservations.end(),
+            [](const SnapshotReservation& a, const SnapshotReservation& b) {
+                return a.day != b.day ? a.day < b.day : a.minute < b.minute;
+            });
+
+        std::string out(sizeof(SnapshotHeader), '\0');
+        appendSection(out, header.sections[kSnapshotMenu], menu.data(), menu.size());
+        appendSection(out, header.sections[kSnapshotStringLists], stringLists.data(), stringLists.size());
+        appendSection(out, header.sections[kSnapshotTables], tables.data(), tables.size());
+        appendSection(out, header.sections[kSnapshotOrders], orders.data(), orders.size());
+        appendSection(out, header.sections[kSnapshotOrderLines], orderLines.data(), orderLines.size());
+        appendSection(out, header.sections[kSnapshotOpenOrders], openOrders.data(), openOrders.size());
+        appendSection(out, header.sections[kSnapshotReservations], reservations.data(), reservations.size());
+        appendSection(out, header.sections[kSnapshotDays], days.data(), days.size());
+        appendSection(out, header.sections[kSnapshotCounts], counts.data(), counts.size());
+        appendSection(out, header.sections[kSnapshotStock], stock.data(), stock.size());
+        appendSection(out, header.sections[kSnapshotRecipes], recipes.data(), recipes.size());
+        appendSection(out, header.sections[kSnapshotStrings], strings.data(), strings.size());
+        header.fileSize = out.size();
+        std::memcpy(&out[0], &header, sizeof(header));
+        return out;
+    }
+
+    // Lays out the contents of an older snapshot file (version 4 to 6) in the current
+    // format. The string pool is kept as it is; dates and times held as strings become
+    // days and minutes, and doubles become cents. Version 4 had no stock, so each item
+    // gets the default recipe, and versions 4 to 6 stored whether an item could be
+    // ordered rather than whether it is on the menu. Returns an empty string, with error
+    // set, if the file is damaged.
+    static std::string upgrade(const std::string& file, std::string& error) {
+        uint32_t version = 0;
+        std::memcpy(&version, file.data() + sizeof(uint32_t), sizeof(version));
+        std::vector<SnapshotSectionId> ids = {kSnapshotMenu, kSnapshotStringLists, kSnapshotTables, kSnapshotOrders,
+                                              kSnapshotOrderLines, kSnapshotOpenOrders, kSnapshotReservations,
+                                              kSnapshotDays, kSnapshotCounts};
+        if (version >= 5) ids.insert(ids.end(), {kSnapshotStock, kSnapshotRecipes});
+        ids.push_back(kSnapshotStrings);
+        size_t headerSize = offsetof(SnapshotHeader, sections) + ids.size() * sizeof(SnapshotSection);
+        if (file.size() < headerSize) {
+            error = "is too short to be a snapshot";
+            return {};
+        }
+        SnapshotHeader old = {};
+        std::memcpy(&old, file.data(), offsetof(SnapshotHeader, sections));
+        for (size_t i = 0; i < ids.size(); i++) {
+            std::memcpy(&old.sections[ids[i]], file.data() + offsetof(SnapshotHeader, sections) + i * sizeof(SnapshotSection),
+                        sizeof(SnapshotSection));
+        }
+        size_t sizes[kSnapshotSectionCount];
+        std::copy(std::begin(kSnapshotElementSize), std::end(kSnapshotElementSize), sizes);
+        if (version <= 5) {
+            sizes[kSnapshotOrders] = sizeof(SnapshotOrderV5);
+            sizes[kSnapshotReservations] = sizeof(SnapshotReservationV5);
+            sizes[kSnapshotDays] = sizeof(SnapshotDayV5);
+        }
+        for (SnapshotSectionId id : ids) {
+            const SnapshotSection& section = old.sections[id];
+            if (old.fileSize != file.size() || section.offset > file.size() ||
+                section.count > (file.size() - section.offset) / sizes[id]) {
+                error = "has a corrupt section table";
+                return {};
+            }
+        }
+        auto records = [&](SnapshotSectionId id, auto& out) {
+            out.resize(old.sections[id].count);
+            if (!out.empty()) std::memcpy(out.data(), file.data() + old.sections[id].offset, out.size() * sizes[id]);
+        };
+        std::string_view pool(file.data() + old.sections[kSnapshotStrings].offset, old.sections[kSnapshotStrings].count);
+        auto text = [&pool](SnapshotString ref) {
+            return ref.offset > pool.size() ? std::string() : std::string(pool.substr(ref.offset, ref.length));
+        };
+        auto cents = [](auto& field) {
+            double amount = 0.0;
+            std::memcpy(&amount, &field, sizeof(amount));
+            field = toCents(amount);
+        };
+
+        SnapshotBuilder builder(old.generation, static_cast<int>(old.nextOrderId), static_cast<int>(old.nextReservationId));
+        records(kSnapshotMenu, builder.menu);
+        records(kSnapshotStringLists, builder.stringLists);
+        records(kSnapshotTables, builder.tables);
+        records(kSnapshotOrderLines, builder.orderLines);
+        records(kSnapshotOpenOrders, builder.openOrders);
+        records(kSnapshotCounts, builder.counts);
+        builder.strings = pool;
+        if (version <= 5) {
+            for (auto& item : builder.menu) cents(item.priceCents);
+            for (auto& line : builder.orderLines) cents(line.unitCents);
+
+            std::vector<SnapshotOrderV5> orders;
+            records(kSnapshotOrders, orders);
+            for (const auto& source : orders) {
+                SnapshotOrder record = {};
+                record.totalCents = toCents(source.totalAmount);
+                record.orderNumber = source.orderNumber;
+                record.tableNumber = source.tableNumber;
+                record.customerCount = source.customerCount;
+                record.lineCount = source.lineCount;
+                record.firstLine = source.firstLine;
+                parseDate(text(source.orderDate), record.orderDay);
+                parseClock(text(source.orderTime), record.orderMinute);
+                record.specialInstructions = source.specialInstructions;
+                record.status = source.status;
+                std::copy(std::begin(source.statusTimes), std::end(source.statusTimes), record.statusTimes);
+                builder.orders.push_back(record);
+            }
+            std::vector<SnapshotReservationV5> reservations;
+            records(kSnapshotReservations, reservations);
+            for (const auto& source : reservations) {
+                SnapshotReservation record = {};
+                record.reservationNumber = source.reservationNumber;
+                record.partySize = source.partySize;
+                record.tableNumber = source.tableNumber;
+                record.durationMinutes = source.durationMinutes;
+                record.customerName = source.customerName;
+                record.phone = source.phone;
+                parseDate(text(source.date), record.day);
+                parseClock(text(source.time), record.minute);
+                record.specialRequests = source.specialRequests;
+                builder.reservations.push_back(record);
+            }
+            std::vector<SnapshotDayV5> days;
+            records(kSnapshotDays, days);
+            for (const auto& source : days) {
+                SnapshotDay record = {};
+                record.revenueCents = toCents(source.revenue);
+                parseDate(text(source.date), record.day);
+                record.ordersCompleted = source.ordersCompleted;
+                record.customersServed = source.customersServed;
+                record.firstCount = source.firstCount;
+                record.itemCountCount = source.itemCountCount;
+                record.categoryCountCount = source.categoryCountCount;
+                builder.days.push_back(record);
+            }
+        } else {
+            records(kSnapshotOrders, builder.orders);
+            records(kSnapshotReservations, builder.reservations);
+            records(kSnapshotDays, builder.days);
+        }
+
+        if (version == 4) {
+            for (const auto& item : builder.menu) {
+                if (item.firstIngredient > builder.stringLists.size() ||
+                    item.ingredientCount > builder.stringLists.size() - item.firstIngredient) {
+                    error = "has a corrupt menu item";
+                    return {};
+                }
+                for (uint32_t k = 0; k < item.ingredientCount; k++) {
+                    builder.recipes.push_back({item.itemId, builder.stringLists[item.firstIngredient + k], 1, 0});
+                }
+            }
+        } else {
+            records(kSnapshotStock, builder.stock);
+            records(kSnapshotRecipes, builder.recipes);
+            // An item that could not be ordered was either 86'd, which the stock still
+            // shows, or a placeholder for an item gone from the menu
+            std::unordered_map<std::string, const SnapshotStock*> stockByName;
+            for (const auto& record : builder.stock) stockByName[text(record.ingredient)] = &record;
+            std::set<std::string> soldOut;
+            for (const auto& line : builder.recipes) {
+                auto stock = stockByName.find(text(line.ingredient));
+                if (stock != stockByName.end() && stock->second->tracked && stock->second->quantity < line.amount) {
+                    soldOut.insert(text(line.itemId));
+                }
+            }
+            for (auto& item : builder.menu) {
+                if (!item.offered && soldOut.count(text(item.itemId))) item.offered = 1;
+            }
+        }
+        return builder.serialize();
+    }
+};
+
+// Rewrites an older snapshot at path in the current format, keeping the original as
+// path.vN. Leaves a missing or current file alone, and one too old or not a snapshot for
+// SnapshotFile::open to refuse.
+bool upgradeSnapshotFile(const std::string& path, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    uint32_t start[2] = {0, 0}; // magic, version
+    if (!in || !in.read(reinterpret_cast<char*>(start), sizeof(start))) return true;
+    if (start[0] != kSnapshotMagic || start[1] < kOldestSnapshotVersion || start[1] >= kSnapshotVersion) return true;
+    in.seekg(0);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string upgraded = SnapshotBuilder::upgrade(contents, error);
+    if (upgraded.empty()) {
+        error = path + " " + error;
+        return false;
+    }
+
+    std::string backup = path + ".v" + std::to_string(start[1]);
+    std::string tempPath = path + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0 && writeAll(fd, upgraded) && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    if (!ok || (::link(path.c_str(), backup.c_str()) != 0 && errno != EEXIST) ||
+        std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        error = "could not upgrade " + path;
+        return false;
+    }
+    std::cout << "Upgraded " << path << " from snapshot version " << start[1] << "; the original is kept as "
+              << backup << std::endl;
+    return true;
+}
+
+// A bulk import file: CSV with a header row naming the columns, or JSON Lines (.json or
+// .jsonl, one object per line). The file is mmapped and parsed in place; fields are views
+// into the mapping, and only a field with escapes is copied. Pages behind the cursor are
+// dropped every kChunkBytes, so a file of any size is read in a bounded footprint. Each
+// line is one record, so a bad line is reported by number and the rest still reads.
+class ImportFile {
+public:
+    struct Column {
+        const char* name;
+        bool required;
+        bool list; // ';'-separated in CSV, an array of strings in JSON
+    };
+
+    // One line's fields, by column
+    class Record {
+    private:
+        friend class ImportFile;
+        std::vector<std::string_view> values;
+        std::vector<uint8_t> present;
+        std::vector<std::vector<std::string_view>> lists;
+        std::deque<std::string> unescaped; // owns the fields that had escapes
+
+        void reset(size_t columns) {
+            values.assign(columns, std::string_view());
+            present.assign(columns, 0);
+            lists.resize(columns);
+            for (auto& list : lists) list.clear();
+            unescaped.clear();
+        }
+
+    public:
+        size_t line = 0;
+
+        // Absent, empty and null fields all count as not given
+        bool has(size_t column) const { return present[column] != 0; }
+        std::string_view text(size_t column) const { return values[column]; }
+        const std::vector<std::string_view>& list(size_t column) const { return lists[column]; }
+    };
+
+private:
+    const char* data;
+    size_t size;
+    std::string path;
+    std::vector<Column> columns;
+    std::vector<size_t> cellColumns; // CSV: the column of each header cell
+    bool json;
+    size_t pos = 0;
+    size_t released = 0; // everything before this has been handed back to the kernel
+    size_t lineNumber = 0;
+    std::vector<std::string_view> cells;
+    static const size_t kChunkBytes = size_t(4) << 20;
+
+    ImportFile(const char* mapping, size_t length, std::string name, std::vector<Column> wanted, bool isJson)
+        : data(mapping), size(length), path(std::move(name)), columns(std::move(wanted)), json(isJson) {}
+
+    static std::string_view trim(std::string_view text) {
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string_view::npos) return {};
+        return text.substr(first, text.find_last_not_of(" \t") + 1 - first);
+    }
+
+    bool nextLine(std::string_view& line) {
+        if (pos >= size) return false;
+        const char* newline = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        size_t end = newline ? newline - data : size;
+        line = std::string_view(data + pos, end - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        pos = newline ? end + 1 : size;
+        lineNumber++;
+        if (pos - released >= kChunkBytes) {
+            size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            size_t upTo = pos / page * page;
+            ::madvise(const_cast<char*>(data) + released, upTo - released, MADV_DONTNEED);
+            released = upTo;
+        }
+        return true;
+    }
+
+    size_t columnNamed(std::string_view name) const {
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (name == columns[c].name) return c;
+        }
+        return columns.size();
+    }
+
+    std::string columnNames() const {
+        std::string names;
+        for (const auto& column : columns) names += std::string(names.empty() ? "" : ", ") + column.name;
+        return names;
+    }
+
+    void setValue(Record& record, size_t column, std::string_view value) {
+        if (value.empty()) return;
+        record.present[column] = 1;
+        record.values[column] = value;
+        if (!columns[column].list) return;
+        for (size_t start = 0; start <= value.size();) {
+            size_t end = std::min(value.find(';', start), value.size());
+            std::string_view name = trim(value.substr(start, end - start));
+            if (!name.empty()) record.lists[column].push_back(name);
+            start = end + 1;
+        }
+    }
+
+    // Splits one CSV line into cells. A "quoted" cell may hold commas, and "" for a quote;
+    // only such a cell is copied.
+    static bool splitCsv(std::string_view line, std::vector<std::string_view>& cells,
+                         std::deque<std::string>& unescaped, std::string& problem) {
+        cells.clear();
+        size_t i = 0;
+        while (true) {
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+            if (i < line.size() && line[i] == '"') {
+                size_t start = ++i, close = 0;
+                bool doubled = false;
+                while (true) {
+                    close = line.find('"', i);
+                    if (close == std::string_view::npos) {
+                        problem = "unterminated quote";
+                        return false;
+                    }
+                    if (close + 1 >= line.size() || line[close + 1] != '"') break;
+                    doubled = true;
+                    i = close + 2;
+                }
+                std::string_view cell = line.substr(start, close - start);
+                if (doubled) {
+                    std::string& copy = unescaped.emplace_back();
+                    for (size_t k = 0; k < cell.size(); k++) {
+                        copy.push_back(cell[k]);
+                        if (cell[k] == '"') k++;
+                    }
+                    cell = copy;
+                }
+                cells.push_back(cell);
+                i = close + 1;
+                while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+                if (i < line.size() && line[i] != ',') {
+                    problem = "text after a closing quote";
+                    return false;
+                }
+            } else {
+                size_t comma = std::min(line.find(',', i), line.size());
+                cells.push_back(trim(line.substr(i, comma - i)));
+                i = comma;
+            }
+            if (i >= line.size()) return true;
+            i++; // past the comma
+        }
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xc0 | code >> 6));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xe0 | code >> 12));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else {
+            out.push_back(static_cast<char>(0xf0 | code >> 18));
+            out.push_back(static_cast<char>(0x80 | (code >> 12 & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        }
+    }
+
+    static bool readHex(std::string_view line, size_t at, uint32_t& code) {
+        if (at + 4 > line.size()) return false;
+        code = 0;
+        for (size_t k = at; k < at + 4; k++) {
+            char c = line[k];
+            int digit = std::isdigit(static_cast<unsigned char>(c)) ? c - '0'
+                      : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0) return false;
+            code = code * 16 + static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    // A JSON string starting at line[i]; a view into the line unless it has escapes
+    static bool readString(std::string_view line, size_t& i, std::string_view& value,
+                           std::deque<std::string>& unescaped, std::string& problem) {
+        if (i >= line.size() || line[i] != '"') {
+            problem = "expected a string";
+            return false;
+        }
+        size_t start = ++i;
+        while (i < line.size() && line[i] != '"' && line[i] != '\\') i++;
+        if (i < line.size() && line[i] == '"') {
+            value = line.substr(start, i++ - start);
+            return true;
+        }
+        std::string& copy = unescaped.emplace_back(line.substr(start, i - start));
+        while (i < line.size() && line[i] != '"') {
+            if (line[i] != '\\') {
+                copy.push_back(line[i++]);
+                continue;
+            }
+            if (++i >= line.size()) break;
+            char escape = line[i++];
+            switch (escape) {
+                case '"': case '\\': case '/': copy.push_back(escape); break;
+                case 'b': copy.push_back('\b'); break;
+                case 'f': copy.push_back('\f'); break;
+                case 'n': copy.push_back('\n'); break;
+                case 'r': copy.push_back('\r'); break;
+                case 't': copy.push_back('\t'); break;
+                case 'u': {
+                    uint32_t code = 0, low = 0;
+                    if (!readHex(line, i, code)) {
+                        problem = "bad \\u escape";
+                        return false;
+                    }
+                    i += 4;
+                    if (code >= 0xd800 && code < 0xdc00 && line.substr(i, 2) == "\\u" && readHex(line, i + 2, low) &&
+                        low >= 0xdc00 && low < 0xe000) {
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        i += 6;
+                    }
+                    appendUtf8(copy, code);
+                    break;
+                }
+                default:
+                    problem = std::string("bad escape \\") + escape;
+                    return false;
+            }
+        }
+        if (i >= line.size()) {
+            problem = "unterminated string";
+            return false;
+        }
+        i++;
+        value = copy;
+        return true;
+    }
+
+    // One flat object: string, number, true/false/null, or (for list columns) an array
+    // of strings per key
+    bool parseJson(std::string_view line, Record& record, std::string& problem) {
+        size_t i = 0;
+        auto skip = [&] { while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) i++; };
+        skip();
+        if (i >= line.size() || line[i] != '{') {
+            problem = "expected a JSON object";
+            return false;
+        }
+        i++;
+        skip();
+        bool empty = i < line.size() && line[i] == '}';
+        if (empty) i++;
+        while (!empty) {
+            skip();
+            std::string_view key, value;
+            if (!readString(line, i, key, record.unescaped, problem)) return false;
+            skip();
+            if (i >= line.size() || line[i] != ':') {
+                problem = "expected : after \"" + std::string(key) + "\"";
+                return false;
+            }
+            i++;
+            skip();
+            size_t column = columnNamed(key);
+            if (column == columns.size()) {
+                problem = "unknown field \"" + std::string(key) + "\"";
+                return false;
+            }
+            if (i < line.size() && line[i] == '"') {
+                if (!readString(line, i, value, record.unescaped, problem)) return false;
+                setValue(record, column, value);
+            } else if (i < line.size() && line[i] == '[') {
+                if (!columns[column].list) {
+                    problem = std::string(key) + " takes a single value";
+                    return false;
+                }
+                i++;
+                skip();
+                record.present[column] = 1;
+                if (i < line.size() && line[i] == ']') {
+                    i++;
+                } else {
+                    while (true) {
+                        skip();
+                        if (!readString(line, i, value, record.unescaped, problem)) return false;
+                        if (!value.empty()) record.lists[column].push_back(value);
+                        skip();
+                        if (i < line.size() && line[i] == ',') {
+                            i++;
+                            continue;
+                        }
+                        if (i < line.size() && line[i] == ']') {
+                            i++;
+                            break;
+                        }
+                        problem = "expected , or ] in " + std::string(key);
+                        return false;
+                    }
+                }
+            } else {
+                size_t start = i;
+                while (i < line.size() && (std::isalnum(static_cast<unsigned char>(line[i])) || line[i] == '.' ||
+                                           line[i] == '-' || line[i] == '+')) {
+                    i++;
+                }
+                value = line.substr(start, i - start);
+                if (value.empty()) {
+                    problem = "bad value for " + std::string(key);
+                    return false;
+                }
+                if (value != "null") {
+                    if (columns[column].list) {
+                        problem = std::string(key) + " takes a list of strings";
+                        return false;
+                    }
+                    setValue(record, column, value);
+                }
+            }
+            skip();
+            if (i < line.size() && line[i] == ',') {
+                i++;
+                continue;
+            }
+            if (i < line.size() && line[i] == '}') {
+                i++;
+                break;
+            }
+            problem = "expected , or } after " + std::string(key);
+            return false;
+        }
+        skip();
+        if (i != line.size()) {
+            problem = "text after the object";
+            return false;
+        }
+        return true;
+    }
+
+public:
+    ~ImportFile() {
+        if (size > 0) ::munmap(const_cast<char*>(data), size);
+    }
+
+    ImportFile(const ImportFile&) = delete;
+    ImportFile& operator=(const ImportFile&) = delete;
+
+    // Maps the file and, for CSV, reads its header, which must name every required
+    // column and nothing else
+    static std::unique_ptr<ImportFile> open(const std::string& path, std::vector<Column> columns, std::string& error) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "could not open " + path;
+            return nullptr;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            error = "could not read " + path;
+            return nullptr;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        void* mapping = length > 0 ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = "could not map " + path;
+            return nullptr;
+        }
+        if (length > 0) ::madvise(mapping, length, MADV_SEQUENTIAL);
+        bool json = (path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0) ||
+                    (path.size() >= 6 && path.compare(path.size() - 6, 6, ".jsonl") == 0);
+        std::unique_ptr<ImportFile> file(
+            new ImportFile(static_cast<const char*>(mapping), length, path, std::move(columns), json));
+        if (json) return file;
+
+        std::string_view header;
+        std::deque<std::string> unescaped;
+        std::string problem;
+        while (file->nextLine(header) && trim(header).empty()) {}
+        if (trim(header).empty()) {
+            error = path + " is empty";
+            return nullptr;
+        }
+        if (!splitCsv(header, file->cells, unescaped, problem)) {
+            error = path + ":" + std::to_string(file->lineNumber) + ": " + problem;
+            return nullptr;
+        }
+        std::vector<uint8_t> seen(file->columns.size(), 0);
+        for (std::string_view cell : file->cells) {
+            size_t column = file->columnNamed(cell);
+            if (column == file->columns.size() || seen[column]) {
+                error = path + ": " + (column == file->columns.size() ? "unknown" : "repeated") + " column \"" +
+                        std::string(cell) + "\"; the columns are " + file->columnNames();
+                return nullptr;
+            }
+            seen[column] = 1;
+            file->cellColumns.push_back(column);
+        }
+        for (size_t c = 0; c < file->columns.size(); c++) {
+            if (file->columns[c].required && !seen[c]) {
+                error = path + ": no " + file->columns[c].name + " column";
+                return nullptr;
+            }
+        }
+        return file;
+    }
+
+    const std::string& name() const { return path; }
+
+    // Reads the next non-blank line into record. False at the end of the file; a line
+    // that does not parse, or lacks a required field, returns true with problem set.
+    bool next(Record& record, std::string& problem) {
+        std::string_view line;
+        do {
+            if (!nextLine(line)) return false;
+        } while (trim(line).empty());
+        record.reset(columns.size());
+        record.line = lineNumber;
+        problem.clear();
+        if (json) {
+            if (!parseJson(line, record, problem)) return true;
+        } else {
+            if (!splitCsv(line, cells, record.unescaped, problem)) return true;
+            if (cells.size() != cellColumns.size()) {
+                problem = std::to_string(cells.size()) + " fields where the header has " +
+                          std::to_string(cellColumns.size());
+                return true;
+            }
+            for (size_t k = 0; k < cells.size(); k++) setValue(record, cellColumns[k], cells[k]);
+        }
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (columns[c].required && !record.has(c)) {
+                problem = std::string("no ") + columns[c].name;
+                return true;
+            }
+        }
+        return true;
+    }
+};
+
+// Unbounded multi-producer, single-consumer queue (Vyukov). push() is one atomic
+// exchange and never blocks; pop() must only be called by one thread at a time.
+template <typename T>
+class MpscQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node*> head;    // most recently pushed
+    Node* tail;                 // already consumed; its successor is the next value
+    std::atomic<long> queued{0}; // linked and not yet popped; briefly negative is possible
+
+public:
+    MpscQueue() : head(new Node), tail(head.load()) {}
+
+    ~MpscQueue() {
+        while (tail) {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node;
+        node->value = std::move(value);
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Safe from any thread. Reports empty until a push has returned, so a producer that
+    // checks after its own push always sees its value or a later pop of it.
+    bool empty() const {
+        return queued.load(std::memory_order_acquire) <= 0;
+    }
+};
+
+// Change feed: every order, reservation and table change as a fixed-size event in a ring
+// of 64-byte slots, for kitchen displays and other consumers that follow the restaurant
+// at their own pace. Events are published under the lock that made the change, one
+// writer at a time, so sequence numbers follow the order things happened in; a short
+// writeLock, taken innermost, keeps it to one writer. Readers take no lock and never hold
+// up the writer: each slot is a seqlock, and a reader that falls a whole ring behind gets
+// Overrun and picks up again from oldest(). The ring is an anonymous mapping, or a POSIX
+// shared memory segment that other processes attach to and tail (see runFeedTail).
+class ChangeFeed {
+public:
+    enum class Kind : uint8_t { OrderPlaced = 1, OrderStatus, ReservationMade, TableSeated, TableFreed, TableChanged };
+
+    struct Event {
+        uint64_t sequence = 0;   // from 1, set by publish
+        int64_t at = 0;          // unix microseconds, set by publish
+        Kind kind = Kind::OrderPlaced;
+        OrderStatus status = OrderStatus::Pending;
+        int table = 0;
+        uint32_t number = 0;     // order or reservation ID without its prefix
+        int party = 0;           // guests, party size (0 for walk-ins), or seats for TableChanged
+        int lines = 0;           // order lines of a placed order
+        int day = 0;             // of a reservation, days since 1970-01-01
+        int minute = 0;          // of a reservation, minute of day
+        int64_t cents = 0;       // total of a placed order
+    };
+
+    enum class Read { Ok, NotYet, Overrun };
+
+    static constexpr uint32_t kDefaultCapacity = 1 << 14;
+
+private:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr char kMagic[8] = "RMSFEED";
+
+    struct Slot {
+        std::atomic<uint64_t> sequence; // 0 while the slot is being rewritten
+        std::atomic<uint64_t> words[7];
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t capacity;
+        std::atomic<uint64_t> epoch;  // when the writer opened the feed; a new writer numbers from 1 again
+        std::atomic<uint64_t> head;   // last sequence published, 0 for none
+        std::atomic<uint32_t> signal; // futex word, bumped by a publish that finds waiters
+        std::atomic<uint32_t> waiters;
+    };
+    static constexpr size_t kHeaderBytes = 128;
+    static_assert(sizeof(Header) <= kHeaderBytes && sizeof(Slot) == 64, "feed layout");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "feed words are shared between processes");
+
+    void* base;
+    size_t size;
+    Header* header;
+    Slot* slots;
+    uint64_t mask;
+    std::mutex writeLock;
+
+    ChangeFeed(void* mapping, size_t length)
+        : base(mapping), size(length), header(static_cast<Header*>(mapping)),
+          slots(reinterpret_cast<Slot*>(static_cast<char*>(mapping) + kHeaderBytes)),
+          mask(header->capacity - 1) {}
+
+    static size_t bytesFor(uint32_t capacity) { return kHeaderBytes + static_cast<size_t>(capacity) * sizeof(Slot); }
+
+    static int64_t nowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static std::string segmentName(const std::string& name) {
+        return !name.empty() && name[0] == '/' ? name : "/" + name;
+    }
+
+    // Starts the mapping over as an empty feed; readers of a shared one see the new epoch
+    static void reset(void* mapping, uint32_t capacity) {
+        Header* header = static_cast<Header*>(mapping);
+        header->head.store(0, std::memory_order_relaxed);
+        Slot* slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + kHeaderBytes);
+        for (uint32_t i = 0; i < capacity; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+        std::memcpy(header->magic, kMagic, sizeof(kMagic));
+        header->version = kVersion;
+        header->capacity = capacity;
+        header->epoch.store(static_cast<uint64_t>(nowMicros()), std::memory_order_release);
+    }
+
+    static long futex(const std::atomic<uint32_t>& word, int op, uint32_t value, const timespec* timeout) {
+        return ::syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&word), op, value, timeout, nullptr, 0);
+    }
+
+public:
+    ~ChangeFeed() {
+        ::munmap(base, size);
+    }
+
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    // A feed only this process reads
+    static std::unique_ptr<ChangeFeed> create(uint32_t capacity = kDefaultCapacity) {
+        void* mapping = ::mmap(nullptr, bytesFor(capacity), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) throw std::bad_alloc();
+        reset(mapping, capacity);
+        return std::unique_ptr<ChangeFeed>(new ChangeFeed(mapping, bytesFor(capacity)));
+    }
+
+    // A feed in the shared memory segment NAME (/dev/shm/NAME), created or started over.
+    // The segment outlives the process, so readers keep tailing across a restart.
+    static std::unique_ptr<ChangeFeed> create(const std::string& name, std::string& error,
+                                              uint32_t capacity = kDefaultCapacity) {
+        std::string segment = segmentName(name);
+        int fd = ::shm_open(segment.c_str(), O_RDWR | O_CREAT, 0660);
+        if (fd < 0) {
+            error = "could not open shared memory " + segment + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        size_t length = bytesFor(capacity);
+        void* mapping = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(length)) == 0) {
+            mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = "could not map shared memory " + segment;
+            return nullptr;
+        }
+        reset(mapping, capacity);
+        return std::unique_ptr<ChangeFeed>(new ChangeFeed(mapping, length));
+    }
+
+    // Another process's feed, to read. Returns null if NAME holds no feed.
+    static std::unique_ptr<ChangeFeed> attach(const std::string& name, std::string& error) {
+        std::string segment = segmentName(name);
+        int fd = ::shm_open(segment.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            error = "no feed " + segment + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kHeaderBytes) {
+            ::close(fd);
+            error = segment + " is too short to be a feed";
+            return nullptr;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = "could not map " + segment;
+            return nullptr;
+        }
+        std::unique_ptr<ChangeFeed> feed(new ChangeFeed(mapping, length));
+        const Header& header = *feed->header;
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+            error = segment + " is not a version " + std::to_string(kVersion) + " feed";
+            return nullptr;
+        }
+        if (header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 ||
+            bytesFor(header.capacity) != length) {
+            error = segment + " has a corrupt header";
+            return nullptr;
+        }
+        return feed;
+    }
+
+    // Stamps the event with the next sequence number and the time, and wakes any
+    // waiting readers
+    void publish(Event event) {
+        event.at = nowMicros();
+        std::lock_guard<std::mutex> lock(writeLock);
+        event.sequence = header->head.load(std::memory_order_relaxed) + 1;
+        Slot& slot = slots[event.sequence & mask];
+        // Each word is a release store, so a reader that sees any new word also sees the
+        // 0 before it; on x86 these are plain stores
+        slot.sequence.store(0, std::memory_order_relaxed);
+        slot.words[0].store(static_cast<uint64_t>(event.at), std::memory_order_release);
+        slot.words[1].store(static_cast<uint64_t>(event.kind) | static_cast<uint64_t>(event.status) << 8 |
+                                static_cast<uint64_t>(static_cast<uint32_t>(event.table)) << 32,
+                            std::memory_order_release);
+        slot.words[2].store(event.number | static_cast<uint64_t>(static_cast<uint32_t>(event.party)) << 32,
+                            std::memory_order_release);
+        slot.words[3].store(static_cast<uint32_t>(event.lines) |
+                                static_cast<uint64_t>(static_cast<uint32_t>(event.day)) << 32,
+                            std::memory_order_release);
+        slot.words[4].store(static_cast<uint64_t>(event.minute), std::memory_order_release);
+        slot.words[5].store(static_cast<uint64_t>(event.cents), std::memory_order_release);
+        slot.sequence.store(event.sequence, std::memory_order_release);
+        header->head.store(event.sequence, std::memory_order_seq_cst);
+        // Pairs with wait(): either the reader sees the new head, or this sees its waiters count
+        if (header->waiters.load(std::memory_order_seq_cst) > 0) {
+            header->signal.fetch_add(1, std::memory_order_seq_cst);
+            futex(header->signal, FUTEX_WAKE, std::numeric_limits<int>::max(), nullptr);
+        }
+    }
+
+    // Copies event sequence into event. NotYet if it has not been published; Overrun if
+    // it has already been written over, in which case oldest() is where to go on from.
+    Read read(uint64_t sequence, Event& event) const {
+        if (sequence == 0 || sequence > head()) return Read::NotYet;
+        const Slot& slot = slots[sequence & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) return Read::Overrun;
+        uint64_t words[6];
+        for (int i = 0; i < 6; i++) words[i] = slot.words[i].load(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) return Read::Overrun; // rewritten meanwhile
+
+        event.sequence = sequence;
+        event.at = static_cast<int64_t>(words[0]);
+        event.kind = static_cast<Kind>(words[1] & 0xff);
+        event.status = static_cast<OrderStatus>(words[1] >> 8 & 0xff);
+        event.table = static_cast<int>(static_cast<uint32_t>(words[1] >> 32));
+        event.number = static_cast<uint32_t>(words[2]);
+        event.party = static_cast<int>(static_cast<uint32_t>(words[2] >> 32));
+        event.lines = static_cast<int>(static_cast<uint32_t>(words[3]));
+        event.day = static_cast<int>(static_cast<uint32_t>(words[3] >> 32));
+        event.minute = static_cast<int>(words[4]);
+        event.cents = static_cast<int64_t>(words[5]);
+        return Read::Ok;
+    }
+
+    uint64_t head() const { return header->head.load(std::memory_order_acquire); }
+
+    // Oldest sequence still in the ring
+    uint64_t oldest() const {
+        uint64_t last = head();
+        return last > mask + 1 ? last - mask : 1;
+    }
+
+    uint64_t epoch() const { return header->epoch.load(std::memory_order_acquire); }
+    uint32_t capacity() const { return header->capacity; }
+
+    // Waits until sequence is published or timeout passes; true if it was. Spins briefly
+    // first, since under load the next event is usually microseconds away.
+    bool wait(uint64_t sequence, std::chrono::milliseconds timeout) const {
+        for (int spin = 0; spin < 200; spin++) {
+            if (head() >= sequence) return true;
+        }
+        header->waiters.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t seen = header->signal.load(std::memory_order_seq_cst);
+        bool published = head() >= sequence;
+        if (!published) {
+            timespec limit{static_cast<time_t>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000) * 1000000};
+            futex(header->signal, FUTEX_WAIT, seen, &limit);
+            published = head() >= sequence;
+        }
+        header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+        return published;
+    }
+
+    // One line: sequence, local time to the millisecond, and what changed
+    static void print(const Event& event, std::ostream& out) {
+        time_t seconds = static_cast<time_t>(event.at / 1000000);
+        tm localTime;
+        localtime_r(&seconds, &localTime);
+        char stamp[16];
+        std::snprintf(stamp, sizeof(stamp), "%02d:%02d:%02d.%03d", localTime.tm_hour, localTime.tm_min,
+                      localTime.tm_sec, static_cast<int>(event.at / 1000 % 1000));
+        out << std::setw(8) << event.sequence << "  " << stamp << "  ";
+        switch (event.kind) {
+            case Kind::OrderPlaced:
+                out << "ORD" << event.number << " placed at T" << event.table << ": " << event.lines
+                    << (event.lines == 1 ? " line, " : " lines, ") << event.party
+                    << (event.party == 1 ? " guest, " : " guests, ") << formatMoney(event.cents);
+                break;
+            case Kind::OrderStatus:
+                out << "ORD" << event.number << " at T" << event.table << " is " << statusName(event.status);
+                break;
+            case Kind::ReservationMade:
+                out << "RES" << event.number << " booked T" << event.table << " for " << event.party << " on "
+                    << formatDate(event.day) << " " << formatClock(event.minute);
+                break;
+            case Kind::TableSeated:
+                out << "T" << event.table << " seated";
+                if (event.party > 0) out << ", party of " << event.party;
+                break;
+            case Kind::TableFreed:
+                out << "T" << event.table << " freed";
+                break;
+            case Kind::TableChanged:
+                out << "T" << event.table << " now seats " << event.party;
+                break;
+            default:
+                out << "event " << static_cast<int>(event.kind);
+        }
+        out << '\n';
+    }
+};
+
+// Order ID -> order, split into separately locked shards so lookups from different
+// terminals rarely wait on each other
+class OrderIndex {
+private:
+    static const size_t kShards = 16;
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Order>> orders;
+    };
+    std::array<Shard, kShards> shards;
+
+    Shard& shardFor(const std::string& orderId) {
+        return shards[std::hash<std::string>()(orderId) % kShards];
+    }
+
+public:
+    std::shared_ptr<Order> find(const std::string& orderId) {
+        Shard& shard = shardFor(orderId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.orders.find(orderId);
+        return it != shard.orders.end() ? it->second : nullptr;
+    }
+
+    // Returns the order previously stored under the same ID, if any
+    std::shared_ptr<Order> insert(const std::shared_ptr<Order>& order) {
+        Shard& shard = shardFor(order->getOrderId());
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::shared_ptr<Order>& slot = shard.orders[order->getOrderId()];
+        std::shared_ptr<Order> previous = std::move(slot);
+        slot = order;
+        return previous;
+    }
+
+    void clear() {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.orders.clear();
+        }
+    }
+};
+
+// One screen of output. Lines collect in memory and reach the destination in a single
+// write and flush when the writer goes out of scope, so a remote terminal gets each
+// screen in one piece. Declared before a screen's locks, it also keeps a slow terminal
+// from holding them. Output already bound for memory is written straight through.
+class ScreenWriter : public std::ostream {
+private:
+    std::ostream& destination;
+    std::stringbuf buffer;
+
+public:
+    explicit ScreenWriter(std::ostream& target) : std::ostream(nullptr), destination(target) {
+        rdbuf(dynamic_cast<std::stringbuf*>(target.rdbuf()) ? target.rdbuf() : &buffer);
+    }
+
+    ~ScreenWriter() {
+        if (rdbuf() == &buffer) {
+            const std::string& text = buffer.str();
+            destination.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+        destination.flush();
+    }
+
+    ScreenWriter(const ScreenWriter&) = delete;
+    ScreenWriter& operator=(const ScreenWriter&) = delete;
+};
+
+// Many terminals may call the operations below at once. Each operation holds stateLock
+// shared (snapshots and recovery take it exclusively), then the stripe lock of the table
+// it changes, so terminals working different tables do not contend. The remaining shared
+// structures each have their own short-held lock, listed with them. Lock order:
+// stateLock, a table stripe, then any one of the others.
+class Restaurant {
+private:
+    MenuCatalog menu; // order lines refer to items by position
+    std::vector<std::shared_ptr<Table>> tables;
+    std::vector<std::shared_ptr<Order>> orders;
+    std::vector<std::shared_ptr<Reservation>> reservations;
+
+    // The menu screen as last rendered, and the menu version it shows
+    std::shared_ptr<const std::string> renderedMenu;
+    uint64_t renderedMenuVersion = 0;
+
+    // Hash indexes over the vectors above, kept in step by addTable/addOrder
+    std::unordered_map<int, std::shared_ptr<Table>> tableIndex;
+    OrderIndex orderIndex;
+    OrderStatusLists statusLists; // every overlay order, by status
+
+    // Overlay orders are allocated from one arena per business day. Remapping a snapshot
+    // drops the arenas, so a day's memory goes back in bulk once its orders are released.
+    std::map<int, std::shared_ptr<OrderArena>> orderArenas;
+
+    std::string restaurantName;
+    std::atomic<int> nextOrderId;
+    std::atomic<int> nextReservationId;
+
+    mutable std::shared_mutex stateLock;
+    static const size_t kTableStripes = 64;
+    mutable std::array<std::mutex, kTableStripes> tableStripes; // table state and order status
+    mutable std::mutex ordersLock;      // appends to orders
+    mutable std::mutex summaryLock;     // dailySummaries, snapshotDayShadowed
+    mutable std::mutex reservationLock; // reservations, reservationBook
+    mutable std::mutex snapshotLock;    // snapshotOrderShadowed
+    mutable std::mutex statusLock;      // statusLists and the status of every listed order
+    mutable std::mutex arenaLock;       // orderArenas
+    mutable std::mutex renderLock;      // renderedMenu, renderedMenuVersion
+
+    // Write-ahead journal; null when persistence is disabled
+    std::unique_ptr<Journal> journal;
+    uint64_t journalGeneration;
+    std::atomic<size_t> framesSinceSnapshot;
+    static const size_t kSnapshotInterval = 10000;
+    std::string journalPath;
+    // Generations of the earlier journals (journalPath.N) still waiting for a snapshot to
+    // cover them. A checkpoint moves the journal aside and writes the snapshot with no
+    // lock held, so terminals go on journaling into a new file meanwhile.
+    std::vector<uint64_t> journalSegments;
+    std::mutex checkpointLock; // one checkpoint at a time; taken before every other lock
+    bool catchingUp = false;   // replaying the journal over a new snapshot; the sales history has it all
+
+    // Read-only mapping of the last snapshot. The vectors above are a mutable overlay:
+    // open orders are copied into it on load, other snapshot orders only when touched.
+    // Shared with a checkpoint being written from it.
+    std::shared_ptr<const SnapshotFile> snapshot;
+    std::vector<bool> snapshotOrderShadowed; // the overlay holds this snapshot order
+    std::string snapshotPath;
+
+    // Report totals by business day. Days in the snapshot are copied in when touched.
+    std::map<int, DailySummary> dailySummaries;
+    std::vector<bool> snapshotDayShadowed;
+    SalesHistory sales; // every paid order line, for analytics; has its own lock
+    static const int kBusinessDayStartHour = 4; // orders before 04:00 belong to the previous day
+
+    // Upcoming reservations by table and time; earlier snapshot reservations (before
+    // snapshotReservationsLoaded) stay in the mapping only
+    ReservationBook reservationBook;
+    size_t snapshotReservationsLoaded;
+
+    // Pending and cooking orders, replanned whenever one is placed or leaves the kitchen.
+    // Terminals queue changes on kitchenInbox without waiting; whoever next holds
+    // kitchenLock applies them all and replans once.
+    struct KitchenUpdate {
+        std::string orderId;
+        int64_t placedAt = 0;
+        std::vector<KitchenScheduler::Task> tasks;
+        bool remove = false;
+    };
+    KitchenScheduler kitchen;
+    MpscQueue<KitchenUpdate> kitchenInbox;
+    mutable std::mutex kitchenLock;
+
+    // Predicted table turns and the parties waiting for a table. Told of every seating,
+    // order, kitchen replan and payment as it happens; not persisted, since the parties
+    // are standing at the door.
+    Waitlist waitlist;
+    mutable std::mutex floorLock; // waitlist; taken last
+    static const size_t kTurnHistoryOrders = 5000; // recent paid orders the stays are learned from at startup
+
+    // Every order, reservation and table change, for displays and other processes to
+    // follow. Published under the lock that made the change; recovery and setup-time
+    // changes are not published.
+    std::unique_ptr<ChangeFeed> feed = ChangeFeed::create();
+    static const uint64_t kFeedScreenEvents = 20; // the feed screen's default: the latest 20
+
+    // Ingredient stock and recipes. Placed orders queue on stockInbox; whoever next holds
+    // inventoryLock takes every queued order off the stock in one batch and, when that
+    // runs an ingredient short, takes stateLock exclusively to 86 the affected items.
+    Inventory inventory;
+    MpscQueue<std::shared_ptr<Order>> stockInbox;
+    mutable std::mutex inventoryLock; // inventory; always taken before stateLock
+    // By menu position: the items the inventory has 86'd, readable without locks, so
+    // orders stop the moment a batch runs an item short rather than once the menu is
+    // updated. Grows with the menu, under inventoryLock and exclusive stateLock.
+    std::deque<std::atomic<bool>> soldOut;
+
+    // By menu position: the item is on the menu, as opposed to withdrawn by the menu or an
+    // import. The menu shows an item as available while it is offered and not sold out.
+    std::vector<uint8_t> offered;
+    std::mutex importLock; // one import at a time; taken before inventoryLock
+
+    std::mutex& tableLock(int tableNumber) const {
+        return tableStripes[static_cast<size_t>(tableNumber) % kTableStripes];
+    }
+
+    std::string generateOrderId() {
+        return "ORD" + std::to_string(nextOrderId.fetch_add(1));
+    }
+
+    std::string generateReservationId() {
+        return "RES" + std::to_string(nextReservationId.fetch_add(1));
+    }
+
+    // Day of the current service; the day rolls over at kBusinessDayStartHour
+    static int businessDay(ServiceClock::Reading now = ServiceClock::now()) {
+        return now.minute < kBusinessDayStartHour * 60 ? now.day - 1 : now.day;
+    }
+
+    // Summary for a business day, or null if nothing was paid that day. Caller holds summaryLock.
+    DailySummary* findSummary(int day) {
+        auto it = dailySummaries.find(day);
+        if (it != dailySummaries.end()) return &it->second;
+        if (!snapshot) return nullptr;
+
+        const SnapshotDay* first = snapshot->section<SnapshotDay>(kSnapshotDays);
+        const SnapshotDay* last = first + snapshot->count(kSnapshotDays);
+        const SnapshotDay* record = std::lower_bound(first, last, day,
+            [](const SnapshotDay& entry, int d) { return entry.day < d; });
+        if (record == last || record->day != day || snapshotDayShadowed[record - first]) return nullptr;
+
+        DailySummary& summary = dailySummaries[day];
+        summary.revenueCents = record->revenueCents;
+        summary.ordersCompleted = record->ordersCompleted;
+        summary.customersServed = record->customersServed;
+        const SnapshotCount* counts = snapshot->section<SnapshotCount>(kSnapshotCounts) + record->firstCount;
+        for (uint32_t i = 0; i < record->itemCountCount; i++, counts++) {
+            summary.itemCounts[std::string(snapshot->str(counts->key))] = counts->quantity;
+        }
+        for (uint32_t i = 0; i < record->categoryCountCount; i++, counts++) {
+            summary.categoryCounts[std::string(snapshot->str(counts->key))] = counts->quantity;
+        }
+        snapshotDayShadowed[record - first] = true;
+        return &summary;
+    }
+
+    // Adds a paid order to its day's totals, or takes it back out (sign -1)
+    void recordPaidOrder(const Order& order, int sign) {
+        std::lock_guard<std::mutex> lock(summaryLock);
+        DailySummary* summary = findSummary(order.getOrderDay());
+        if (!summary) summary = &dailySummaries[order.getOrderDay()];
+        summary->revenueCents += sign * order.getTotalCents();
+        summary->ordersCompleted += sign;
+        summary->customersServed += sign * order.getCustomerCount();
+        for (const auto& line : order.getItems()) {
+            summary->itemCounts[std::string(menu.itemId(line.menuIndex))] += sign * line.quantity;
+            summary->categoryCounts[std::string(menu.category(line.menuIndex))] += sign * line.quantity;
+        }
+    }
+
+    // Appends a paid order's lines to the sales history, or their reversal (sign -1)
+    void recordSale(const Order& order, int sign) {
+        std::vector<SalesHistory::Line> lines;
+        lines.reserve(order.getItems().size());
+        for (const auto& line : order.getItems()) lines.push_back({line.menuIndex, line.quantity, line.unitCents});
+        sales.addOrder(order.getOrderDay(), order.getOrderMinute() / 60, order.getTableNumber(), order.getCustomerCount(), lines, sign);
+    }
+
+    // Every status change goes through here so the status lists, the daily totals and
+    // the sales history follow it. Caller holds the order's table lock.
+    void applyStatus(Order& order, OrderStatus newStatus, int64_t when) {
+        bool wasPaid = order.getStatus() == OrderStatus::Paid;
+        bool isPaid = newStatus == OrderStatus::Paid;
+        {
+            std::lock_guard<std::mutex> lock(statusLock);
+            statusLists.move(order, newStatus, when);
+        }
+        if (wasPaid != isPaid) {
+            recordPaidOrder(order, isPaid ? 1 : -1);
+            if (!catchingUp) recordSale(order, isPaid ? 1 : -1);
+        }
+    }
+
+    static bool inKitchen(OrderStatus status) {
+        return status == OrderStatus::Pending || status == OrderStatus::Cooking;
+    }
+
+    // Local minutes since 1970-01-01 when the order was placed
+    static int64_t placedAt(const Order& order) {
+        int day = order.getOrderDay(), minute = order.getOrderMinute();
+        if (minute < kBusinessDayStartHour * 60) day++; // after midnight, still the previous business day
+        return static_cast<int64_t>(day) * 1440 + minute;
+    }
+
+    // Puts an order change on the feed. Caller holds the order's table lock, so the
+    // feed has a table's changes in the order they were made.
+    void publishOrder(ChangeFeed::Kind kind, const Order& order) {
+        ChangeFeed::Event event;
+        event.kind = kind;
+        event.status = order.getStatus();
+        event.table = order.getTableNumber();
+        event.number = static_cast<uint32_t>(idNumber(order.getOrderId()));
+        event.party = order.getCustomerCount();
+        event.lines = static_cast<int>(order.getItems().size());
+        event.cents = order.getTotalCents();
+        feed->publish(event);
+    }
+
+    // party is the party seated (0 for walk-ins), or the seats of a changed table
+    void publishTable(ChangeFeed::Kind kind, int tableNumber, int party = 0) {
+        ChangeFeed::Event event;
+        event.kind = kind;
+        event.table = tableNumber;
+        event.party = party;
+        feed->publish(event);
+    }
+
+    // Tells the waitlist the table has food coming, due once the slowest item is cooked;
+    // the kitchen's plan corrects that when it replans. Caller holds the table's lock.
+    void noteOrdered(const Order& order, int64_t now) {
+        int longest = 0;
+        for (const auto& line : order.getItems()) longest = std::max(longest, menu.preparationTime(line.menuIndex));
+        std::lock_guard<std::mutex> floor(floorLock);
+        waitlist.ordered(order.getTableNumber(), order.getOrderId(), order.getCustomerCount(), now + longest);
+    }
+
+    // Queues one task per order line at the station for the item's category; a line's
+    // portions cook together. Call pumpKitchen() once the caller's locks are released.
+    void addKitchenTicket(const Order& order) {
+        std::vector<KitchenScheduler::Task> tasks;
+        tasks.reserve(order.getItems().size());
+        for (const auto& line : order.getItems()) {
+            KitchenScheduler::Task task;
+            task.itemId = std::string(menu.itemId(line.menuIndex));
+            task.station = kitchen.stationFor(std::string(menu.category(line.menuIndex)));
+            task.minutes = menu.preparationTime(line.menuIndex);
+            tasks.push_back(task);
+        }
+        KitchenUpdate update;
+        update.orderId = order.getOrderId();
+        update.placedAt = placedAt(order);
+        update.tasks = std::move(tasks);
+        kitchenInbox.push(std::move(update));
+    }
+
+    void removeKitchenTicket(const std::string& orderId) {
+        KitchenUpdate update;
+        update.orderId = orderId;
+        update.remove = true;
+        kitchenInbox.push(std::move(update));
+    }
+
+    // Applies queued kitchen changes and replans; caller holds kitchenLock
+    void drainKitchen() {
+        KitchenUpdate update;
+        bool changed = false;
+        while (kitchenInbox.pop(update)) {
+            if (update.remove) kitchen.removeTicket(update.orderId);
+            else kitchen.addTicket(update.orderId, update.placedAt, std::move(update.tasks));
+            changed = true;
+        }
+        if (!changed) return;
+        kitchen.reschedule(ServiceClock::localMinute());
+        std::lock_guard<std::mutex> floor(floorLock);
+        kitchen.takeMoved([this](const std::string& orderId, int64_t readyAt) {
+            waitlist.kitchenDue(orderId, readyAt);
+        });
+    }
+
+    // Replans if nobody else is; a terminal never waits here. The holder re-checks the
+    // inbox after unlocking, so a change queued while it was busy is not stranded.
+    void pumpKitchen() {
+        while (!kitchenInbox.empty()) {
+            std::unique_lock<std::mutex> lock(kitchenLock, std::try_to_lock);
+            if (!lock) return;
+            drainKitchen();
+        }
+    }
+
+    // Takes every queued order off the stock; caller holds inventoryLock. The changes go
+    // to applyAvailability().
+    void drainInventory(std::vector<Inventory::Change>& changes) {
+        std::shared_ptr<Order> order;
+        std::vector<Inventory::Portion> portions;
+        while (stockInbox.pop(order)) {
+            for (const auto& line : order->getItems()) portions.push_back({line.menuIndex, line.quantity});
+        }
+        if (!portions.empty()) inventory.consume(portions, changes);
+    }
+
+    // Caller holds inventoryLock
+    void markSoldOut(const std::vector<Inventory::Change>& changes) {
+        for (const auto& change : changes) soldOut[change.item].store(!change.available, std::memory_order_relaxed);
+    }
+
+    // Brings the menu in line with soldOut for the changed items. Caller holds stateLock
+    // exclusively. Batches may get here out of order, so the item's latest verdict is
+    // read back rather than taken from the change.
+    void syncMenu(const std::vector<Inventory::Change>& changes) {
+        for (const auto& change : changes) {
+            menu.updateAvailability(change.item,
+                                    offered[change.item] && !soldOut[change.item].load(std::memory_order_relaxed));
+        }
+    }
+
+    // 86es the items that ran short and brings back the ones that can be made again.
+    // Caller holds inventoryLock and stateLock exclusively, or has the restaurant to
+    // itself at setup.
+    void applyAvailability(const std::vector<Inventory::Change>& changes) {
+        markSoldOut(changes);
+        syncMenu(changes);
+    }
+
+    // Like pumpKitchen(): a terminal never waits for the inventory. A batch that 86es
+    // an item stops its orders at once, then waits for stateLock to update the menu
+    // without holding up the batches behind it.
+    void pumpInventory() {
+        while (!stockInbox.empty()) {
+            std::unique_lock<std::mutex> lock(inventoryLock, std::try_to_lock);
+            if (!lock) return;
+            std::vector<Inventory::Change> changes;
+            drainInventory(changes);
+            if (changes.empty()) continue;
+            markSoldOut(changes);
+            lock.unlock();
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            syncMenu(changes);
+        }
+    }
+
+    uint32_t addToMenu(const MenuItem& item) {
+        uint32_t index = menu.add(item);
+        while (soldOut.size() < menu.size()) soldOut.emplace_back(false);
+        offered.resize(menu.size());
+        offered[index] = item.getAvailability();
+        if (soldOut[index].load(std::memory_order_relaxed)) menu.updateAvailability(index, false);
+        return index;
+    }
+
+    void initializeKitchen() {
+        int grill = kitchen.addStation("grill", 2);
+        int pasta = kitchen.addStation("pasta", 1);
+        int cold = kitchen.addStation("cold", 1);
+        int dessert = kitchen.addStation("dessert", 1);
+        int bar = kitchen.addStation("bar", 1);
+        kitchen.assignCategory("Main Course", grill, true);
+        kitchen.assignCategory("Pasta", pasta);
+        kitchen.assignCategory("Appetizer", cold);
+        kitchen.assignCategory("Salad", cold);
+        kitchen.assignCategory("Dessert", dessert);
+        kitchen.assignCategory("Beverage", bar);
+    }
+
+    // False, adding nothing, if the table is already booked from the same start. Caller
+    // holds reservationLock.
+    bool addReservation(const std::shared_ptr<Reservation>& reservation) {
+        if (!reservationBook.add(reservation, reservation->getReservationDay(), reservation->getReservationMinute())) {
+            return false;
+        }
+        reservations.push_back(reservation);
+        return true;
+    }
+
+    // Recovery keeps the first of two bookings of a table from the same start
+    static void reportDoubleBooking(const Reservation& reservation) {
+        std::cerr << reservation.getReservationId() << " books table " << reservation.getTableNumber()
+                  << " from the same time as another reservation; skipped." << std::endl;
+    }
+
+    // Numeric part of IDs like ORD1001 / RES2001
+    static int idNumber(const std::string& id) {
+        return id.size() > 3 ? std::atoi(id.c_str() + 3) : 0;
+    }
+
+    void encodeOrder(RecordWriter& out, const Order& order) const {
+        out.putByte(static_cast<uint8_t>(JournalRecord::OrderCreated));
+        out.putString(order.getOrderId());
+        out.putInt(order.getTableNumber());
+        out.putInt(order.getOrderDay());
+        out.putInt(order.getOrderMinute());
+        out.putInt(order.getCustomerCount());
+        out.putInt(order.getStatusTime(OrderStatus::Pending));
+        for (const auto& line : order.getItems()) {
+            out.putByte(static_cast<uint8_t>(JournalRecord::ItemAdded));
+            out.putString(order.getOrderId());
+            out.putString(menu.itemId(line.menuIndex));
+            out.putInt(line.quantity);
+            out.putInt(line.unitCents);
+        }
+        if (!order.getSpecialInstructions().empty()) {
+            out.putByte(static_cast<uint8_t>(JournalRecord::InstructionsAdded));
+            out.putString(order.getOrderId());
+            out.putString(order.getSpecialInstructions());
+        }
+        if (order.getStatus() != OrderStatus::Pending) {
+            encodeStatus(out, order.getOrderId(), order.getStatus(), order.getStatusTime(order.getStatus()));
+        }
+    }
+
+    static void encodeStatus(RecordWriter& out, const std::string& orderId, OrderStatus status, int64_t when) {
+        out.putByte(static_cast<uint8_t>(JournalRecord::StatusUpdated));
+        out.putString(orderId);
+        out.putByte(static_cast<uint8_t>(status));
+        out.putInt(when);
+    }
+
+    static void encodeReservation(RecordWriter& out, const Reservation& reservation) {
+        out.putByte(static_cast<uint8_t>(JournalRecord::ReservationMade));
+        out.putString(reservation.getReservationId());
+        out.putString(reservation.getCustomerName());
+        out.putString(reservation.getPhone());
+        out.putInt(reservation.getPartySize());
+        out.putInt(reservation.getReservationDay());
+        out.putInt(reservation.getReservationMinute());
+        out.putInt(reservation.getDurationMinutes());
+        out.putInt(reservation.getTableNumber());
+        out.putString(reservation.getSpecialRequests());
+    }
+
+    static void encodeTable(RecordWriter& out, JournalRecord type, int tableNumber) {
+        out.putByte(static_cast<uint8_t>(type));
+        out.putInt(tableNumber);
+    }
+
+    static void encodeStock(RecordWriter& out, const std::string& ingredient, int64_t change) {
+        out.putByte(static_cast<uint8_t>(JournalRecord::StockAdjusted));
+        out.putString(ingredient);
+        out.putInt(change);
+    }
+
+    void encodeRecipe(RecordWriter& out, uint32_t item) const {
+        out.putByte(static_cast<uint8_t>(JournalRecord::RecipeSet));
+        out.putString(menu.itemId(item));
+        out.putInt(static_cast<int64_t>(inventory.recipe(item).size()));
+        for (const auto& component : inventory.recipe(item)) {
+            out.putString(inventory.name(component.ingredient));
+            out.putInt(component.amount);
+        }
+    }
+
+    // Applies one journal frame of the given version to the in-memory state
+    void applyRecords(RecordReader& in, uint32_t version) {
+        // Before version 5, dates and times were journaled as text and prices as doubles
+        auto getDay = [&in, version] {
+            int day = 0;
+            if (version >= 5) day = static_cast<int>(in.getInt());
+            else parseDate(in.getString(), day);
+            return day;
+        };
+        auto getMinute = [&in, version] {
+            int minute = 0;
+            if (version >= 5) minute = static_cast<int>(in.getInt());
+            else parseClock(in.getString(), minute);
+            return minute;
+        };
+        auto getCents = [&in, version] { return version >= 5 ? in.getInt() : toCents(in.getDouble()); };
+        while (in.ok() && !in.atEnd()) {
+            auto type = static_cast<JournalRecord>(in.getByte());
+            switch (type) {
+                case JournalRecord::OrderCreated: {
+                    std::string orderId = in.getString();
+                    int tableNumber = static_cast<int>(in.getInt());
+                    int orderDay = getDay();
+                    int orderMinute = getMinute();
+                    int customers = static_cast<int>(in.getInt());
+                    int64_t placedAt = in.getInt();
+                    if (!in.ok()) return;
+                    auto order = makeOrder(orderId, tableNumber, orderDay, orderMinute, customers, placedAt);
+                    addOrder(order);
+                    stockInbox.push(order); // its lines follow; the queue is drained after them
+                    nextOrderId = std::max(nextOrderId.load(), idNumber(orderId) + 1);
+                    break;
+                }
+                case JournalRecord::ItemAdded: {
+                    std::string orderId = in.getString();
+                    std::string itemId = in.getString();
+                    int quantity = static_cast<int>(in.getInt());
+                    int64_t unitCents = getCents();
+                    auto order = lookupOrder(orderId);
+                    if (in.ok() && order) order->addItem(internMenuItem(itemId), quantity, unitCents);
+                    break;
+                }
+                case JournalRecord::InstructionsAdded: {
+                    std::string orderId = in.getString();
+                    std::string instructions = in.getString();
+                    auto order = lookupOrder(orderId);
+                    if (in.ok() && order) order->addSpecialInstructions(instructions);
+                    break;
+                }
+                case JournalRecord::StatusUpdated: {
+                    std::string orderId = in.getString();
+                    uint8_t status = in.getByte();
+                    int64_t when = in.getInt();
+                    auto order = lookupOrder(orderId);
+                    if (in.ok() && order && status < kOrderStatusCount) {
+                        applyStatus(*order, static_cast<OrderStatus>(status), when);
+                    }
+                    break;
+                }
+                case JournalRecord::ReservationMade: {
+                    std::string reservationId = in.getString();
+                    std::string name = in.getString();
+                    std::string phone = in.getString();
+                    int partySize = static_cast<int>(in.getInt());
+                    int day = getDay();
+                    int minute = getMinute();
+                    int duration = static_cast<int>(in.getInt());
+                    int tableNumber = static_cast<int>(in.getInt());
+                    std::string requests = in.getString();
+                    if (!in.ok()) return;
+                    auto reservation = std::make_shared<Reservation>(reservationId, name, phone, partySize,
+                                                                     day, minute, tableNumber, duration);
+                    if (!requests.empty()) reservation->addSpecialRequests(requests);
+                    if (!addReservation(reservation)) reportDoubleBooking(*reservation);
+                    nextReservationId = std::max(nextReservationId.load(), idNumber(reservationId) + 1);
+                    break;
+                }
+                case JournalRecord::TableOccupied:
+                case JournalRecord::TableFreed: {
+                    auto table = findTable(static_cast<int>(in.getInt()));
+                    if (in.ok() && table) {
+                        if (type == JournalRecord::TableOccupied) table->reserveTable();
+                        else table->freeTable();
+                    }
+                    break;
+                }
+                // Both apply after the orders journaled before them have been taken off the
+                // stock. A count is journaled as a difference, so it replays to the same
+                // level whichever side of it a concurrent order's frame landed.
+                case JournalRecord::StockAdjusted: {
+                    std::string name = in.getString();
+                    int64_t change = in.getInt();
+                    if (!in.ok() || name.empty()) return;
+                    std::vector<Inventory::Change> changes;
+                    drainInventory(changes);
+                    uint32_t ingredient = inventory.ingredient(name);
+                    inventory.setStock(ingredient, inventory.onHand(ingredient) + change, changes);
+                    applyAvailability(changes);
+                    break;
+                }
+                case JournalRecord::RecipeSet: {
+                    std::string itemId = in.getString();
+                    int64_t count = in.getInt();
+                    std::vector<Inventory::Component> components;
+                    for (int64_t i = 0; in.ok() && i < count && i < 1024; i++) {
+                        std::string name = in.getString();
+                        int32_t amount = static_cast<int32_t>(in.getInt());
+                        if (in.ok() && !name.empty()) components.push_back({inventory.ingredient(name), amount});
+                    }
+                    uint32_t item = menu.find(itemId);
+                    if (!in.ok()) return;
+                    if (item == MenuCatalog::kNone) break;
+                    std::vector<Inventory::Change> changes;
+                    drainInventory(changes);
+                    inventory.setRecipe(item, components, changes);
+                    applyAvailability(changes);
+                    break;
+                }
+                default:
+                    std::cerr << "Unknown journal record type " << static_cast<int>(type) << std::endl;
+                    return;
+            }
+        }
+    }
+
+    // Queues one operation's records and returns the sequence to settle. Called while the
+    // operation still holds its locks, so frames for one table follow the order of its changes.
+    uint64_t journalAppend(const RecordWriter& records) {
+        if (!journal || records.empty()) return 0;
+        framesSinceSnapshot++;
+        return journal->append(records);
+    }
+
+    // Waits until the records are durable, then writes a snapshot if one is due. Called
+    // with no locks held so concurrent operations share an fsync.
+    void journalSettle(uint64_t seq) {
+        if (seq == 0) return;
+        journal->waitDurable(seq);
+        if (framesSinceSnapshot >= kSnapshotInterval) {
+            // One terminal writes it; the rest carry on rather than queue behind it
+            std::unique_lock<std::mutex> serial(checkpointLock, std::try_to_lock);
+            if (serial.owns_lock() && framesSinceSnapshot >= kSnapshotInterval) checkpoint();
+        }
+    }
+
+    // Copies a snapshot order into the overlay so it can be changed. Caller holds
+    // snapshotLock, or stateLock exclusively.
+    std::shared_ptr<Order> materializeSnapshotOrder(size_t index) {
+        const SnapshotOrder& record = snapshot->section<SnapshotOrder>(kSnapshotOrders)[index];
+        auto order = makeOrder("ORD" + std::to_string(record.orderNumber), record.tableNumber, record.orderDay,
+                               record.orderMinute, record.customerCount, record.statusTimes[0]);
+        const SnapshotOrderLine* lines = snapshot->section<SnapshotOrderLine>(kSnapshotOrderLines) + record.firstLine;
+        for (uint32_t i = 0; i < record.lineCount; i++) {
+            order->addItem(internMenuItem(std::string(snapshot->str(lines[i].itemId))), lines[i].quantity,
+                           lines[i].unitCents);
+        }
+        std::string_view instructions = snapshot->str(record.specialInstructions);
+        if (!instructions.empty()) order->addSpecialInstructions(std::string(instructions));
+        for (size_t i = 1; i < kOrderStatusCount; i++) {
+            if (record.statusTimes[i] != 0) order->updateStatus(static_cast<OrderStatus>(i), record.statusTimes[i]);
+        }
+        order->updateStatus(static_cast<OrderStatus>(record.status), record.statusTimes[record.status]);
+        snapshotOrderShadowed[index] = true;
+        addOrder(order);
+        return order;
+    }
+
+    // Maps the snapshot and rebuilds the overlay from it: menu, tables, open orders and
+    // upcoming reservations. Paid orders and past reservations stay in the mapping.
+    bool loadSnapshot(uint64_t& generation) {
+        std::string error;
+        auto file = SnapshotFile::open(snapshotPath, error);
+        if (!file) {
+            if (error.empty()) return true; // no snapshot yet
+            std::cerr << error << std::endl;
+            return false;
+        }
+
+        menu.clear();
+        offered.clear();
+        inventory.clear();
+        for (auto& flag : soldOut) flag.store(false, std::memory_order_relaxed); // worked out again below
+        const SnapshotString* lists = file->section<SnapshotString>(kSnapshotStringLists);
+        const SnapshotMenuItem* items = file->section<SnapshotMenuItem>(kSnapshotMenu);
+        for (size_t i = 0; i < file->count(kSnapshotMenu); i++) {
+            const SnapshotMenuItem& record = items[i];
+            auto item = std::make_shared<MenuItem>(
+                std::string(file->str(record.itemId)), std::string(file->str(record.name)),
+                std::string(file->str(record.category)), std::string(file->str(record.description)),
+                record.priceCents / 100.0, record.preparationTime, record.spiceLevel, record.calories);
+            for (uint32_t k = 0; k < record.ingredientCount; k++) {
+                item->addIngredient(std::string(file->str(lists[record.firstIngredient + k])));
+            }
+            for (uint32_t k = 0; k < record.allergenCount; k++) {
+                item->addAllergen(std::string(file->str(lists[record.firstAllergen + k])));
+            }
+            item->updateAvailability(record.offered != 0);
+            addToMenu(*item);
+        }
+
+        std::vector<Inventory::Change> changes;
+        const SnapshotStock* stockRecords = file->section<SnapshotStock>(kSnapshotStock);
+        for (size_t i = 0; i < file->count(kSnapshotStock); i++) {
+            uint32_t ingredient = inventory.ingredient(file->str(stockRecords[i].ingredient));
+            inventory.setStock(ingredient, stockRecords[i].quantity, changes, stockRecords[i].tracked != 0);
+        }
+        const SnapshotRecipeLine* recipeLines = file->section<SnapshotRecipeLine>(kSnapshotRecipes);
+        size_t recipeCount = file->count(kSnapshotRecipes);
+        for (size_t first = 0, last = 0; first < recipeCount; first = last) {
+            std::vector<Inventory::Component> components;
+            for (last = first; last < recipeCount && file->str(recipeLines[last].itemId) ==
+                                                     file->str(recipeLines[first].itemId); last++) {
+                components.push_back({inventory.ingredient(file->str(recipeLines[last].ingredient)),
+                                      recipeLines[last].amount});
+            }
+            uint32_t item = menu.find(file->str(recipeLines[first].itemId));
+            if (item != MenuCatalog::kNone) inventory.setRecipe(item, components, changes);
+        }
+        applyAvailability(changes);
+
+        tables.clear();
+        tableIndex.clear();
+        reservationBook.clear();
+        const SnapshotTable* tableRecords = file->section<SnapshotTable>(kSnapshotTables);
+        for (size_t i = 0; i < file->count(kSnapshotTables); i++) {
+            const SnapshotTable& record = tableRecords[i];
+            auto table = std::make_shared<Table>(record.tableNumber, record.capacity,
+                                                 std::string(file->str(record.location)),
+                                                 std::string(file->str(record.specialFeatures)));
+            if (record.occupied) table->reserveTable();
+            addTable(table);
+        }
+
+        statusLists.clear();
+        orders.clear();
+        orderIndex.clear();
+        orderArenas.clear();
+        reservations.clear();
+        dailySummaries.clear();
+        snapshot = std::move(file);
+        snapshotOrderShadowed.assign(snapshot->count(kSnapshotOrders), false);
+        snapshotDayShadowed.assign(snapshot->count(kSnapshotDays), false);
+        const uint32_t* openOrders = snapshot->section<uint32_t>(kSnapshotOpenOrders);
+        for (size_t i = 0; i < snapshot->count(kSnapshotOpenOrders); i++) {
+            if (openOrders[i] < snapshotOrderShadowed.size()) materializeSnapshotOrder(openOrders[i]);
+        }
+
+        // Reservations from yesterday on still matter for conflicts and listings
+        int cutoff = ServiceClock::now().day - 1;
+        const SnapshotReservation* first = snapshot->section<SnapshotReservation>(kSnapshotReservations);
+        const SnapshotReservation* last = first + snapshot->count(kSnapshotReservations);
+        const SnapshotReservation* upcoming = std::lower_bound(first, last, cutoff,
+            [](const SnapshotReservation& r, int day) { return r.day < day; });
+        snapshotReservationsLoaded = upcoming - first;
+        for (const SnapshotReservation* record = upcoming; record != last; ++record) {
+            auto reservation = std::make_shared<Reservation>(
+                "RES" + std::to_string(record->reservationNumber), std::string(snapshot->str(record->customerName)),
+                std::string(snapshot->str(record->phone)), record->partySize, record->day, record->minute,
+                record->tableNumber, record->durationMinutes);
+            std::string_view requests = snapshot->str(record->specialRequests);
+            if (!requests.empty()) reservation->addSpecialRequests(std::string(requests));
+            if (!addReservation(reservation)) reportDoubleBooking(*reservation);
+        }
+
+        nextOrderId = static_cast<int>(snapshot->header().nextOrderId);
+        nextReservationId = static_cast<int>(snapshot->header().nextReservationId);
+        generation = snapshot->header().generation;
+        return true;
+    }
+
+    // Refills the sales history from the paid orders in the snapshot. Only done at
+    // startup: the history lives in memory and already holds everything a later
+    // snapshot writes out. Caller holds stateLock exclusively.
+    void loadSalesHistory() {
+        sales.clear();
+        if (!snapshot) return;
+        const SnapshotOrder* records = snapshot->section<SnapshotOrder>(kSnapshotOrders);
+        const SnapshotOrderLine* allLines = snapshot->section<SnapshotOrderLine>(kSnapshotOrderLines);
+        std::unordered_map<uint32_t, uint32_t> itemByString; // pool offset -> menu position
+        std::vector<SalesHistory::Line> lines;
+        for (size_t i = 0; i < snapshot->count(kSnapshotOrders); i++) {
+            const SnapshotOrder& record = records[i];
+            if (record.status != static_cast<uint8_t>(OrderStatus::Paid)) continue;
+            lines.clear();
+            for (uint32_t k = 0; k < record.lineCount; k++) {
+                const SnapshotOrderLine& line = allLines[record.firstLine + k];
+                auto [it, inserted] = itemByString.insert({line.itemId.offset, 0});
+                if (inserted) it->second = internMenuItem(std::string(snapshot->str(line.itemId)));
+                lines.push_back({it->second, line.quantity, line.unitCents});
+            }
+            sales.addOrder(record.orderDay, record.orderMinute / 60, record.tableNumber, record.customerCount, lines, 1);
+        }
+    }
+
+    // Learns from one paid order how long its table stayed, taking the time it was placed
+    // for when the party sat down. Times are unix seconds, 0 if never reached. Caller
+    // holds floorLock.
+    void learnStay(int tableNumber, int customers, int64_t placed, int64_t foodUp, int64_t paid) {
+        auto table = findTable(tableNumber);
+        if (!table || placed == 0 || paid < placed) return;
+        waitlist.learn(table->getLocation(), customers, (paid - placed) / 60,
+                       foodUp > 0 && paid >= foodUp ? (paid - foodUp) / 60 : -1);
+    }
+
+    static int64_t foodUpTime(int64_t ready, int64_t served) {
+        return ready > 0 ? ready : served;
+    }
+
+    // Starts the waitlist from the recovered floor: each occupied table counts as seated
+    // when its oldest open order was placed, or now, and the usual stays are learned from
+    // the most recent paid orders. Only done at startup. Caller holds stateLock exclusively.
+    void loadTurns() {
+        int64_t now = ServiceClock::localMinute();
+        int64_t clock = static_cast<int64_t>(time(0));
+        std::lock_guard<std::mutex> floor(floorLock);
+        waitlist.clearTables();
+        for (const auto& table : tables) {
+            waitlist.addTable(table->getTableNumber(), table->getCapacity(), table->getLocation());
+        }
+
+        if (snapshot) {
+            // The latest paid orders, learned oldest first so the newest count most
+            const SnapshotOrder* records = snapshot->section<SnapshotOrder>(kSnapshotOrders);
+            std::vector<const SnapshotOrder*> recent;
+            for (size_t i = snapshot->count(kSnapshotOrders); i-- > 0 && recent.size() < kTurnHistoryOrders;) {
+                if (snapshotOrderShadowed[i] || records[i].status != static_cast<uint8_t>(OrderStatus::Paid)) continue;
+                recent.push_back(&records[i]);
+            }
+            for (auto it = recent.rbegin(); it != recent.rend(); ++it) {
+                const uint32_t* times = (*it)->statusTimes;
+                learnStay((*it)->tableNumber, (*it)->customerCount, times[0],
+                          foodUpTime(times[static_cast<size_t>(OrderStatus::Ready)],
+                                     times[static_cast<size_t>(OrderStatus::Served)]),
+                          times[static_cast<size_t>(OrderStatus::Paid)]);
+            }
+        }
+
+        std::unordered_map<int, int64_t> seatedAt; // table -> its oldest open order
+        for (const auto& order : orders) {
+            OrderStatus status = order->getStatus();
+            if (status == OrderStatus::Paid) {
+                learnStay(order->getTableNumber(), order->getCustomerCount(), order->getStatusTime(OrderStatus::Pending),
+                          foodUpTime(order->getStatusTime(OrderStatus::Ready), order->getStatusTime(OrderStatus::Served)),
+                          order->getStatusTime(OrderStatus::Paid));
+            } else if (status != OrderStatus::Void && status != OrderStatus::Refunded) {
+                auto [it, inserted] = seatedAt.insert({order->getTableNumber(), placedAt(*order)});
+                if (!inserted) it->second = std::min(it->second, placedAt(*order));
+            }
+        }
+        for (const auto& table : tables) {
+            if (!table->getOccupancy()) continue;
+            auto it = seatedAt.find(table->getTableNumber());
+            waitlist.seat(table->getTableNumber(), 0, it != seatedAt.end() ? it->second : now, false);
+        }
+        for (const auto& order : orders) {
+            OrderStatus status = order->getStatus();
+            if (status == OrderStatus::Paid || status == OrderStatus::Void || status == OrderStatus::Refunded) continue;
+            int longest = 0;
+            for (const auto& line : order->getItems()) {
+                longest = std::max(longest, menu.preparationTime(line.menuIndex));
+            }
+            waitlist.ordered(order->getTableNumber(), order->getOrderId(), order->getCustomerCount(),
+                             placedAt(*order) + longest);
+            if (inKitchen(status)) continue;
+            int64_t foodUp = foodUpTime(order->getStatusTime(OrderStatus::Ready), order->getStatusTime(OrderStatus::Served));
+            waitlist.leftKitchen(order->getOrderId(), now - std::max<int64_t>(0, clock - foodUp) / 60, true);
+        }
+    }
+
+    // The state a checkpoint writes out, copied under the locks so the snapshot can be
+    // built and written without them. Reservations never change once made, so sharing
+    // them is enough; orders do change, so the overlay's are copied.
+    struct Checkpoint {
+        std::unique_ptr<SnapshotBuilder> builder; // menu, tables, stock and recipes already added
+        uint64_t generation = 0;                  // the journal generation the snapshot covers
+        std::shared_ptr<const SnapshotFile> previous;
+        std::vector<bool> orderShadowed;
+        std::vector<bool> dayShadowed;
+        size_t reservationsLoaded = 0;
+        std::vector<std::pair<uint32_t, Order>> orders; // overlay orders by number
+        std::vector<std::shared_ptr<Reservation>> reservations;
+        std::map<int, DailySummary> days;
+    };
+
+    std::string segmentPath(uint64_t generation) const {
+        return journalPath + "." + std::to_string(generation);
+    }
+
+    // Copies the state for a checkpoint and moves the journal aside, so the frames after
+    // this point land in a new journal. Costs the overlay, not the history: the previous
+    // snapshot is shared, not copied. Caller holds checkpointLock, inventoryLock and
+    // stateLock exclusively. Returns null if the journal could not be moved.
+    std::unique_ptr<Checkpoint> captureCheckpoint() {
+        std::vector<Inventory::Change> changes;
+        drainInventory(changes); // every order in the snapshot comes off the stock in it
+        applyAvailability(changes);
+
+        auto checkpoint = std::make_unique<Checkpoint>();
+        checkpoint->generation = journalGeneration;
+        checkpoint->builder = std::make_unique<SnapshotBuilder>(journalGeneration, nextOrderId, nextReservationId);
+        SnapshotBuilder& builder = *checkpoint->builder;
+        for (uint32_t i = 0; i < menu.size(); i++) builder.addMenuItem(menu, i, offered[i] != 0);
+        for (const auto& table : tables) builder.addTable(*table);
+        for (uint32_t i = 0; i < inventory.size(); i++) builder.addStock(inventory, i);
+        for (uint32_t i = 0; i < menu.size(); i++) builder.addRecipe(menu, inventory, i);
+
+        checkpoint->previous = snapshot;
+        checkpoint->orderShadowed = snapshotOrderShadowed;
+        checkpoint->dayShadowed = snapshotDayShadowed;
+        checkpoint->reservationsLoaded = snapshotReservationsLoaded;
+        checkpoint->orders.reserve(orders.size());
+        for (const auto& order : orders) {
+            checkpoint->orders.emplace_back(static_cast<uint32_t>(idNumber(order->getOrderId())), *order);
+        }
+        checkpoint->reservations = reservations;
+        checkpoint->days = dailySummaries;
+
+        if (!journal->rotate(journalPath, segmentPath(journalGeneration), journalGeneration + 1)) {
+            std::cerr << "Could not move the journal aside; no snapshot written." << std::endl;
+            return nullptr;
+        }
+        journalSegments.push_back(journalGeneration);
+        journalGeneration++;
+        framesSinceSnapshot = 0;
+        return checkpoint;
+    }
+
+    // Merges the copied overlay with the untouched part of the previous snapshot and
+    // writes the result to path. Needs no locks.
+    static bool writeCheckpoint(Checkpoint& checkpoint, const std::string& path) {
+        SnapshotBuilder& builder = *checkpoint.builder;
+        const SnapshotFile* previous = checkpoint.previous.get();
+
+        // Orders go out sorted by number: untouched snapshot orders merged with the overlay
+        auto& overlayOrders = checkpoint.orders;
+        std::sort(overlayOrders.begin(), overlayOrders.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        size_t snapshotCount = previous ? previous->count(kSnapshotOrders) : 0;
+        const SnapshotOrder* snapshotOrders = previous ? previous->section<SnapshotOrder>(kSnapshotOrders) : nullptr;
+        size_t next = 0;
+        for (size_t i = 0; i < snapshotCount; i++) {
+            if (checkpoint.orderShadowed[i]) continue;
+            while (next < overlayOrders.size() && overlayOrders[next].first < snapshotOrders[i].orderNumber) {
+                builder.addOrder(overlayOrders[next].first, overlayOrders[next].second);
+                next++;
+            }
+            builder.copyOrder(*previous, snapshotOrders[i]);
+        }
+        for (; next < overlayOrders.size(); next++) {
+            builder.addOrder(overlayOrders[next].first, overlayOrders[next].second);
+        }
+
+        if (previous) {
+            const SnapshotReservation* records = previous->section<SnapshotReservation>(kSnapshotReservations);
+            for (size_t i = 0; i < checkpoint.reservationsLoaded; i++) {
+                builder.copyReservation(*previous, records[i]);
+            }
+        }
+        for (const auto& reservation : checkpoint.reservations) {
+            builder.addReservation(static_cast<uint32_t>(idNumber(reservation->getReservationId())), *reservation);
+        }
+
+        // Days merged in order, overlay copies replacing their snapshot originals
+        auto day = checkpoint.days.begin();
+        size_t dayCount = previous ? previous->count(kSnapshotDays) : 0;
+        const SnapshotDay* snapshotDays = previous ? previous->section<SnapshotDay>(kSnapshotDays) : nullptr;
+        for (size_t i = 0; i < dayCount; i++) {
+            if (checkpoint.dayShadowed[i]) continue;
+            for (; day != checkpoint.days.end() && day->first < snapshotDays[i].day; ++day) {
+                builder.addDay(day->first, day->second);
+            }
+            builder.copyDay(*previous, snapshotDays[i]);
+        }
+        for (; day != checkpoint.days.end(); ++day) builder.addDay(day->first, day->second);
+
+        std::string contents = builder.serialize();
+        std::string tempPath = path + ".tmp";
+        int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok = fd >= 0 && writeAll(fd, contents) && ::fsync(fd) == 0;
+        if (fd >= 0) ::close(fd);
+        return ok && std::rename(tempPath.c_str(), path.c_str()) == 0;
+    }
+
+    // Remaps the new snapshot and replays the journal written since the capture over it,
+    // which also drops paid orders from the overlay. Costs the open orders and the frames
+    // since the capture. Caller holds checkpointLock, inventoryLock and stateLock
+    // exclusively.
+    bool installCheckpoint() {
+        journal->flush();
+        std::vector<Inventory::Change> changes;
+        drainInventory(changes); // the snapshot and the replay below stand in for these
+        int orderId = nextOrderId, reservationId = nextReservationId;
+        uint64_t generation = 0;
+        if (!loadSnapshot(generation)) return false;
+
+        catchingUp = true;
+        size_t frames = 0;
+        uint64_t journalFileGeneration = 0;
+        uint32_t version = 0;
+        readFrames(journalPath, journalFileGeneration, version, [&](RecordReader& in) {
+            applyRecords(in, version);
+            frames++;
+        });
+        catchingUp = false;
+        changes.clear();
+        drainInventory(changes);
+        applyAvailability(changes);
+        nextOrderId = std::max(nextOrderId.load(), orderId);
+        nextReservationId = std::max(nextReservationId.load(), reservationId);
+        framesSinceSnapshot = frames;
+        return true;
+    }
+
+    // Writes out a captured checkpoint, remaps it and deletes the journals it covers.
+    // Caller holds checkpointLock and no state locks.
+    bool finishCheckpoint(std::unique_ptr<Checkpoint> captured) {
+        if (!writeCheckpoint(*captured, snapshotPath)) {
+            std::cerr << "Snapshot failed; keeping the journals." << std::endl;
+            return false;
+        }
+        uint64_t covered = captured->generation;
+        captured.reset(); // the old mapping goes once the new one replaces it
+        {
+            std::lock_guard<std::mutex> stock(inventoryLock);
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            if (!installCheckpoint()) return false;
+        }
+        auto end = std::remove_if(journalSegments.begin(), journalSegments.end(), [&](uint64_t segment) {
+            if (segment > covered) return false;
+            ::unlink(segmentPath(segment).c_str());
+            return true;
+        });
+        journalSegments.erase(end, journalSegments.end());
+        return true;
+    }
+
+    // Writes a snapshot covering every journaled change so far, holding the state locks
+    // only to copy the overlay at the start and to remap at the end. Caller holds
+    // checkpointLock.
+    bool checkpoint() {
+        std::unique_ptr<Checkpoint> captured;
+        {
+            std::lock_guard<std::mutex> stock(inventoryLock);
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            captured = captureCheckpoint();
+        }
+        return captured && finishCheckpoint(std::move(captured));
+    }
+
+public:
+    // IDs of location L (1 and up in a multi-location process, 0 when running alone) are
+    // numbered from L * kLocationIdBlock, so ORD30001001 is an order of location 3 and an
+    // ID alone says which location owns it
+    static const int kLocationIdBlock = 10000000;
+    static const int kMaxLocation = 99;
+
+    Restaurant(std::string name, int location = 0)
+        : restaurantName(name), nextOrderId(location * kLocationIdBlock + 1001),
+          nextReservationId(location * kLocationIdBlock + 2001),
+          journalGeneration(0), framesSinceSnapshot(0), snapshotReservationsLoaded(0) {
+        initializeMenu();
+        initializeTables();
+        initializeKitchen();
+    }
+
+    const std::string& getName() const { return restaurantName; }
+
+    // Location number encoded in an order or reservation ID (see kLocationIdBlock)
+    static int locationOf(const std::string& id) {
+        return idNumber(id) / kLocationIdBlock;
+    }
+
+    // Menu and floor plan changes are setup-time only: not safe while terminals are running
+    // Same ID added again replaces the existing entry in place, keeping its position. The
+    // item's recipe starts as one unit of each listed ingredient.
+    void addMenuItem(const std::shared_ptr<MenuItem>& item) {
+        uint32_t index = addToMenu(*item);
+        std::vector<Inventory::Component> recipe;
+        for (const auto& ingredient : item->getIngredients()) recipe.push_back({inventory.ingredient(ingredient), 1});
+        std::vector<Inventory::Change> changes;
+        inventory.setRecipe(index, recipe, changes);
+        applyAvailability(changes);
+    }
+
+    // Menu position of the item, for order lines. An ID no longer on the menu (possible
+    // only when recovering) gets an unavailable placeholder so its orders still load.
+    // Changes the menu in that case, so callers other than recovery must pass items
+    // known to be on it; every snapshot line names an item in the snapshot's menu.
+    uint32_t internMenuItem(const std::string& itemId) {
+        uint32_t index = menu.find(itemId);
+        if (index != MenuCatalog::kNone) return index;
+        MenuItem placeholder(itemId, itemId, "Unknown", "No longer on the menu", 0.0, 0);
+        placeholder.updateAvailability(false);
+        return addToMenu(placeholder);
+    }
+
+    // A new order, allocated from its business day's arena
+    std::shared_ptr<Order> makeOrder(const std::string& orderId, int tableNumber, int day, int minute,
+                                     int customers, int64_t placedAt) {
+        std::shared_ptr<OrderArena> arena;
+        {
+            std::lock_guard<std::mutex> lock(arenaLock);
+            auto& slot = orderArenas[day];
+            if (!slot) slot = std::make_shared<OrderArena>();
+            arena = slot;
+        }
+        return std::allocate_shared<Order>(ArenaAllocator<Order>(std::move(arena)), orderId, tableNumber, day, minute,
+                                           customers, placedAt);
+    }
+
+    void addTable(const std::shared_ptr<Table>& table) {
+        reservationBook.addTable(table->getTableNumber(), table->getCapacity());
+        {
+            std::lock_guard<std::mutex> floor(floorLock);
+            waitlist.addTable(table->getTableNumber(), table->getCapacity(), table->getLocation());
+        }
+        auto [it, inserted] = tableIndex.insert({table->getTableNumber(), table});
+        if (!inserted) {
+            std::replace(tables.begin(), tables.end(), it->second, table);
+            it->second = table;
+            return;
+        }
+        tables.push_back(table);
+    }
+
+    void addOrder(const std::shared_ptr<Order>& order) {
+        auto replaced = orderIndex.insert(order);
+        {
+            std::lock_guard<std::mutex> lock(statusLock);
+            if (replaced) statusLists.unlink(*replaced);
+            statusLists.link(*order);
+        }
+        std::lock_guard<std::mutex> lock(ordersLock);
+        if (replaced) {
+            std::replace(orders.begin(), orders.end(), replaced, order);
+            return;
+        }
+        orders.push_back(order);
+    }
+
+    // Menu position of the item, or MenuCatalog::kNone
+    uint32_t findMenuItem(std::string_view itemId) const {
+        return menu.find(itemId);
+    }
+
+    // Not synchronized against menu changes, which happen at setup time only
+    const MenuCatalog& getMenu() const { return menu; }
+    const Inventory& getInventory() const { return inventory; }
+
+    std::shared_ptr<Table> findTable(int tableNumber) const {
+        auto it = tableIndex.find(tableNumber);
+        return it != tableIndex.end() ? it->second : nullptr;
+    }
+
+    // The overlay order, or the snapshot's copied into the overlay. Caller holds stateLock.
+    std::shared_ptr<Order> lookupOrder(const std::string& orderId) {
+        if (auto order = orderIndex.find(orderId)) return order;
+        if (!snapshot || orderId.compare(0, 3, "ORD") != 0) return nullptr;
+
+        uint32_t number = static_cast<uint32_t>(idNumber(orderId));
+        const SnapshotOrder* first = snapshot->section<SnapshotOrder>(kSnapshotOrders);
+        const SnapshotOrder* last = first + snapshot->count(kSnapshotOrders);
+        const SnapshotOrder* record = std::lower_bound(first, last, number,
+            [](const SnapshotOrder& o, uint32_t n) { return o.orderNumber < n; });
+        if (record == last || record->orderNumber != number || "ORD" + std::to_string(number) != orderId) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        if (snapshotOrderShadowed[record - first]) return orderIndex.find(orderId); // materialized meanwhile
+        return materializeSnapshotOrder(record - first);
+    }
+
+    std::shared_ptr<Order> findOrder(const std::string& orderId) {
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        return lookupOrder(orderId);
+    }
+
+    // Not synchronized; for single-threaded tools such as the benchmarks
+    const std::vector<std::shared_ptr<Order>>& getOrders() const { return orders; }
+
+    // Rebuilds state from the snapshot and journal in the directory, then journals
+    // every further change there. Files of an older format are upgraded on the way.
+    bool openJournal(const std::string& directory) {
+        std::lock_guard<std::mutex> checkpointing(checkpointLock);
+        std::unique_lock<std::mutex> stock(inventoryLock);
+        std::unique_lock<std::shared_mutex> exclusive(stateLock);
+        auto start = std::chrono::steady_clock::now();
+        snapshotPath = directory + "/restaurant.snapshot";
+        journalPath = directory + "/restaurant.journal";
+
+        std::string error;
+        if (!upgradeSnapshotFile(snapshotPath, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        uint64_t snapshotGeneration = 0;
+        if (!loadSnapshot(snapshotGeneration)) return false;
+        loadSalesHistory();
+
+        // Journals a checkpoint moved aside: the ones its snapshot covers are left over
+        // from a crash before it deleted them, the later ones are replayed in order
+        for (uint64_t segment = snapshotGeneration; segment > 0; segment--) {
+            if (::unlink(segmentPath(segment).c_str()) != 0) break;
+        }
+        uint64_t replayed = snapshotGeneration;
+        journalSegments.clear();
+        for (uint64_t segment = snapshotGeneration + 1;; segment++) {
+            uint64_t generation = 0;
+            uint32_t version = 0;
+            int64_t length = readFrames(segmentPath(segment), generation, version, [&](RecordReader& in) {
+                applyRecords(in, version);
+                framesSinceSnapshot++;
+            });
+            if (length == 0) break;
+            if (length < 0) {
+                std::cerr << segmentPath(segment) << " is not a journal this build reads." << std::endl;
+                return false;
+            }
+            journalSegments.push_back(segment);
+            replayed = segment;
+        }
+
+        uint64_t generation = 0;
+        uint32_t version = 0;
+        int64_t validLength = readFrames(journalPath, generation, version,
+            [&](RecordReader& in) {
+                // A journal the snapshot already covers is left over from a crash between
+                // writing a snapshot and starting the journal over, as earlier builds did.
+                if (generation > replayed) {
+                    applyRecords(in, version);
+                    framesSinceSnapshot++;
+                }
+            });
+        if (validLength < 0) {
+            std::cerr << journalPath << " is not a journal this build reads." << std::endl;
+            return false;
+        }
+        bool upgradeJournal = false;
+        if (validLength == 0 || generation <= replayed) {
+            validLength = 0;
+            generation = replayed + 1;
+        } else if (version < kJournalVersion) {
+            // New frames must not follow old ones, so the old journal is moved aside like a
+            // checkpoint would, and folded into a snapshot once recovery is done
+            if (::truncate(journalPath.c_str(), validLength) != 0 ||
+                std::rename(journalPath.c_str(), segmentPath(generation).c_str()) != 0) {
+                std::cerr << "Could not move " << journalPath << " aside to upgrade it." << std::endl;
+                return false;
+            }
+            journalSegments.push_back(generation);
+            validLength = 0;
+            generation++;
+            upgradeJournal = true;
+        }
+        std::vector<Inventory::Change> changes;
+        drainInventory(changes);
+        applyAvailability(changes);
+        loadTurns();
+
+        {
+            std::lock_guard<std::mutex> lock(kitchenLock);
+            kitchen.clear();
+            for (const auto& order : orders) {
+                if (inKitchen(order->getStatus())) addKitchenTicket(*order);
+            }
+            drainKitchen();
+        }
+
+        journalGeneration = generation;
+        journal = std::make_unique<Journal>(journalPath, validLength, journalGeneration);
+        if (!journal->healthy()) {
+            journal.reset();
+            return false;
+        }
+
+        if (snapshot || framesSinceSnapshot > 0) {
+            double elapsedMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "Recovered " << (snapshot ? snapshot->count(kSnapshotOrders) : 0)
+                      << " snapshot orders and " << framesSinceSnapshot << " journal entries in "
+                      << std::fixed << std::setprecision(1) << elapsedMs << " ms" << std::endl;
+        }
+        if (upgradeJournal) {
+            exclusive.unlock();
+            stock.unlock();
+            if (!checkpoint()) return false;
+            std::cout << "Upgraded " << journalPath << " from journal version " << version << std::endl;
+        }
+        return true;
+    }
+
+    void initializeMenu() {
+        // Appetizers
+        auto bruschetta = std::make_shared<MenuItem>("APP001", "Bruschetta", "Appetizer", 
+            "Toasted bread topped with tomatoes and basil", 8.99, 10, 1, 180);
+        bruschetta->addIngredient("Bread");
+        bruschetta->addIngredient("Tomatoes");
+        bruschetta->addIngredient("Basil");
+        bruschetta->addAllergen("Gluten");
+        addMenuItem(bruschetta);
+
+        // Main Courses
+        auto steak = std::make_shared<MenuItem>("MAIN001", "Ribeye Steak", "Main Course",
+            "12oz ribeye with mashed potatoes", 29.99, 20, 0, 650);
+        steak->addIngredient("Beef");
+        steak->addIngredient("Potatoes");
+        steak->addIngredient("Butter");
+        addMenuItem(steak);
+
+        auto pasta = std::make_shared<MenuItem>("MAIN002", "Fettuccine Alfredo", "Main Course",
+            "Creamy pasta with parmesan cheese", 16.99, 15, 0, 480);
+        pasta->addIngredient("Pasta");
+        pasta->addIngredient("Cream");
+        pasta->addIngredient("Parmesan");
+        pasta->addAllergen("Gluten");
+        pasta->addAllergen("Dairy");
+        addMenuItem(pasta);
+
+        // Desserts
+        auto cheesecake = std::make_shared<MenuItem>("DES001", "New York Cheesecake", "Dessert",
+            "Classic cheesecake with berry compote", 7.99, 5, 0, 320);
+        cheesecake->addIngredient("Cream Cheese");
+        cheesecake->addIngredient("Graham Cracker");
+        cheesecake->addIngredient("Berries");
+        cheesecake->addAllergen("Gluten");
+        cheesecake->addAllergen("Dairy");
+        addMenuItem(cheesecake);
+    }
+
+    void initializeTables() {
+        addTable(std::make_shared<Table>(1, 2, "Window", "Window view"));
+        addTable(std::make_shared<Table>(2, 4, "Main Hall", ""));
+        addTable(std::make_shared<Table>(3, 6, "Private Room", "Private dining"));
+        addTable(std::make_shared<Table>(4, 2, "Patio", "Outdoor seating"));
+        addTable(std::make_shared<Table>(5, 8, "Main Hall", "Round table"));
+    }
+
+    // The menu screen is rendered once per menu version and then reused, so the
+    // order-entry loop, which shows it before every line, only copies it out
+    std::shared_ptr<const std::string> menuScreen() {
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::lock_guard<std::mutex> lock(renderLock);
+        if (renderedMenu && renderedMenuVersion == menu.version()) return renderedMenu;
+
+        std::ostringstream out;
+        out << "\n=== " << restaurantName << " Menu ===\n";
+        uint32_t shownCategory = MenuCatalog::kNone;
+        for (uint32_t item : menu.filter(MenuQuery())) {
+            if (menu.categorySymbol(item) != shownCategory) {
+                shownCategory = menu.categorySymbol(item);
+                out << "\n--- " << menu.category(item) << " ---\n";
+            }
+            out << menu.itemId(item) << " - " << std::left << std::setw(25)
+                      << menu.name(item) << " - $" << formatMoney(menu.priceCents(item)) << " (" << menu.preparationTime(item) << " min)\n";
+        }
+        renderedMenu = std::make_shared<const std::string>(out.str());
+        renderedMenuVersion = menu.version();
+        return renderedMenu;
+    }
+
+    void displayMenu(std::ostream& out = std::cout) {
+        OperationTimer timer(Operation::MenuScreen);
+        auto screen = menuScreen();
+        out.write(screen->data(), static_cast<std::streamsize>(screen->size()));
+        out.flush();
+    }
+
+    // The menu items that pass every condition of the query, grouped like the menu
+    void displayFilteredMenu(const MenuQuery& query, std::ostream& destination = std::cout) {
+        ScreenWriter out(destination);
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::vector<uint32_t> matches = menu.filter(query);
+        // Withdrawn items stay in the catalogue for the orders that name them, off the menu
+        matches.erase(std::remove_if(matches.begin(), matches.end(), [this](uint32_t item) { return !offered[item]; }),
+                      matches.end());
+        size_t onMenu = std::count_if(offered.begin(), offered.end(), [](uint8_t flag) { return flag != 0; });
+        out << "\n=== Menu Filter ===\n";
+        uint32_t shownCategory = MenuCatalog::kNone;
+        for (uint32_t item : matches) {
+            if (menu.categorySymbol(item) != shownCategory) {
+                shownCategory = menu.categorySymbol(item);
+                out << "\n--- " << menu.category(item) << " ---\n";
+            }
+            out << menu.itemId(item) << " - " << std::left << std::setw(25) << menu.name(item) << " - $"
+                << formatMoney(menu.priceCents(item)) << " (" << menu.calories(item)
+                << " cal, spice " << menu.spiceLevel(item) << "/5)";
+            if (!menu.available(item)) out << " [unavailable]";
+            out << '\n';
+        }
+        out << "\n" << matches.size() << " of " << onMenu << " items match.\n";
+    }
+
+    void displayAvailableTables(std::ostream& destination = std::cout) {
+        ScreenWriter out(destination);
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        out << "\n=== Available Tables ===\n";
+        bool found = false;
+        for (const auto& table : tables) {
+            std::unique_lock<std::mutex> lock(tableLock(table->getTableNumber()));
+            if (!table->getOccupancy()) {
+                Table view = *table;
+                lock.unlock();
+                view.displayInfo(out);
+                found = true;
+            }
+        }
+        if (!found) {
+            out << "No available tables at the moment.\n";
+            std::vector<std::pair<int64_t, int>> turns;
+            {
+                std::lock_guard<std::mutex> floor(floorLock);
+                for (const auto& table : tables) {
+                    turns.push_back({waitlist.freeAt(table->getTableNumber()), table->getTableNumber()});
+                }
+            }
+            std::sort(turns.begin(), turns.end());
+            int64_t now = ServiceClock::localMinute();
+            for (size_t i = 0; i < turns.size() && i < 3; i++) {
+                out << "Table " << turns[i].second << " expected free at "
+                    << formatClock(static_cast<int>(std::max(turns[i].first, now) % 1440)) << '\n';
+            }
+        }
+    }
+
+    // Occupied tables by when they should turn, then the waiting parties with the table
+    // each is expected to get
+    void displayWaitlist(std::ostream& destination = std::cout) {
+        ScreenWriter out(destination);
+        pumpKitchen();
+        int64_t now = ServiceClock::localMinute();
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::lock_guard<std::mutex> lock(reservationLock);
+        std::lock_guard<std::mutex> floor(floorLock);
+        waitlist.match(now, reservationBook);
+        waitlist.display(now, out);
+    }
+
+    // Events from sequence from on, or the latest kFeedScreenEvents when from is 0, and
+    // the sequence to ask for next
+    void displayFeed(uint64_t from, std::ostream& destination = std::cout) const {
+        ScreenWriter out(destination);
+        uint64_t head = feed->head();
+        uint64_t oldest = feed->oldest();
+        if (from == 0) from = head > kFeedScreenEvents ? head - kFeedScreenEvents + 1 : 1;
+        out << "\n=== Change Feed ===\n";
+        if (from < oldest) {
+            out << "Events " << from << "-" << oldest - 1 << " were written over; showing from " << oldest << ".\n";
+            from = oldest;
+        }
+        ChangeFeed::Event event;
+        uint64_t next = from;
+        for (; next <= head; next++) {
+            ChangeFeed::Read read = feed->read(next, event);
+            if (read == ChangeFeed::Read::Overrun) { // written over while this screen was drawn
+                next = std::max(next + 1, feed->oldest()) - 1;
+                continue;
+            }
+            ChangeFeed::print(event, out);
+        }
+        if (from > head) out << "No events since " << head << ".\n";
+        out << "Next: " << next << '\n';
+    }
+
+    // Moves the change feed into the shared memory segment name for other processes to
+    // tail; setup-time only
+    bool openFeed(const std::string& name, std::string& error) {
+        auto shared = ChangeFeed::create(name, error);
+        if (!shared) return false;
+        feed = std::move(shared);
+        return true;
+    }
+
+    const ChangeFeed& changeFeed() const { return *feed; }
+
+    // Non-interactive operations. The console prompts below and the batch command
+    // mode both go through these; on failure they return false/null and set error.
+
+    static const int kDefaultReservationMinutes = 120;
+    static constexpr int kMaxLineQuantity = 999;      // portions of one item on one order line
+    static constexpr int kMaxPartySize = 100;         // guests on one order, as for tables and bookings
+    static constexpr int64_t kMaxPriceCents = 1000000; // $10,000.00 for one portion of a menu item
+
+    static bool parseSeating(const std::string& date, const std::string& time, int& day, int& minute,
+                             std::string& error) {
+        if (parseDate(date, day) && parseClock(time, minute)) return true;
+        error = "Invalid date or time; use YYYY-MM-DD and HH:MM.";
+        return false;
+    }
+
+    // Smallest table that seats the party and has no booking overlapping the seating.
+    // Caller holds reservationLock.
+    std::shared_ptr<Table> pickReservableTable(int partySize, int day, int minute, int durationMinutes,
+                                               std::string& error) const {
+        int64_t start = static_cast<int64_t>(day) * 1440 + minute;
+        int tableNumber = reservationBook.bestFit(partySize, start, start + durationMinutes);
+        if (tableNumber < 0) {
+            error = "No suitable tables available for the requested time.";
+            return nullptr;
+        }
+        return findTable(tableNumber);
+    }
+
+    std::shared_ptr<Table> findReservableTable(int partySize, const std::string& date, const std::string& time,
+                                               int durationMinutes, std::string& error) const {
+        int day = 0, minute = 0;
+        if (!parseSeating(date, time, day, minute, error)) return nullptr;
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::lock_guard<std::mutex> lock(reservationLock);
+        return pickReservableTable(partySize, day, minute, durationMinutes, error);
+    }
+
+    // Marks a table occupied for walk-in guests, or for the waiting party partyId, which
+    // then leaves the waitlist
+    bool seatTable(int tableNumber, std::string& error, const std::string& partyId = "") {
+        OperationTimer timer(Operation::SeatTable);
+        uint64_t seq = 0;
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            auto table = findTable(tableNumber);
+            if (!table) {
+                error = "Table not found.";
+                timer.failed();
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(tableLock(tableNumber));
+            std::lock_guard<std::mutex> floor(floorLock);
+            const Waitlist::Party* party = partyId.empty() ? nullptr : waitlist.find(partyId);
+            if (!partyId.empty() && !party) {
+                error = "Nobody on the waitlist as " + partyId + ".";
+                timer.failed();
+                return false;
+            }
+            if (party && party->size > table->getCapacity()) {
+                error = "Table " + std::to_string(tableNumber) + " seats " + std::to_string(table->getCapacity()) +
+                        "; " + partyId + " is a party of " + std::to_string(party->size) + ".";
+                timer.failed();
+                return false;
+            }
+            if (!table->reserveTable()) {
+                error = "Table " + std::to_string(tableNumber) + " is already occupied.";
+                timer.failed();
+                return false;
+            }
+            waitlist.seat(tableNumber, party ? party->size : 0, ServiceClock::localMinute());
+            publishTable(ChangeFeed::Kind::TableSeated, tableNumber, party ? party->size : 0);
+            if (party) waitlist.leave(partyId);
+            RecordWriter records;
+            encodeTable(records, JournalRecord::TableOccupied, tableNumber);
+            seq = journalAppend(records);
+        }
+        journalSettle(seq);
+        return true;
+    }
+
+    // Puts a walk-in party on the waitlist; quoted is set to the party as added, with the
+    // table it is expected to get and when
+    bool joinWaitlist(const std::string& name, const std::string& phone, int partySize, Waitlist::Party& quoted,
+                      std::string& error) {
+        if (name.empty() || partySize <= 0) {
+            error = "A waiting party needs a name and a positive size.";
+            return false;
+        }
+        pumpKitchen();
+        int64_t now = ServiceClock::localMinute();
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::lock_guard<std::mutex> lock(reservationLock);
+        std::lock_guard<std::mutex> floor(floorLock);
+        std::string partyId = waitlist.join(name, phone, partySize, now).id;
+        waitlist.match(now, reservationBook);
+        quoted = *waitlist.find(partyId);
+        return true;
+    }
+
+    bool leaveWaitlist(const std::string& partyId, std::string& error) {
+        std::lock_guard<std::mutex> floor(floorLock);
+        if (waitlist.leave(partyId)) return true;
+        error = "Nobody on the waitlist as " + partyId + ".";
+        return false;
+    }
+
+    // Books the best-fitting table for the seating. The table stays free until the party
+    // is seated; the booking only blocks that time slot for other reservations.
+    std::shared_ptr<Reservation> reserve(const std::string& name, const std::string& phone, int partySize,
+                                         const std::string& date, const std::string& time,
+                                         const std::string& requests, std::string& error,
+                                         int durationMinutes = kDefaultReservationMinutes) {
+        OperationTimer timer(Operation::Reserve);
+        if (partySize <= 0 || durationMinutes <= 0) {
+            error = "Party size and duration must be positive.";
+            timer.failed();
+            return nullptr;
+        }
+        int day = 0, minute = 0;
+        if (!parseSeating(date, time, day, minute, error)) {
+            timer.failed();
+            return nullptr;
+        }
+        std::shared_ptr<Reservation> reservation;
+        uint64_t seq = 0;
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            std::lock_guard<std::mutex> lock(reservationLock);
+            auto table = pickReservableTable(partySize, day, minute, durationMinutes, error);
+            if (!table) {
+                timer.failed();
+                return nullptr;
+            }
+
+            reservation = std::make_shared<Reservation>(generateReservationId(), name, phone, partySize,
+                                                        day, minute, table->getTableNumber(), durationMinutes);
+            if (!requests.empty()) {
+                reservation->addSpecialRequests(requests);
+            }
+            if (!addReservation(reservation)) { // pickReservableTable found the slot free
+                error = "Table " + std::to_string(table->getTableNumber()) + " is already booked at that time.";
+                timer.failed();
+                return nullptr;
+            }
+
+            ChangeFeed::Event event;
+            event.kind = ChangeFeed::Kind::ReservationMade;
+            event.table = reservation->getTableNumber();
+            event.number = static_cast<uint32_t>(idNumber(reservation->getReservationId()));
+            event.party = partySize;
+            event.day = day;
+            event.minute = minute;
+            feed->publish(event);
+
+            RecordWriter records;
+            encodeReservation(records, *reservation);
+            seq = journalAppend(records);
+        }
+        journalSettle(seq);
+        return reservation;
+    }
+
+    std::shared_ptr<Order> placeOrder(int tableNumber, int customerCount, const std::vector<OrderRequestLine>& lines,
+                                      const std::string& instructions, std::string& error) {
+        OperationTimer timer(Operation::PlaceOrder);
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        auto table = findTable(tableNumber);
+        std::unique_lock<std::mutex> lock(tableLock(tableNumber));
+        if (!table || !table->getOccupancy()) {
+            error = "Table not found or not occupied.";
+            timer.failed();
+            return nullptr;
+        }
+        if (customerCount <= 0 || customerCount > kMaxPartySize) {
+            error = "Invalid guest count; an order is for 1 to " + std::to_string(kMaxPartySize) + " guests.";
+            timer.failed();
+            return nullptr;
+        }
+
+        uint32_t positions[64];
+        std::vector<uint32_t> spilled;
+        uint32_t* items = positions;
+        if (lines.size() > 64) {
+            spilled.resize(lines.size());
+            items = spilled.data();
+        }
+        for (size_t i = 0; i < lines.size(); i++) {
+            const OrderRequestLine& line = lines[i];
+            uint32_t item = menu.find(line.itemId);
+            if (item == MenuCatalog::kNone || !menu.available(item) || soldOut[item].load(std::memory_order_relaxed)) {
+                error = "Item " + line.itemId + " not found or unavailable.";
+                timer.failed();
+                return nullptr;
+            }
+            if (line.quantity <= 0 || line.quantity > kMaxLineQuantity) {
+                error = "Invalid quantity for " + line.itemId + "; order 1 to " + std::to_string(kMaxLineQuantity) + ".";
+                timer.failed();
+                return nullptr;
+            }
+            items[i] = item;
+        }
+
+        ServiceClock::Reading now = ServiceClock::now();
+        auto order = makeOrder(generateOrderId(), tableNumber, businessDay(now), now.minute, customerCount,
+                               static_cast<int64_t>(time(0)));
+        for (size_t i = 0; i < lines.size(); i++) {
+            order->addItem(items[i], lines[i].quantity, menu.priceCents(items[i]));
+        }
+        if (!instructions.empty()) {
+            order->addSpecialInstructions(instructions);
+        }
+        addOrder(order);
+        noteOrdered(*order, static_cast<int64_t>(now.day) * 1440 + now.minute);
+        publishOrder(ChangeFeed::Kind::OrderPlaced, *order);
+        addKitchenTicket(*order);
+        stockInbox.push(order);
+
+        RecordWriter records;
+        encodeOrder(records, *order);
+        uint64_t seq = journalAppend(records);
+        lock.unlock();
+        state.unlock();
+        pumpKitchen();
+        pumpInventory();
+        journalSettle(seq);
+        return order;
+    }
+
+    bool setOrderStatus(const std::string& orderId, OrderStatus newStatus, std::string& error) {
+        OperationTimer timer(Operation::SetStatus);
+        uint64_t seq = 0;
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            auto order = lookupOrder(orderId);
+            if (!order) {
+                error = "Order not found!";
+                timer.failed();
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(tableLock(order->getTableNumber()));
+            OrderStatus oldStatus = order->getStatus();
+            if (!canTransition(oldStatus, newStatus)) {
+                error = "Cannot change " + orderId + " from " + statusName(oldStatus) + " to " +
+                        statusName(newStatus) + ".";
+                timer.failed();
+                return false;
+            }
+            int64_t now = static_cast<int64_t>(time(0));
+            applyStatus(*order, newStatus, now);
+            publishOrder(ChangeFeed::Kind::OrderStatus, *order);
+            if (inKitchen(oldStatus) && !inKitchen(newStatus)) {
+                removeKitchenTicket(orderId);
+                std::lock_guard<std::mutex> floor(floorLock);
+                waitlist.leftKitchen(orderId, ServiceClock::localMinute(), newStatus != OrderStatus::Void);
+            }
+
+            RecordWriter records;
+            encodeStatus(records, orderId, newStatus, now);
+            if (newStatus == OrderStatus::Paid) {
+                // Free the table
+                if (auto table = findTable(order->getTableNumber())) {
+                    table->freeTable();
+                    encodeTable(records, JournalRecord::TableFreed, table->getTableNumber());
+                    publishTable(ChangeFeed::Kind::TableFreed, table->getTableNumber());
+                    std::lock_guard<std::mutex> floor(floorLock);
+                    waitlist.paid(table->getTableNumber(), ServiceClock::localMinute());
+                }
+            }
+            seq = journalAppend(records);
+        }
+        pumpKitchen();
+        journalSettle(seq);
+        return true;
+    }
+
+    // Sets an ingredient's stock to a counted level or, with delivery, adds to it (a
+    // negative delivery writes stock off). The ingredient is tracked from then on, and
+    // items 86'd for want of it return once every ingredient covers a portion.
+    bool adjustStock(const std::string& ingredient, int64_t quantity, bool delivery, std::string& error) {
+        if (ingredient.empty()) {
+            error = "No ingredient given.";
+            return false;
+        }
+        uint64_t seq = 0;
+        {
+            std::lock_guard<std::mutex> stock(inventoryLock);
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            std::vector<Inventory::Change> changes;
+            drainInventory(changes);
+            applyAvailability(changes);
+            uint32_t id = inventory.ingredient(ingredient);
+            if (delivery && !inventory.isTracked(id)) {
+                error = ingredient + " has no stock level yet; count it first.";
+                return false;
+            }
+            int64_t level = delivery ? inventory.onHand(id) + quantity : quantity;
+            if (level < 0 && quantity < 0) {
+                error = "Only " + std::to_string(inventory.onHand(id)) + " of " + ingredient + " on hand.";
+                return false;
+            }
+            RecordWriter records;
+            encodeStock(records, ingredient, level - inventory.onHand(id));
+            changes.clear();
+            inventory.setStock(id, level, changes);
+            applyAvailability(changes);
+            seq = journalAppend(records);
+        }
+        journalSettle(seq);
+        return true;
+    }
+
+    // Replaces what one portion of the item takes off the stock
+    bool setRecipe(const std::string& itemId, const std::vector<std::pair<std::string, int>>& components,
+                   std::string& error) {
+        for (const auto& [ingredient, amount] : components) {
+            if (ingredient.empty() || amount <= 0) {
+                error = "Each ingredient needs a name and a positive amount.";
+                return false;
+            }
+        }
+        uint64_t seq = 0;
+        {
+            std::lock_guard<std::mutex> stock(inventoryLock);
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            uint32_t item = menu.find(itemId);
+            if (item == MenuCatalog::kNone) {
+                error = "Item " + itemId + " is not on the menu.";
+                return false;
+            }
+            std::vector<Inventory::Change> changes;
+            drainInventory(changes); // orders already placed use the old recipe
+            std::vector<Inventory::Component> recipe;
+            for (const auto& [ingredient, amount] : components) {
+                recipe.push_back({inventory.ingredient(ingredient), amount});
+            }
+            inventory.setRecipe(item, recipe, changes);
+            applyAvailability(changes);
+            RecordWriter records;
+            encodeRecipe(records, item);
+            seq = journalAppend(records);
+        }
+        journalSettle(seq);
+        return true;
+    }
+
+    // Outcome of an import. A menu or table file goes in whole or not at all; a
+    // reservation file books every line it can.
+    struct ImportResult {
+        size_t records = 0;
+        size_t added = 0;
+        size_t updated = 0;
+        size_t withdrawn = 0;            // menu items offered before but missing from the file
+        std::vector<std::string> errors; // FILE:LINE: problem, one per bad line
+    };
+
+private:
+    static bool importNumber(std::string_view text, int low, int high, int& value) {
+        auto [end, status] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return status == std::errc() && end == text.data() + text.size() && value >= low && value <= high;
+    }
+
+    static bool importFlag(std::string_view text, bool& value) {
+        if (text == "yes" || text == "true" || text == "1") value = true;
+        else if (text == "no" || text == "false" || text == "0") value = false;
+        else return false;
+        return true;
+    }
+
+    static void importError(ImportResult& result, const ImportFile& file, size_t line, const std::string& problem) {
+        result.errors.push_back(file.name() + ":" + std::to_string(line) + ": " + problem);
+    }
+
+    // Reads and checks a menu file. Required columns: id, name, category, price and
+    // minutes (preparation time); optional: description, spice (0-5), calories,
+    // available (yes/no), and ingredients and allergens as lists.
+    static bool readMenuFile(const std::string& path, std::vector<MenuItem>& items, ImportResult& result,
+                             std::string& error) {
+        enum { Id, Name, Category, Price, Minutes, Description, Spice, Calories, Available, Ingredients, Allergens };
+        auto file = ImportFile::open(path, {{"id", true, false}, {"name", true, false}, {"category", true, false},
+                                            {"price", true, false}, {"minutes", true, false},
+                                            {"description", false, false}, {"spice", false, false},
+                                            {"calories", false, false}, {"available", false, false},
+                                            {"ingredients", false, true}, {"allergens", false, true}},
+                                     error);
+        if (!file) return false;
+        ImportFile::Record record;
+        std::string problem;
+        std::unordered_map<std::string, size_t> lineOf; // item ID -> line it was first given on
+        while (file->next(record, problem)) {
+            result.records++;
+            int64_t cents = 0;
+            int minutes = 0, spice = 0, calories = 0;
+            bool available = true;
+            std::string id(record.has(Id) ? record.text(Id) : "");
+            if (problem.empty()) {
+                if (id.find_first_of(" \t") != std::string::npos) problem = "id \"" + id + "\" has spaces";
+                else if (!parseCents(record.text(Price), cents)) problem = "price is not an amount";
+                else if (cents > kMaxPriceCents) problem = "price must be 0 to " + formatMoney(kMaxPriceCents);
+                else if (!importNumber(record.text(Minutes), 0, 1440, minutes)) problem = "minutes must be 0 to 1440";
+                else if (record.has(Spice) && !importNumber(record.text(Spice), 0, 5, spice)) problem = "spice must be 0 to 5";
+                else if (record.has(Calories) && !importNumber(record.text(Calories), 0, 100000, calories)) {
+                    problem = "calories must be 0 to 100000";
+                } else if (record.has(Available) && !importFlag(record.text(Available), available)) {
+                    problem = "available must be yes or no";
+                }
+            }
+            if (problem.empty()) {
+                auto [first, inserted] = lineOf.insert({id, record.line});
+                if (!inserted) problem = "item " + id + " is also on line " + std::to_string(first->second);
+            }
+            if (!problem.empty()) {
+                importError(result, *file, record.line, problem);
+                continue;
+            }
+            MenuItem item(id, std::string(record.text(Name)), std::string(record.text(Category)),
+                          std::string(record.text(Description)), cents / 100.0, minutes, spice, calories);
+            for (std::string_view name : record.list(Ingredients)) item.addIngredient(std::string(name));
+            for (std::string_view name : record.list(Allergens)) item.addAllergen(std::string(name));
+            item.updateAvailability(available);
+            items.push_back(std::move(item));
+        }
+        return true;
+    }
+
+    // Whether the item's ingredient list in the catalogue differs from the one given
+    static bool ingredientsChanged(const MenuCatalog& catalog, uint32_t index, const MenuItem& item) {
+        auto current = catalog.ingredients(index);
+        if (current.size() != item.getIngredients().size()) return true;
+        for (size_t k = 0; k < current.size(); k++) {
+            if (catalog.symbolName(current.begin()[k]) != item.getIngredients()[k]) return true;
+        }
+        return false;
+    }
+
+public:
+    // Replaces the menu with the file's (see readMenuFile). Items keep their menu
+    // positions; items not in the file stay behind, withdrawn, so older orders still
+    // name them. The new catalogue is built from a copy of the live one while terminals
+    // keep ordering, then swapped in under the exclusive lock in one step, so every
+    // reader sees the old menu or the new one and never a mix. A new item, or one whose
+    // ingredients changed, gets the default recipe of one unit of each ingredient.
+    bool importMenu(const std::string& path, ImportResult& result, std::string& error) {
+        std::vector<MenuItem> items;
+        if (!readMenuFile(path, items, result, error)) return false;
+        if (!result.errors.empty()) {
+            error = std::to_string(result.errors.size()) + " bad lines in " + path + "; the menu is unchanged.";
+            return false;
+        }
+        if (items.empty()) {
+            error = path + " lists no items; the menu is unchanged.";
+            return false;
+        }
+
+        std::lock_guard<std::mutex> checkpointing(checkpointLock);
+        std::lock_guard<std::mutex> serial(importLock);
+        std::unique_ptr<Checkpoint> captured;
+        MenuCatalog next;
+        std::vector<uint8_t> nextOffered;
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            next = menu;
+            nextOffered = offered;
+        }
+        size_t before = next.size();
+        std::vector<uint32_t> newRecipes;
+        for (const auto& item : items) {
+            uint32_t index = next.find(item.getItemId());
+            if (index != MenuCatalog::kNone && ingredientsChanged(next, index, item)) newRecipes.push_back(index);
+        }
+        std::vector<uint32_t> positions = next.addAll(items, result.updated);
+        result.added = items.size() - result.updated;
+        std::vector<uint8_t> listed(next.size(), 0);
+        nextOffered.resize(next.size(), 0);
+        for (size_t k = 0; k < items.size(); k++) {
+            listed[positions[k]] = 1;
+            nextOffered[positions[k]] = items[k].getAvailability();
+            if (positions[k] >= before) newRecipes.push_back(positions[k]);
+        }
+        for (uint32_t index = 0; index < before; index++) {
+            if (listed[index]) continue;
+            result.withdrawn += nextOffered[index];
+            nextOffered[index] = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> stock(inventoryLock);
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            std::vector<Inventory::Change> changes;
+            drainInventory(changes); // orders already placed use the old recipes
+            while (soldOut.size() < next.size()) soldOut.emplace_back(false);
+            for (uint32_t index : newRecipes) {
+                std::vector<Inventory::Component> recipe;
+                for (uint32_t symbol : next.ingredients(index)) {
+                    recipe.push_back({inventory.ingredient(next.symbolName(symbol)), 1});
+                }
+                inventory.setRecipe(index, recipe, changes);
+            }
+            markSoldOut(changes);
+            for (uint32_t index = 0; index < next.size(); index++) {
+                next.updateAvailability(index, nextOffered[index] && !soldOut[index].load(std::memory_order_relaxed));
+            }
+            std::swap(menu, next);
+            offered.swap(nextOffered);
+            {
+                std::lock_guard<std::mutex> lock(renderLock);
+                renderedMenu.reset();
+            }
+            // Menus are not journaled; the snapshot keeps it. Until it is written, a crash
+            // recovers the old menu, and orders on new items replay with placeholders.
+            if (journal) captured = captureCheckpoint();
+        }
+        if (captured) finishCheckpoint(std::move(captured));
+        return true; // the old catalogue is freed here, with no lock held
+    }
+
+    // Adds the file's tables, or updates the ones with the same number; an occupied table
+    // stays occupied. Required columns: number, capacity and location; optional: features.
+    bool importTables(const std::string& path, ImportResult& result, std::string& error) {
+        enum { Number, Capacity, Location, Features };
+        auto file = ImportFile::open(path, {{"number", true, false}, {"capacity", true, false},
+                                            {"location", true, false}, {"features", false, false}},
+                                     error);
+        if (!file) return false;
+        std::vector<std::shared_ptr<Table>> imported;
+        std::unordered_map<int, size_t> lineOf;
+        ImportFile::Record record;
+        std::string problem;
+        while (file->next(record, problem)) {
+            result.records++;
+            int number = 0, capacity = 0;
+            std::string_view numberText = record.text(Number);
+            if (!numberText.empty() && (numberText[0] == 'T' || numberText[0] == 't')) numberText.remove_prefix(1);
+            if (problem.empty() && !importNumber(numberText, 1, 999999, number)) problem = "number must be 1 to 999999";
+            if (problem.empty() && !importNumber(record.text(Capacity), 1, 100, capacity)) {
+                problem = "capacity must be 1 to 100";
+            }
+            if (problem.empty()) {
+                auto [first, inserted] = lineOf.insert({number, record.line});
+                if (!inserted) problem = "table " + std::to_string(number) + " is also on line " + std::to_string(first->second);
+            }
+            if (!problem.empty()) {
+                importError(result, *file, record.line, problem);
+                continue;
+            }
+            imported.push_back(std::make_shared<Table>(number, capacity, std::string(record.text(Location)),
+                                                       std::string(record.text(Features))));
+        }
+        if (!result.errors.empty()) {
+            error = std::to_string(result.errors.size()) + " bad lines in " + path + "; no tables changed.";
+            return false;
+        }
+
+        std::lock_guard<std::mutex> checkpointing(checkpointLock);
+        std::lock_guard<std::mutex> serial(importLock);
+        std::unique_ptr<Checkpoint> captured;
+        {
+            std::lock_guard<std::mutex> stock(inventoryLock);
+            std::unique_lock<std::shared_mutex> exclusive(stateLock);
+            // A table may not shrink below a party already booked on it
+            int64_t now = ServiceClock::localMinute();
+            {
+                std::lock_guard<std::mutex> lock(reservationLock);
+                for (const auto& table : imported) {
+                    auto booked = reservationBook.firstLargerThan(table->getTableNumber(), table->getCapacity(), now);
+                    if (!booked) continue;
+                    importError(result, *file, lineOf[table->getTableNumber()],
+                                "table " + std::to_string(table->getTableNumber()) + " is booked for " +
+                                std::to_string(booked->getPartySize()) + " (" + booked->getReservationId() + " on " +
+                                formatDate(booked->getReservationDay()) + " at " +
+                                formatClock(booked->getReservationMinute()) + ")");
+                }
+            }
+            if (!result.errors.empty()) {
+                error = std::to_string(result.errors.size()) + " bad lines in " + path + "; no tables changed.";
+                return false;
+            }
+            for (const auto& table : imported) {
+                auto existing = findTable(table->getTableNumber());
+                if (existing && existing->getOccupancy()) table->reserveTable();
+                (existing ? result.updated : result.added)++;
+                addTable(table);
+                publishTable(ChangeFeed::Kind::TableChanged, table->getTableNumber(), table->getCapacity());
+            }
+            if (journal) captured = captureCheckpoint(); // the floor plan is not journaled; the snapshot keeps it
+        }
+        if (captured) finishCheckpoint(std::move(captured));
+        return true;
+    }
+
+    // Books each line like the reserve command, on the best-fitting table. Required
+    // columns: name, phone, party, date (YYYY-MM-DD) and time (HH:MM); optional: minutes
+    // (default 120) and note.
+    bool importReservations(const std::string& path, ImportResult& result, std::string& error) {
+        enum { Name, Phone, Party, Date, Time, Minutes, Note };
+        auto file = ImportFile::open(path, {{"name", true, false}, {"phone", true, false}, {"party", true, false},
+                                            {"date", true, false}, {"time", true, false},
+                                            {"minutes", false, false}, {"note", false, false}},
+                                     error);
+        if (!file) return false;
+        ImportFile::Record record;
+        std::string problem;
+        while (file->next(record, problem)) {
+            result.records++;
+            int party = 0, minutes = kDefaultReservationMinutes;
+            if (problem.empty() && !importNumber(record.text(Party), 1, kMaxPartySize, party)) {
+                problem = "party must be 1 to " + std::to_string(kMaxPartySize);
+            }
+            if (problem.empty() && record.has(Minutes) && !importNumber(record.text(Minutes), 1, 1440, minutes)) {
+                problem = "minutes must be 1 to 1440";
+            }
+            if (problem.empty() && reserve(std::string(record.text(Name)), std::string(record.text(Phone)), party,
+                                           std::string(record.text(Date)), std::string(record.text(Time)),
+                                           std::string(record.text(Note)), problem, minutes)) {
+                result.added++;
+                continue;
+            }
+            importError(result, *file, record.line, problem);
+        }
+        if (!result.errors.empty()) {
+            error = std::to_string(result.errors.size()) + " of " + std::to_string(result.records) +
+                    " reservations in " + path + " were not booked.";
+            return false;
+        }
+        return true;
+    }
+
+    void makeReservation() {
+        std::string name, phone, date, time;
+        int partySize;
+
+        std::cout << "\n=== Make Reservation ===\n";
+        std::cin.ignore();
+        std::cout << "Customer Name: ";
+        std::getline(std::cin, name);
+        std::cout << "Phone: ";
+        std::getline(std::cin, phone);
+        std::cout << "Party Size: ";
+        std::cin >> partySize;
+        std::cout << "Date (YYYY-MM-DD): ";
+        std::cin >> date;
+        std::cout << "Time (HH:MM): ";
+        std::cin >> time;
+
+        std::string error;
+        if (!findReservableTable(partySize, date, time, kDefaultReservationMinutes, error)) {
+            std::cout << error << '\n';
+            return;
+        }
+
+        std::cin.ignore();
+        std::string requests;
+        std::cout << "Special Requests: ";
+        std::getline(std::cin, requests);
+
+        auto reservation = reserve(name, phone, partySize, date, time, requests, error);
+        if (reservation) {
+            std::cout << "Reservation confirmed! ID: " << reservation->getReservationId() << '\n';
+        } else {
+            std::cout << error << '\n';
+        }
+    }
+
+    void createOrder() {
+        int tableNumber;
+        std::cout << "\n=== Create New Order ===\n";
+        std::cout << "Table Number: ";
+        std::cin >> tableNumber;
+
+        // Check if table exists and is occupied
+        auto table = findTable(tableNumber);
+        if (!table || !table->getOccupancy()) {
+            std::cout << "Table not found or not occupied.\n";
+            return;
+        }
+
+        int customerCount;
+        std::cout << "Number of customers: ";
+        std::cin >> customerCount;
+
+        std::vector<OrderRequestLine> lines;
+        bool addingItems = true;
+        while (addingItems) {
+            displayMenu();
+            std::string itemId;
+            int quantity;
+
+            std::cout << "Enter Item ID (or 'done' to finish): ";
+            std::cin >> itemId;
+
+            if (itemId == "done") {
+                addingItems = false;
+                continue;
+            }
+
+            uint32_t item = findMenuItem(itemId);
+            if (item == MenuCatalog::kNone || !menu.available(item)) {
+                std::cout << "Item not found or unavailable.\n";
+                continue;
+            }
+
+            std::cout << "Quantity: ";
+            std::cin >> quantity;
+
+            lines.push_back({itemId, quantity});
+            std::cout << "Added " << quantity << " x " << menu.name(item) << '\n';
+        }
+
+        std::cin.ignore();
+        std::string instructions;
+        std::cout << "Special Instructions: ";
+        std::getline(std::cin, instructions);
+
+        std::string error;
+        auto order = placeOrder(tableNumber, customerCount, lines, instructions, error);
+        if (!order) {
+            std::cout << error << '\n';
+            return;
+        }
+        std::cout << "Order created successfully! Order ID: " << order->getOrderId() << '\n';
+        std::cout << "Total Amount: $" << formatMoney(order->getTotalCents()) << '\n';
+    }
+
+    void updateOrderStatus() {
+        std::string orderId;
+        std::cout << "Enter Order ID: ";
+        std::cin >> orderId;
+
+        auto order = findOrder(orderId);
+        if (order) {
+            std::cout << "Current status: " << statusName(order->getStatus()) << '\n';
+            std::cout << "New status (cooking/ready/served/paid/void/refunded): ";
+            std::string input;
+            std::cin >> input;
+
+            OrderStatus newStatus;
+            std::string error;
+            if (!parseStatus(input, newStatus)) {
+                std::cout << "Unknown status: " << input << '\n';
+            } else if (setOrderStatus(orderId, newStatus, error)) {
+                std::cout << "Order status updated!\n";
+            } else {
+                std::cout << error << '\n';
+            }
+        } else {
+            std::cout << "Order not found!\n";
+        }
+    }
+
+    // Prints consistent copies of the orders in the given statuses. Only those lists are
+    // walked, under a lock held just long enough to copy them.
+    void displayOrders(std::initializer_list<OrderStatus> statuses, const char* title, const char* none,
+                       std::ostream& destination) {
+        OperationTimer timer(Operation::OrdersScreen);
+        ScreenWriter out(destination);
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::vector<Order> listed;
+        {
+            std::lock_guard<std::mutex> lock(statusLock);
+            for (OrderStatus status : statuses) {
+                statusLists.forEach(status, [&listed](const Order& order) { listed.push_back(order); });
+            }
+        }
+        std::vector<int64_t> readyTimes;
+        {
+            std::lock_guard<std::mutex> lock(kitchenLock);
+            drainKitchen();
+            for (const auto& order : listed) readyTimes.push_back(kitchen.readyAt(order.getOrderId()));
+        }
+
+        out << "\n=== " << title << " ===\n";
+        for (size_t i = 0; i < listed.size(); i++) {
+            listed[i].displayInfo(menu, out);
+            if (readyTimes[i] >= 0) {
+                out << "Predicted Ready: " << formatClock(static_cast<int>(readyTimes[i] % 1440)) << '\n';
+            }
+        }
+        if (listed.empty()) {
+            out << none << '\n';
+        }
+    }
+
+    void displayActiveOrders(std::ostream& out = std::cout) {
+        displayOrders({OrderStatus::Pending, OrderStatus::Cooking, OrderStatus::Ready, OrderStatus::Served},
+                      "Active Orders", "No active orders.", out);
+    }
+
+    // Plates waiting at the pass
+    void displayReadyOrders(std::ostream& out = std::cout) {
+        displayOrders({OrderStatus::Ready}, "Ready for Pickup", "No orders ready.", out);
+    }
+
+    void displayTodayReservations(std::ostream& destination = std::cout) {
+        ScreenWriter out(destination);
+        int day = ServiceClock::now().day;
+        out << "\n=== Reservations for " << formatDate(day) << " ===\n";
+        std::vector<std::shared_ptr<Reservation>> booked;
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            std::lock_guard<std::mutex> lock(reservationLock);
+            if (auto onDay = reservationBook.reservationsOn(day)) {
+                for (const auto& [minute, reservation] : *onDay) booked.push_back(reservation);
+            }
+        }
+        if (booked.empty()) {
+            out << "No reservations for today.\n";
+            return;
+        }
+        for (const auto& reservation : booked) {
+            reservation->displayInfo(out);
+        }
+    }
+
+    // Tables that could take the party for the whole seating, best fit first
+    void displayReservableTables(int partySize, const std::string& date, const std::string& time,
+                                 int durationMinutes = kDefaultReservationMinutes, std::ostream& destination = std::cout) {
+        OperationTimer timer(Operation::AvailabilityScreen);
+        ScreenWriter out(destination);
+        int day = 0, minute = 0;
+        if (!parseDate(date, day) || !parseClock(time, minute)) {
+            out << "Invalid date or time; use YYYY-MM-DD and HH:MM.\n";
+            return;
+        }
+        int64_t start = static_cast<int64_t>(day) * 1440 + minute;
+        out << "\n=== Tables for " << partySize << " on " << date << " at " << time
+                  << " (" << durationMinutes << " min) ===\n";
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::vector<int> free;
+        {
+            std::lock_guard<std::mutex> lock(reservationLock);
+            free = reservationBook.freeTables(partySize, start, start + durationMinutes);
+        }
+        if (free.empty()) {
+            out << "No suitable tables available for the requested time.\n";
+        }
+        for (int tableNumber : free) {
+            auto table = findTable(tableNumber);
+            out << "Table " << tableNumber << " - seats " << table->getCapacity()
+                      << " (" << table->getLocation() << ")\n";
+        }
+    }
+
+    // Free-table counts per party size for every half hour of the evening
+    void displayAvailabilityGrid(const std::string& date, int durationMinutes = kDefaultReservationMinutes,
+                                 std::ostream& destination = std::cout) {
+        OperationTimer timer(Operation::AvailabilityScreen);
+        ScreenWriter out(destination);
+        int day = 0;
+        if (!parseDate(date, day)) {
+            out << "Invalid date; use YYYY-MM-DD.\n";
+            return;
+        }
+        const std::vector<int> partySizes = {2, 4, 6, 8};
+        const int firstSlot = 17 * 60, lastSlot = 22 * 60, step = 30;
+        std::vector<std::vector<int>> grid;
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            std::lock_guard<std::mutex> lock(reservationLock);
+            grid = reservationBook.availabilityGrid(day, firstSlot, lastSlot, step, durationMinutes, partySizes);
+        }
+
+        out << "\n=== Availability for " << date << " (" << durationMinutes << " min seatings) ===\n";
+        out << std::left << std::setw(8) << "Time" << std::right;
+        for (int size : partySizes) out << std::setw(8) << ("for " + std::to_string(size));
+        out << '\n';
+        for (size_t k = 0; k < grid.size(); k++) {
+            out << std::left << std::setw(8) << formatClock(firstSlot + static_cast<int>(k) * step) << std::right;
+            for (int count : grid[k]) out << std::setw(8) << count;
+            out << '\n';
+        }
+    }
+
+    void displayKitchenQueue(std::ostream& destination = std::cout) {
+        ScreenWriter out(destination);
+        std::lock_guard<std::mutex> lock(kitchenLock);
+        drainKitchen();
+        out << "\n=== Kitchen Queue ===\n";
+        if (kitchen.size() == 0) {
+            out << "No tickets in the kitchen.\n";
+            return;
+        }
+        kitchen.display(out);
+    }
+
+    // Stock on hand per ingredient, and the items 86'd for want of one
+    void displayInventory(std::ostream& destination = std::cout) {
+        ScreenWriter out(destination);
+        pumpInventory();
+        std::lock_guard<std::mutex> stock(inventoryLock);
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::vector<uint32_t> ingredients(inventory.size());
+        std::iota(ingredients.begin(), ingredients.end(), 0);
+        std::sort(ingredients.begin(), ingredients.end(),
+                  [this](uint32_t a, uint32_t b) { return inventory.name(a) < inventory.name(b); });
+        // Withdrawn items keep their recipes for the orders that name them but use nothing
+        std::vector<size_t> users(inventory.size(), 0);
+        for (uint32_t item = 0; item < menu.size(); item++) {
+            if (!offered[item]) continue;
+            for (const auto& component : inventory.recipe(item)) users[component.ingredient]++;
+        }
+
+        out << "\n=== Inventory ===\n";
+        out << std::left << std::setw(24) << "Ingredient" << std::right << std::setw(10) << "On hand"
+            << std::setw(8) << "Items" << '\n';
+        for (uint32_t ingredient : ingredients) {
+            out << std::left << std::setw(24) << inventory.name(ingredient) << std::right << std::setw(10);
+            if (inventory.isTracked(ingredient)) out << inventory.onHand(ingredient);
+            else out << "-";
+            out << std::setw(8) << users[ingredient] << '\n';
+        }
+
+        out << "\n86'd:";
+        bool any = false;
+        for (uint32_t item = 0; item < menu.size(); item++) {
+            if (!offered[item] || !inventory.isShort(item)) continue;
+            out << (any ? ", " : " ") << menu.itemId(item) << " " << menu.name(item);
+            any = true;
+        }
+        out << (any ? "\n" : " nothing\n");
+    }
+
+    void generateDailyReport(std::ostream& out = std::cout) {
+        generateDailyReport(currentBusinessDate(), out);
+    }
+
+    // Calendar date of the current service; see kBusinessDayStartHour
+    static std::string currentBusinessDate() { return formatDate(businessDay()); }
+
+    // A copy of the running totals for a business date; today's when date is empty. A
+    // date that does not parse has no sales.
+    DailySummary summarizeDay(const std::string& date) {
+        int day = businessDay();
+        if (!date.empty() && !parseDate(date, day)) return DailySummary();
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        std::lock_guard<std::mutex> lock(summaryLock);
+        const DailySummary* found = findSummary(day);
+        return found ? *found : DailySummary();
+    }
+
+    struct Occupancy {
+        int tables = 0;
+        int occupiedTables = 0;
+        int seats = 0;
+        int occupiedSeats = 0; // capacity of the occupied tables
+    };
+
+    Occupancy occupancy() const {
+        Occupancy result;
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        for (const auto& table : tables) {
+            std::lock_guard<std::mutex> lock(tableLock(table->getTableNumber()));
+            result.tables++;
+            result.seats += table->getCapacity();
+            if (table->getOccupancy()) {
+                result.occupiedTables++;
+                result.occupiedSeats += table->getCapacity();
+            }
+        }
+        return result;
+    }
+
+    // Orders in the overlay by status, and reservations not yet due, for the metrics
+    // export; occupancy() has the tables
+    struct Load {
+        std::array<size_t, kOrderStatusCount> ordersByStatus{};
+        size_t upcomingReservations = 0;
+    };
+
+    Load load() const {
+        Load result;
+        int64_t now = ServiceClock::localMinute();
+        std::shared_lock<std::shared_mutex> state(stateLock);
+        {
+            std::lock_guard<std::mutex> lock(statusLock);
+            for (size_t i = 0; i < kOrderStatusCount; i++) {
+                result.ordersByStatus[i] = statusLists.count(static_cast<OrderStatus>(i));
+            }
+        }
+        std::lock_guard<std::mutex> lock(reservationLock);
+        for (const auto& reservation : reservations) {
+            if (reservation->getStartMinute() >= now) result.upcomingReservations++;
+        }
+        return result;
+    }
+
+    // Reads the running totals for the day instead of scanning orders
+    void generateDailyReport(const std::string& date, std::ostream& destination = std::cout) {
+        OperationTimer timer(Operation::DailyReport);
+        ScreenWriter out(destination);
+        DailySummary copy = summarizeDay(date);
+        const DailySummary* summary = &copy;
+
+        out << "\n=== Daily Report - " << date << " ===\n";
+        out << "Total Revenue: $" << formatMoney(summary->revenueCents) << '\n';
+        out << "Orders Completed: " << summary->ordersCompleted << '\n';
+        out << "Customers Served: " << summary->customersServed << '\n';
+        out << "Average Order Value: $" << formatMoney(summary->averageTicket()) << '\n';
+
+        if (!summary->categoryCounts.empty()) {
+            out << "Items Sold by Category:\n";
+            std::map<std::string, int> byCategory(summary->categoryCounts.begin(), summary->categoryCounts.end());
+            for (const auto& [category, quantity] : byCategory) {
+                if (quantity > 0) out << "  " << category << ": " << quantity << '\n';
+            }
+        }
+
+        std::vector<std::pair<int, std::string>> topItems;
+        for (const auto& [itemId, quantity] : summary->itemCounts) {
+            if (quantity > 0) topItems.push_back({-quantity, itemId});
+        }
+        size_t shown = std::min<size_t>(topItems.size(), 5);
+        std::partial_sort(topItems.begin(), topItems.begin() + shown, topItems.end());
+        if (shown > 0) {
+            out << "Top Items:\n";
+            for (size_t i = 0; i < shown; i++) {
+                out << "  " << topItems[i].second << ": " << -topItems[i].first << '\n';
+            }
+        }
+    }
+
+    // Revenue and quantity from the sales history between two business dates, grouped
+    // by item, category, hour of day, weekday or table. Items and categories are listed
+    // by revenue (the first `top` of them when top > 0); order and guest counts are only
+    // shown for the groupings that a whole order falls into.
+    void displaySales(const std::string& from, const std::string& to, const std::string& by, int top = 0,
+                      std::ostream& destination = std::cout) {
+        OperationTimer timer(Operation::SalesQuery);
+        ScreenWriter out(destination);
+        int fromDay = 0, toDay = 0;
+        if (!parseDate(from, fromDay) || !parseDate(to, toDay)) {
+            out << "Invalid date; use YYYY-MM-DD.\n";
+            return;
+        }
+        if (fromDay > toDay) {
+            out << "The start date is after the end date.\n";
+            return;
+        }
+
+        std::string heading;
+        std::vector<std::string> labels;
+        std::vector<SalesHistory::Total> totals;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        if (by == "item" || by == "category") {
+            heading = by == "item" ? "Item" : "Category";
+            std::vector<uint32_t> groupOf; // menu position -> label
+            {
+                std::shared_lock<std::shared_mutex> state(stateLock);
+                std::unordered_map<uint32_t, uint32_t> categoryLabels; // symbol -> label
+                for (uint32_t i = 0; i < menu.size(); i++) {
+                    if (by == "item") {
+                        labels.push_back(std::string(menu.itemId(i)) + " " + std::string(menu.name(i)));
+                        groupOf.push_back(i);
+                        continue;
+                    }
+                    auto [it, inserted] = categoryLabels.insert({menu.categorySymbol(i), uint32_t(labels.size())});
+                    if (inserted) labels.push_back(std::string(menu.category(i)));
+                    groupOf.push_back(it->second);
+                }
+            }
+            totals = sales.aggregate(fromDay, toDay, labels.size(),
+                [&groupOf](const SalesHistory::Block& block, size_t row, int) {
+                    return block.items[row] < groupOf.size() ? groupOf[block.items[row]] : SIZE_MAX;
+                }, threads);
+        } else if (by == "hour") {
+            heading = "Hour";
+            for (int hour = 0; hour < 24; hour++) labels.push_back(formatClock(hour * 60));
+            totals = sales.aggregate(fromDay, toDay, labels.size(),
+                [](const SalesHistory::Block& block, size_t row, int) { return size_t(block.hours[row]); }, threads);
+        } else if (by == "weekday") {
+            heading = "Weekday";
+            labels = {"Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
+            // Day 0, 1970-01-01, was a Thursday
+            totals = sales.aggregate(fromDay, toDay, labels.size(),
+                [](const SalesHistory::Block&, size_t, int day) { return size_t((day + 3) % 7); }, threads);
+        } else if (by == "table") {
+            heading = "Table";
+            int limit = sales.tableLimit();
+            for (int table = 0; table < limit; table++) labels.push_back("T" + std::to_string(table));
+            totals = sales.aggregate(fromDay, toDay, labels.size(),
+                [](const SalesHistory::Block& block, size_t row, int) { return size_t(block.tables[row]); }, threads);
+        } else {
+            out << "Unknown grouping; use item, category, hour, weekday or table.\n";
+            return;
+        }
+
+        bool ranked = by == "item" || by == "category";
+        std::vector<size_t> shown;
+        SalesHistory::Total overall;
+        for (size_t k = 0; k < totals.size(); k++) {
+            overall.revenueCents += totals[k].revenueCents;
+            overall.quantity += totals[k].quantity;
+            overall.orders += totals[k].orders;
+            overall.customers += totals[k].customers;
+            if (totals[k].quantity != 0 || totals[k].orders != 0) shown.push_back(k);
+        }
+        if (ranked) {
+            std::stable_sort(shown.begin(), shown.end(), [&totals](size_t a, size_t b) {
+                return totals[a].revenueCents > totals[b].revenueCents;
+            });
+            if (top > 0 && shown.size() > static_cast<size_t>(top)) shown.resize(top);
+        }
+
+        out << "\n=== Sales " << from << " to " << to << " by " << by << " ===\n";
+        if (overall.orders == 0 && overall.quantity == 0) {
+            out << "No sales in this period.\n";
+            return;
+        }
+        out << std::left << std::setw(32) << heading << std::right << std::setw(8) << "Qty" << std::setw(12) << "Revenue";
+        if (!ranked) out << std::setw(8) << "Orders" << std::setw(8) << "Guests";
+        out << '\n';
+        for (size_t k : shown) {
+            out << std::left << std::setw(32) << labels[k] << std::right << std::setw(8) << totals[k].quantity
+                << std::setw(12) << formatMoney(totals[k].revenueCents);
+            if (!ranked) out << std::setw(8) << totals[k].orders << std::setw(8) << totals[k].customers;
+            out << '\n';
+        }
+        out << "Total: " << overall.quantity << " items, $" << formatMoney(overall.revenueCents) << " from "
+            << overall.orders << " orders and " << overall.customers << " guests\n";
+    }
+
+    // Orders, guests and revenue per table between two business dates, with how many
+    // times a day each table turned over
+    void displayTurnover(const std::string& from, const std::string& to, std::ostream& destination = std::cout) {
+        OperationTimer timer(Operation::SalesQuery);
+        ScreenWriter out(destination);
+        int fromDay = 0, toDay = 0;
+        if (!parseDate(from, fromDay) || !parseDate(to, toDay)) {
+            out << "Invalid date; use YYYY-MM-DD.\n";
+            return;
+        }
+        if (fromDay > toDay) {
+            out << "The start date is after the end date.\n";
+            return;
+        }
+        std::vector<std::pair<int, int>> seats; // table number, capacity
+        {
+            std::shared_lock<std::shared_mutex> state(stateLock);
+            for (const auto& table : tables) seats.push_back({table->getTableNumber(), table->getCapacity()});
+        }
+        std::sort(seats.begin(), seats.end());
+
+        int limit = sales.tableLimit();
+        for (const auto& [number, capacity] : seats) limit = std::max(limit, number + 1);
+        std::vector<SalesHistory::Total> totals = sales.aggregate(fromDay, toDay, static_cast<size_t>(limit),
+            [](const SalesHistory::Block& block, size_t row, int) { return size_t(block.tables[row]); },
+            std::max(1u, std::thread::hardware_concurrency()));
+        int days = toDay - fromDay + 1;
+
+        out << "\n=== Table Turnover " << from << " to " << to << " (" << days << " days) ===\n";
+        out << std::left << std::setw(8) << "Table" << std::right << std::setw(8) << "Seats" << std::setw(8) << "Orders"
+            << std::setw(8) << "Guests" << std::setw(12) << "Revenue" << std::setw(12) << "Turns/day" << '\n';
+        out << std::fixed << std::setprecision(2);
+        for (const auto& [number, capacity] : seats) {
+            const SalesHistory::Total& total = totals[number];
+            out << std::left << std::setw(8) << ("T" + std::to_string(number)) << std::right << std::setw(8) << capacity
+                << std::setw(8) << total.orders << std::setw(8) << total.customers << std::setw(12)
+                << formatMoney(total.revenueCents) << std::setw(12) << static_cast<double>(total.orders) / days << '\n';
+        }
+    }
+
+    void displayMainMenu() {
+        std::cout << "\n=== " << restaurantName << " Management System ===\n";
+        std::cout << "1. Display Menu\n";
+        std::cout << "2. Display Available Tables\n";
+        std::cout << "3. Make Reservation\n";
+        std::cout << "4. Create Order\n";
+        std::cout << "5. Update Order Status\n";
+        std::cout << "6. Display Active Orders\n";
+        std::cout << "7. Display Today's Reservations\n";
+        std::cout << "8. Generate Daily Report\n";
+        std::cout << "9. Display Kitchen Queue\n";
+        std::cout << "0. Exit\n";
+        std::cout << "Enter your choice: ";
+    }
+};
+
+// Executes line-delimited commands against a Restaurant without prompting, for
+// replaying recorded POS traffic or load testing. Blank lines and # comments are skipped.
+//   seat T2
+//   order T2 MAIN001x2 DES001x1 [guests=N] [note=text to end of line]
+//   status ORD1001 paid
+//   reserve "Ann Lee" 555-0100 4 2026-10-17 19:30 [minutes=N] [note=text to end of line]
+//   available 4 2026-10-17 19:30 [MINUTES]
+//   grid 2026-10-17
+//   filter no=Gluten,Dairy calories=500 spice=2 [without=Beef] [price=20] [category=Pasta] [all]
+//   sales 2026-10-01 2026-10-17 by=item|category|hour|weekday|table [top=N]
+//   turnover 2026-10-01 2026-10-17
+//   menu | tables | active | ready | today | kitchen | report [YYYY-MM-DD]
+class CommandProcessor {
+private:
+    Restaurant& restaurant;
+
+    // Splits on whitespace; "double quotes" group words and note= takes the rest of the line
+    static std::vector<std::string> tokenize(const std::string& line) {
+        std::vector<std::string> tokens;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) pos++;
+            if (pos >= line.size()) break;
+
+            if (line.compare(pos, 5, "note=") == 0) {
+                size_t end = line.find_last_not_of(" \t\r");
+                std::string note = line.substr(pos + 5, end + 1 - (pos + 5));
+                if (note.size() >= 2 && note.front() == '"' && note.back() == '"') {
+                    note = note.substr(1, note.size() - 2);
+                }
+                tokens.push_back("note=" + note);
+                break;
+            }
+            if (line[pos] == '"') {
+                size_t close = line.find('"', pos + 1);
+                if (close == std::string::npos) close = line.size();
+                tokens.push_back(line.substr(pos + 1, close - pos - 1));
+                pos = close + 1;
+                continue;
+            }
+            size_t end = pos;
+            while (end < line.size() && !std::isspace(static_cast<unsigned char>(line[end]))) end++;
+            tokens.push_back(line.substr(pos, end - pos));
+            pos = end;
+        }
+        return tokens;
+    }
+
+    static bool parseInt(const std::string& text, int& value) {
+        if (text.empty() || text.size() > 9) return false;
+        for (char c : text) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        }
+        value = std::atoi(text.c_str());
+        return true;
+    }
+
+    // Accepts "T2" or "2"
+    static bool parseTable(const std::string& text, int& tableNumber) {
+        return parseInt(!text.empty() && (text[0] == 'T' || text[0] == 't') ? text.substr(1) : text, tableNumber);
+    }
+
+    // "MAIN001x2" is two of MAIN001; a bare ID is one
+    static bool parseOrderLine(const std::string& text, OrderRequestLine& line) {
+        size_t x = text.find_last_of("xX");
+        int quantity = 0;
+        if (x != std::string::npos && x > 0 && parseInt(text.substr(x + 1), quantity)) {
+            line = {text.substr(0, x), quantity};
+        } else {
+            line = {text, 1};
+        }
+        return !line.itemId.empty();
+    }
+
+    bool executeOrder(const std::vector<std::string>& args, std::string& error) {
+        int tableNumber = 0;
+        if (args.size() < 2 || !parseTable(args[1], tableNumber)) {
+            error = "usage: order T<table> ITEMxQTY... [guests=N] [note=text]";
+            return false;
+        }
+        int guests = 1;
+        std::string note;
+        std::vector<OrderRequestLine> lines;
+        for (size_t i = 2; i < args.size(); i++) {
+            if (args[i].compare(0, 7, "guests=") == 0) {
+                if (!parseInt(args[i].substr(7), guests)) {
+                    error = "bad guest count: " + args[i];
+                    return false;
+                }
+            } else if (args[i].compare(0, 5, "note=") == 0) {
+                note = args[i].substr(5);
+            } else {
+                OrderRequestLine line;
+                if (!parseOrderLine(args[i], line)) {
+                    error = "bad order line: " + args[i];
+                    return false;
+                }
+                lines.push_back(line);
+            }
+        }
+        return restaurant.placeOrder(tableNumber, guests, lines, note, error) != nullptr;
+    }
+
+    static std::vector<std::string> splitList(const std::string& text) {
+        std::vector<std::string> names;
+        std::stringstream in(text);
+        std::string name;
+        while (std::getline(in, name, ',')) {
+            if (!name.empty()) names.push_back(name);
+        }
+        return names;
+    }
+
+    bool executeFilter(const std::vector<std::string>& args, std::ostream& out, std::string& error) {
+        MenuQuery query;
+        for (size_t i = 1; i < args.size(); i++) {
+            const std::string& arg = args[i];
+            size_t equals = arg.find('=');
+            std::string key = arg.substr(0, equals), value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+            bool ok = true;
+            if (key == "no") query.withoutAllergens = splitList(value);
+            else if (key == "without") query.withoutIngredients = splitList(value);
+            else if (key == "category") query.category = value;
+            else if (key == "calories") ok = parseInt(value, query.maxCalories);
+            else if (key == "spice") ok = parseInt(value, query.maxSpice);
+            else if (key == "price") {
+                char* end = nullptr;
+                double dollars = std::strtod(value.c_str(), &end);
+                ok = !value.empty() && *end == '\0' && dollars >= 0;
+                query.maxCents = toCents(dollars);
+            } else if (arg == "all") query.includeUnavailable = true;
+            else ok = false;
+            if (!ok) {
+                error = "usage: filter [no=ALLERGEN,...] [without=INGREDIENT,...] [calories=MAX] [spice=MAX] "
+                        "[price=MAX] [category=NAME] [all]";
+                return false;
+            }
+        }
+        restaurant.displayFilteredMenu(query, out);
+        return true;
+    }
+
+    bool executeSales(const std::vector<std::string>& args, std::ostream& out, std::string& error) {
+        std::string by = "item";
+        int top = 0;
+        bool ok = args.size() >= 3;
+        for (size_t i = 3; ok && i < args.size(); i++) {
+            if (args[i].compare(0, 3, "by=") == 0) by = args[i].substr(3);
+            else if (args[i].compare(0, 4, "top=") == 0) ok = parseInt(args[i].substr(4), top);
+            else ok = false;
+        }
+        if (!ok) {
+            error = "usage: sales FROM TO [by=item|category|hour|weekday|table] [top=N]";
+            return false;
+        }
+        restaurant.displaySales(args[1], args[2], by, top, out);
+        return true;
+    }
+
+    bool executeReserve(const std::vector<std::string>& args, std::string& error) {
+        int partySize = 0;
+        if (args.size() < 6 || !parseInt(args[3], partySize)) {
+            error = "usage: reserve NAME PHONE PARTY_SIZE YYYY-MM-DD HH:MM [minutes=N] [note=text]";
+            return false;
+        }
+        int minutes = Restaurant::kDefaultReservationMinutes;
+        std::string note;
+        for (size_t i = 6; i < args.size(); i++) {
+            if (args[i].compare(0, 8, "minutes=") == 0) {
+                if (!parseInt(args[i].substr(8), minutes)) {
+                    error = "bad duration: " + args[i];
+                    return false;
+                }
+            } else if (args[i].compare(0, 5, "note=") == 0) {
+                note = args[i].substr(5);
+            }
+        }
+        return restaurant.reserve(args[1], args[2], partySize, args[4], args[5], note, error, minutes) != nullptr;
+    }
+
+    // "stock Beef 40" counts the stock; +40 receives a delivery and -4 writes some off
+    bool executeStock(const std::vector<std::string>& args, std::string& error) {
+        int quantity = 0;
+        std::string amount = args.size() == 3 ? args[2] : "";
+        bool delivery = !amount.empty() && (amount[0] == '+' || amount[0] == '-');
+        if (amount.empty() || !parseInt(delivery ? amount.substr(1) : amount, quantity)) {
+            error = "usage: stock INGREDIENT QTY|+QTY|-QTY";
+            return false;
+        }
+        return restaurant.adjustStock(args[1], amount[0] == '-' ? -quantity : quantity, delivery, error);
+    }
+
+    // "recipe MAIN001 Beef=300 Potatoes=200"; no ingredients takes nothing off the stock
+    bool executeRecipe(const std::vector<std::string>& args, std::string& error) {
+        std::vector<std::pair<std::string, int>> components;
+        for (size_t i = 2; i < args.size(); i++) {
+            size_t equals = args[i].rfind('=');
+            int amount = 0;
+            if (equals == std::string::npos || !parseInt(args[i].substr(equals + 1), amount)) {
+                components.clear();
+                break;
+            }
+            components.push_back({args[i].substr(0, equals), amount});
+        }
+        if (args.size() < 2 || components.size() != args.size() - 2) {
+            error = "usage: recipe ITEM_ID [INGREDIENT=AMOUNT...]";
+            return false;
+        }
+        return restaurant.setRecipe(args[1], components, error);
+    }
+
+    // "wait "Ann Lee" 4 [555-0100]" adds a walk-in party and prints its quote
+    bool executeWait(const std::vector<std::string>& args, std::ostream& destination, std::string& error) {
+        int partySize = 0;
+        if (args.size() < 3 || args.size() > 4 || !parseInt(args[2], partySize)) {
+            error = "usage: wait NAME PARTY_SIZE [PHONE]";
+            return false;
+        }
+        Waitlist::Party party;
+        if (!restaurant.joinWaitlist(args[1], args.size() == 4 ? args[3] : "", partySize, party, error)) return false;
+        ScreenWriter out(destination);
+        out << party.id << ": " << party.name << ", party of " << party.size;
+        int64_t now = ServiceClock::localMinute();
+        if (party.table < 0) out << "; no table seats " << party.size << '\n';
+        else if (party.seatedBy <= now) out << "; table " << party.table << " now\n";
+        else out << "; table " << party.table << " at about " << formatClock(static_cast<int>(party.seatedBy % 1440))
+                 << " (" << party.seatedBy - now << " min)\n";
+        return true;
+    }
+
+    // "import menu FILE" replaces the menu; tables and reservations are added. Prints the
+    // first bad lines, then what the import did.
+    bool executeImport(const std::vector<std::string>& args, std::ostream& destination, std::string& error) {
+        if (args.size() != 3 || (args[1] != "menu" && args[1] != "tables" && args[1] != "reservations")) {
+            error = "usage: import menu|tables|reservations FILE";
+            return false;
+        }
+        Restaurant::ImportResult result;
+        bool imported = args[1] == "menu"     ? restaurant.importMenu(args[2], result, error)
+                        : args[1] == "tables" ? restaurant.importTables(args[2], result, error)
+                                              : restaurant.importReservations(args[2], result, error);
+        ScreenWriter out(destination);
+        const size_t shown = 10;
+        for (size_t i = 0; i < result.errors.size() && i < shown; i++) out << result.errors[i] << "\n";
+        if (result.errors.size() > shown) out << "... and " << (result.errors.size() - shown) << " more\n";
+        if (result.records == 0 && !imported) return false;
+        out << args[2] << ": " << result.records << " records, " << result.added << " added, " << result.updated
+            << " updated";
+        if (args[1] == "menu") out << ", " << result.withdrawn << " withdrawn";
+        out << (imported || args[1] == "reservations" ? "\n" : " (not applied)\n");
+        return imported;
+    }
+
+public:
+    explicit CommandProcessor(Restaurant& r) : restaurant(r) {}
+
+    // Runs one command line, writing any screen output to out. command is set to the
+    // command name, or left empty for blank and comment lines; error is set when the
+    // command fails.
+    bool execute(const std::string& line, std::string& command, std::string& error, std::ostream& out = std::cout) {
+        std::vector<std::string> args = tokenize(line);
+        command.clear();
+        if (args.empty() || args[0][0] == '#') return true;
+        command = args[0];
+
+        if (command == "order") return executeOrder(args, error);
+        if (command == "reserve") return executeReserve(args, error);
+        if (command == "filter") return executeFilter(args, out, error);
+        if (command == "status") {
+            OrderStatus status;
+            if (args.size() != 3) {
+                error = "usage: status ORDER_ID STATUS";
+                return false;
+            }
+            if (!parseStatus(args[2], status)) {
+                error = "unknown status " + args[2] + "; use pending, cooking, ready, served, paid, void or refunded";
+                return false;
+            }
+            return restaurant.setOrderStatus(args[1], status, error);
+        }
+        if (command == "seat") {
+            int tableNumber = 0;
+            if (args.size() < 2 || args.size() > 3 || !parseTable(args[1], tableNumber)) {
+                error = "usage: seat T<table> [W<party>]";
+                return false;
+            }
+            return restaurant.seatTable(tableNumber, error, args.size() == 3 ? args[2] : "");
+        }
+        if (command == "wait") return executeWait(args, out, error);
+        if (command == "leave") {
+            if (args.size() != 2) {
+                error = "usage: leave W<party>";
+                return false;
+            }
+            return restaurant.leaveWaitlist(args[1], error);
+        }
+        if (command == "available") {
+            int partySize = 0, minutes = Restaurant::kDefaultReservationMinutes;
+            if (args.size() < 4 || args.size() > 5 || !parseInt(args[1], partySize) ||
+                (args.size() == 5 && !parseInt(args[4], minutes))) {
+                error = "usage: available PARTY_SIZE YYYY-MM-DD HH:MM [MINUTES]";
+                return false;
+            }
+            restaurant.displayReservableTables(partySize, args[2], args[3], minutes, out);
+            return true;
+        }
+        if (command == "grid") {
+            if (args.size() != 2) {
+                error = "usage: grid YYYY-MM-DD";
+                return false;
+            }
+            restaurant.displayAvailabilityGrid(args[1], Restaurant::kDefaultReservationMinutes, out);
+            return true;
+        }
+        if (command == "sales") return executeSales(args, out, error);
+        if (command == "stock") return executeStock(args, error);
+        if (command == "recipe") return executeRecipe(args, error);
+        if (command == "import") return executeImport(args, out, error);
+        if (command == "feed") {
+            int from = 0;
+            if (args.size() > 2 || (args.size() == 2 && (!parseInt(args[1], from) || from == 0))) {
+                error = "usage: feed [FROM_SEQUENCE]";
+                return false;
+            }
+            restaurant.displayFeed(static_cast<uint64_t>(from), out);
+            return true;
+        }
+        if (command == "turnover") {
+            if (args.size() != 3) {
+                error = "usage: turnover FROM TO";
+                return false;
+            }
+            restaurant.displayTurnover(args[1], args[2], out);
+            return true;
+        }
+        if (command == "menu") restaurant.displayMenu(out);
+        else if (command == "tables") restaurant.displayAvailableTables(out);
+        else if (command == "active") restaurant.displayActiveOrders(out);
+        else if (command == "ready") restaurant.displayReadyOrders(out);
+        else if (command == "today") restaurant.displayTodayReservations(out);
+        else if (command == "kitchen") restaurant.displayKitchenQueue(out);
+        else if (command == "waitlist") restaurant.displayWaitlist(out);
+        else if (command == "inventory") restaurant.displayInventory(out);
+        else if (command == "report") {
+            if (args.size() > 1) restaurant.generateDailyReport(args[1], out);
+            else restaurant.generateDailyReport(out);
+        }
+        else {
+            error = "unknown command";
+            return false;
+        }
+        return true;
+    }
+};
+
+// Several restaurants (locations) in one process. With more than one, each location's
+// Restaurant is owned by its own thread: commands for it are queued to that thread and
+// run there one at a time, so its locks are never contended and locations never wait on
+// each other. A lone location runs commands on the caller's thread as before.
+//   @2 seat T4             a command for location 2; without a prefix, location 1
+//   status ORD20001001 paid   commands naming an order or reservation go to its location
+//   group report [YYYY-MM-DD] | group occupancy
+// Group screens ask every location's thread for its part at once and merge the parts.
+class LocationGroup {
+private:
+    struct Location {
+        std::unique_ptr<Restaurant> restaurant;
+        std::unique_ptr<CommandProcessor> processor;
+        MpscQueue<std::function<void()>> inbox;
+        std::mutex wakeLock; // pairs with wake; the queue itself is lock-free
+        std::condition_variable wake;
+        std::thread owner;
+    };
+    std::vector<std::unique_ptr<Location>> locations;
+    std::atomic<bool> stopping{false};
+
+    void ownerLoop(Location& location) {
+        std::function<void()> task;
+        while (true) {
+            while (location.inbox.pop(task)) task();
+            std::unique_lock<std::mutex> lock(location.wakeLock);
+            location.wake.wait(lock, [&] { return !location.inbox.empty() || stopping; });
+            if (stopping && location.inbox.empty()) return;
+        }
+    }
+
+    // Index of the location that owns the order or reservation named by token, -1 if the
+    // token is not such an ID, or size() if no location here issued it
+    int ownerOf(const std::string& token) const {
+        if (token.size() < 4 || (token.compare(0, 3, "ORD") != 0 && token.compare(0, 3, "RES") != 0)) return -1;
+        for (size_t i = 3; i < token.size(); i++) {
+            if (!std::isdigit(static_cast<unsigned char>(token[i]))) return -1;
+        }
+        if (locations.size() == 1) return 0;
+        int location = Restaurant::locationOf(token);
+        return location >= 1 && location <= static_cast<int>(locations.size()) ? location - 1 : size();
+    }
+
+    bool executeGroup(const std::vector<std::string>& args, std::ostream& out, std::string& error) {
+        if (args.size() >= 2 && args[1] == "report" && args.size() <= 3) {
+            displayGroupReport(args.size() == 3 ? args[2] : "", out);
+            return true;
+        }
+        if (args.size() == 2 && args[1] == "occupancy") {
+            displayGroupOccupancy(out);
+            return true;
+        }
+        error = "usage: group report [YYYY-MM-DD] | group occupancy";
+        return false;
+    }
+
+public:
+    // One location keeps the plain name and location number 0, so its IDs and data
+    // directory are those of a single restaurant; more are numbered from 1
+    LocationGroup(const std::string& name, int count) {
+        for (int i = 0; i < count; i++) {
+            auto location = std::make_unique<Location>();
+            location->restaurant = count == 1 ? std::make_unique<Restaurant>(name)
+                                              : std::make_unique<Restaurant>(name + " #" + std::to_string(i + 1), i + 1);
+            location->processor = std::make_unique<CommandProcessor>(*location->restaurant);
+            locations.push_back(std::move(location));
+        }
+    }
+
+    ~LocationGroup() {
+        stopping = true;
+        for (auto& location : locations) {
+            if (!location->owner.joinable()) continue;
+            {
+                std::lock_guard<std::mutex> lock(location->wakeLock);
+            }
+            location->wake.notify_one();
+            location->owner.join();
+        }
+    }
+
+    LocationGroup(const LocationGroup&) = delete;
+    LocationGroup& operator=(const LocationGroup&) = delete;
+
+    int size() const { return static_cast<int>(locations.size()); }
+
+    // Only for setup before start(), or when there is a single location
+    Restaurant& location(int index) { return *locations[index]->restaurant; }
+
+    // Each location keeps its journal and snapshot in its own subdirectory
+    // (DIR/location-N), except a lone location, which uses DIR itself
+    bool openJournals(const std::string& directory) {
+        for (int i = 0; i < size(); i++) {
+            std::string path = directory;
+            if (size() > 1) {
+                path += "/location-" + std::to_string(i + 1);
+                if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+                    std::cerr << "Could not create " << path << std::endl;
+                    return false;
+                }
+            }
+            if (!locations[i]->restaurant->openJournal(path)) return false;
+        }
+        return true;
+    }
+
+    // Each location publishes its change feed to its own segment (NAME-N), except a lone
+    // location, which uses NAME itself
+    bool openFeeds(const std::string& name) {
+        for (int i = 0; i < size(); i++) {
+            std::string segment = size() > 1 ? name + "-" + std::to_string(i + 1) : name;
+            std::string error;
+            if (!locations[i]->restaurant->openFeed(segment, error)) {
+                std::cerr << "Could not open the change feed: " << error << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Hands each location to its owner thread; from here on only that thread touches it
+    void start() {
+        if (size() == 1) return;
+        for (auto& location : locations) {
+            Location* owned = location.get();
+            location->owner = std::thread([this, owned] { ownerLoop(*owned); });
+        }
+    }
+
+    // Runs task(restaurant) on the location's owner thread, or right here when the
+    // location has none; the future holds the result
+    template <typename Task>
+    auto run(int index, Task task) -> std::future<decltype(task(std::declval<Restaurant&>()))> {
+        using Result = decltype(task(std::declval<Restaurant&>()));
+        Location& location = *locations[index];
+        auto job = std::make_shared<std::packaged_task<Result()>>(
+            [task = std::move(task), &location]() mutable { return task(*location.restaurant); });
+        std::future<Result> result = job->get_future();
+        if (!location.owner.joinable()) {
+            (*job)();
+            return result;
+        }
+        location.inbox.push([job] { (*job)(); });
+        {
+            std::lock_guard<std::mutex> lock(location.wakeLock);
+        }
+        location.wake.notify_one();
+        return result;
+    }
+
+    // Routes one command line (see the class comment) and waits for it to finish;
+    // the arguments are those of CommandProcessor::execute
+    bool execute(const std::string& line, std::string& command, std::string& error, std::ostream& out = std::cout) {
+        std::vector<std::string> words;
+        std::stringstream in(line);
+        for (std::string word; words.size() < 3 && in >> word;) words.push_back(word);
+        command.clear();
+        if (words.empty() || words[0][0] == '#') return true;
+
+        int index = 0;
+        std::string routed = line;
+        if (words[0][0] == '@') {
+            int number = std::atoi(words[0].c_str() + 1);
+            if (number < 1 || number > size()) {
+                command = words[0];
+                error = "unknown location " + words[0].substr(1);
+                return false;
+            }
+            index = number - 1;
+            routed = line.substr(line.find(words[0]) + words[0].size());
+        } else if (words[0] == "group") {
+            command = "group";
+            std::vector<std::string> args(words);
+            for (std::string word; in >> word;) args.push_back(word);
+            return executeGroup(args, out, error);
+        } else {
+            for (size_t i = 1; i < words.size(); i++) {
+                int owner = ownerOf(words[i]);
+                if (owner == size()) {
+                    command = words[0];
+                    error = words[i] + " belongs to no location here";
+                    return false;
+                }
+                if (owner >= 0) {
+                    index = owner;
+                    break;
+                }
+            }
+        }
+        if (size() == 1) return locations[0]->processor->execute(routed, command, error, out);
+        CommandProcessor& processor = *locations[index]->processor;
+        return run(index, [&](Restaurant&) { return processor.execute(routed, command, error, out); }).get();
+    }
+
+    // Each location's totals for the day, then the group's, with the top items across
+    // all locations
+    void displayGroupReport(const std::string& date, std::ostream& destination = std::cout) {
+        std::vector<std::future<std::pair<std::string, DailySummary>>> parts;
+        for (int i = 0; i < size(); i++) {
+            parts.push_back(run(i, [date](Restaurant& restaurant) {
+                return std::make_pair(restaurant.getName(), restaurant.summarizeDay(date));
+            }));
+        }
+
+        ScreenWriter out(destination);
+        out << "\n=== Group Report - " << (date.empty() ? Restaurant::currentBusinessDate() : date) << " ===\n";
+        out << std::left << std::setw(24) << "Location" << std::right << std::setw(8) << "Orders" << std::setw(8)
+            << "Guests" << std::setw(12) << "Revenue" << std::setw(12) << "Avg Ticket" << '\n';
+        DailySummary group;
+        for (auto& part : parts) {
+            auto [name, summary] = part.get();
+            out << std::left << std::setw(24) << name << std::right << std::setw(8) << summary.ordersCompleted
+                << std::setw(8) << summary.customersServed << std::setw(12) << formatMoney(summary.revenueCents)
+                << std::setw(12) << formatMoney(summary.averageTicket()) << '\n';
+            group.revenueCents += summary.revenueCents;
+            group.ordersCompleted += summary.ordersCompleted;
+            group.customersServed += summary.customersServed;
+            for (const auto& [itemId, quantity] : summary.itemCounts) group.itemCounts[itemId] += quantity;
+        }
+        out << std::left << std::setw(24) << "All locations" << std::right << std::setw(8) << group.ordersCompleted
+            << std::setw(8) << group.customersServed << std::setw(12) << formatMoney(group.revenueCents)
+            << std::setw(12) << formatMoney(group.averageTicket()) << '\n';
+
+        std::vector<std::pair<int, std::string>> topItems;
+        for (const auto& [itemId, quantity] : group.itemCounts) {
+            if (quantity > 0) topItems.push_back({-quantity, itemId});
+        }
+        size_t shown = std::min<size_t>(topItems.size(), 5);
+        std::partial_sort(topItems.begin(), topItems.begin() + shown, topItems.end());
+        if (shown > 0) {
+            out << "Top Items:\n";
+            for (size_t i = 0; i < shown; i++) {
+                out << "  " << topItems[i].second << ": " << -topItems[i].first << '\n';
+            }
+        }
+    }
+
+    // Occupied tables and seats at every location and across the group
+    void displayGroupOccupancy(std::ostream& destination = std::cout) {
+        std::vector<std::future<std::pair<std::string, Restaurant::Occupancy>>> parts;
+        for (int i = 0; i < size(); i++) {
+            parts.push_back(run(i, [](Restaurant& restaurant) {
+                return std::make_pair(restaurant.getName(), restaurant.occupancy());
+            }));
+        }
+
+        ScreenWriter out(destination);
+        out << "\n=== Group Occupancy ===\n";
+        out << std::left << std::setw(24) << "Location" << std::right << std::setw(10) << "Tables" << std::setw(12)
+            << "Seats" << std::setw(10) << "Occupied" << '\n';
+        Restaurant::Occupancy group;
+        auto row = [&out](const std::string& name, const Restaurant::Occupancy& occupancy) {
+            double share = occupancy.seats > 0 ? 100.0 * occupancy.occupiedSeats / occupancy.seats : 0.0;
+            out << std::left << std::setw(24) << name << std::right << std::setw(10)
+                << (std::to_string(occupancy.occupiedTables) + "/" + std::to_string(occupancy.tables))
+                << std::setw(12) << (std::to_string(occupancy.occupiedSeats) + "/" + std::to_string(occupancy.seats))
+                << std::setw(9) << std::fixed << std::setprecision(1) << share << "%\n";
+        };
+        for (auto& part : parts) {
+            auto [name, occupancy] = part.get();
+            row(name, occupancy);
+            group.tables += occupancy.tables;
+            group.occupiedTables += occupancy.occupiedTables;
+            group.seats += occupancy.seats;
+            group.occupiedSeats += occupancy.occupiedSeats;
+        }
+        row("All locations", group);
+    }
+};
+
+#ifndef RMS_NO_METRICS
+// Writes every operation's latency histogram and failure count, and each location's
+// order, table and reservation gauges, to a file in the Prometheus text format: every
+// interval, and once more when stopped. The file is replaced whole, so a scraper
+// never reads half of it.
+class MetricsExporter {
+private:
+    LocationGroup& locations;
+    std::string path;
+    std::chrono::seconds interval;
+    std::thread writer;
+    std::mutex stopLock;
+    std::condition_variable stopped;
+    bool stopping = false;
+
+    // Prometheus label values escape backslash, quote and newline
+    static std::string label(const std::string& value) {
+        std::string escaped;
+        for (char c : value) {
+            if (c == '\\' || c == '"') escaped += '\\';
+            escaped += c == '\n' ? 'n' : c;
+        }
+        return escaped;
+    }
+
+    void writeOperations(std::ostream& out) {
+        static const double limits[] = {1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2,
+                                        2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+        static const double quantiles[] = {0.5, 0.99, 0.999};
+        auto threads = MetricsRegistry::all();
+
+        std::vector<std::vector<uint64_t>> counts(kOperationCount,
+                                                  std::vector<uint64_t>(LatencyHistogram::kBucketCount));
+        std::vector<uint64_t> sums(kOperationCount), failures(kOperationCount);
+        for (const auto& thread : threads) {
+            for (size_t op = 0; op < kOperationCount; op++) {
+                for (int b = 0; b < LatencyHistogram::kBucketCount; b++) counts[op][b] += thread->latency[op].count(b);
+                sums[op] += thread->latency[op].sum();
+                failures[op] += thread->failures[op].load(std::memory_order_relaxed);
+            }
+        }
+
+        out << "# HELP rms_operation_duration_seconds Time taken by restaurant operations.\n"
+            << "# TYPE rms_operation_duration_seconds histogram\n";
+        for (size_t op = 0; op < kOperationCount; op++) {
+            const char* name = operationName(static_cast<Operation>(op));
+            uint64_t total = 0;
+            int bucket = 0;
+            for (double limit : limits) {
+                // A bucket counts under the first limit its longest duration fits
+                uint64_t nanos = static_cast<uint64_t>(limit * 1e9);
+                for (; bucket < LatencyHistogram::kBucketCount &&
+                       LatencyHistogram::bucketLimit(bucket) - 1 <= nanos; bucket++) {
+                    total += counts[op][bucket];
+                }
+                out << "rms_operation_duration_seconds_bucket{operation=\"" << name << "\",le=\"" << limit
+                    << "\"} " << total << '\n';
+            }
+            for (; bucket < LatencyHistogram::kBucketCount; bucket++) total += counts[op][bucket];
+            out << "rms_operation_duration_seconds_bucket{operation=\"" << name << "\",le=\"+Inf\"} " << total << '\n';
+            out << "rms_operation_duration_seconds_sum{operation=\"" << name << "\"} " << sums[op] / 1e9 << '\n';
+            out << "rms_operation_duration_seconds_count{operation=\"" << name << "\"} " << total << '\n';
+        }
+
+        // The histograms resolve far finer than the buckets above, so exact-ish quantiles
+        // go out as well
+        out << "# HELP rms_operation_latency_seconds Latency quantiles of restaurant operations.\n"
+            << "# TYPE rms_operation_latency_seconds gauge\n";
+        for (size_t op = 0; op < kOperationCount; op++) {
+            uint64_t total = 0;
+            for (uint64_t count : counts[op]) total += count;
+            if (total == 0) continue;
+            for (double quantile : quantiles) {
+                uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * total)), seen = 0;
+                int bucket = 0;
+                while (bucket < LatencyHistogram::kBucketCount - 1 && (seen += counts[op][bucket]) < rank) bucket++;
+                out << "rms_operation_latency_seconds{operation=\"" << operationName(static_cast<Operation>(op))
+                    << "\",quantile=\"" << quantile << "\"} " << LatencyHistogram::bucketLimit(bucket) / 1e9 << '\n';
+            }
+        }
+
+        out << "# HELP rms_operation_failures_total Operations that returned an error.\n"
+            << "# TYPE rms_operation_failures_total counter\n";
+        for (size_t op = 0; op < kOperationCount; op++) {
+            out << "rms_operation_failures_total{operation=\"" << operationName(static_cast<Operation>(op))
+                << "\"} " << failures[op] << '\n';
+        }
+    }
+
+    // Asks every location for its gauges at once, on its own thread
+    void writeGauges(std::ostream& out) {
+        struct Part {
+            std::string name;
+            Restaurant::Load load;
+            Restaurant::Occupancy occupancy;
+        };
+        std::vector<std::future<Part>> parts;
+        for (int i = 0; i < locations.size(); i++) {
+            parts.push_back(locations.run(i, [](Restaurant& restaurant) {
+                return Part{restaurant.getName(), restaurant.load(), restaurant.occupancy()};
+            }));
+        }
+        std::vector<Part> gauges;
+        for (auto& part : parts) gauges.push_back(part.get());
+
+        out << "# HELP rms_orders Orders in memory by status.\n# TYPE rms_orders gauge\n";
+        for (const auto& part : gauges) {
+            for (size_t i = 0; i < kOrderStatusCount; i++) {
+                out << "rms_orders{location=\"" << label(part.name) << "\",status=\""
+                    << statusName(static_cast<OrderStatus>(i)) << "\"} " << part.load.ordersByStatus[i] << '\n';
+            }
+        }
+        out << "# HELP rms_active_orders Orders placed and not yet paid or voided.\n# TYPE rms_active_orders gauge\n";
+        for (const auto& part : gauges) {
+            size_t active = 0;
+            for (size_t i = 0; i < kOrderStatusCount; i++) {
+                if (isOpenStatus(static_cast<OrderStatus>(i))) active += part.load.ordersByStatus[i];
+            }
+            out << "rms_active_orders{location=\"" << label(part.name) << "\"} " << active << '\n';
+        }
+        out << "# HELP rms_occupied_tables Tables with guests seated.\n# TYPE rms_occupied_tables gauge\n";
+        for (const auto& part : gauges) {
+            out << "rms_occupied_tables{location=\"" << label(part.name) << "\"} " << part.occupancy.occupiedTables
+                << '\n';
+        }
+        out << "# HELP rms_tables Tables on the floor plan.\n# TYPE rms_tables gauge\n";
+        for (const auto& part : gauges) {
+            out << "rms_tables{location=\"" << label(part.name) << "\"} " << part.occupancy.tables << '\n';
+        }
+        out << "# HELP rms_pending_reservations Reservations not yet due.\n# TYPE rms_pending_reservations gauge\n";
+        for (const auto& part : gauges) {
+            out << "rms_pending_reservations{location=\"" << label(part.name) << "\"} "
+                << part.load.upcomingReservations << '\n';
+        }
+    }
+
+public:
+    MetricsExporter(LocationGroup& group, const std::string& file, int seconds)
+        : locations(group), path(file), interval(std::max(1, seconds)) {}
+
+    ~MetricsExporter() {
+        stop();
+    }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Turns on the operation timers and starts writing
+    void start() {
+        MetricsRegistry::enabled() = true;
+        writer = std::thread([this] {
+            std::unique_lock<std::mutex> lock(stopLock);
+            while (!stopped.wait_for(lock, interval, [this] { return stopping; })) {
+                lock.unlock();
+                write();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        if (!writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(stopLock);
+            stopping = true;
+        }
+        stopped.notify_one();
+        writer.join();
+        write();
+    }
+
+    bool write() {
+        std::ostringstream out;
+        out.precision(9);
+        writeOperations(out);
+        writeGauges(out);
+        std::string temporary = path + ".tmp";
+        std::ofstream file(temporary, std::ios::trunc);
+        file << out.str();
+        file.close();
+        if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::cerr << "Could not write metrics to " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+#else
+class MetricsExporter {
+public:
+    MetricsExporter(LocationGroup&, const std::string&, int) {}
+
+    void start() {
+        std::cerr << "Built with RMS_NO_METRICS; --metrics is ignored." << std::endl;
+    }
+};
+#endif
+
+// Value at fraction p of an ascending-sorted sample
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Prints count, p50, p99 and max for each named latency sample (microseconds)
+void printLatencyTable(std::map<std::string, std::vector<double>>& latencies, const char* label = "Command") {
+    std::cout << std::left << std::setw(10) << label << std::right << std::setw(10) << "Count"
+              << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)" << std::setw(12) << "max (us)"
+              << std::endl;
+    for (auto& [name, samples] : latencies) {
+        std::sort(samples.begin(), samples.end());
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(10) << samples.size()
+                  << std::fixed << std::setprecision(1) << std::setw(12) << percentile(samples, 0.50)
+                  << std::setw(12) << percentile(samples, 0.99)
+                  << std::setw(12) << (samples.empty() ? 0.0 : samples.back()) << std::endl;
+    }
+}
+
+// Runs every command in the stream at full speed, reporting failures on stderr and
+// throughput plus per-command latency at the end. Returns the number of failed commands.
+int runBatch(LocationGroup& locations, std::istream& in) {
+    std::map<std::string, std::vector<double>> latencies; // microseconds per command name
+    std::vector<double> all;
+    std::string line, command, error;
+    int lineNumber = 0;
+    int failures = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (std::getline(in, line)) {
+        lineNumber++;
+        error.clear();
+        auto commandStart = std::chrono::steady_clock::now();
+        bool ok = locations.execute(line, command, error);
+        double micros = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - commandStart).count();
+        if (command.empty()) continue;
+
+        latencies[command].push_back(micros);
+        all.push_back(micros);
+        if (!ok) {
+            failures++;
+            std::cerr << "line " << lineNumber << ": " << command << ": " << error << std::endl;
+        }
+    }
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "\n=== Batch Summary ===" << std::endl;
+    std::cout << "Commands: " << all.size() << " (" << failures << " failed) in " << std::fixed
+              << std::setprecision(1) << elapsedSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "Throughput: " << std::setprecision(0)
+              << (elapsedSeconds > 0 ? all.size() / elapsedSeconds : 0.0) << " commands/sec" << std::endl;
+    latencies["all"] = all;
+    printLatencyTable(latencies);
+    return failures;
+}
+
+// Set from SIGINT/SIGTERM; server threads check it between epoll waits, --tail between events
+std::atomic<bool> serverStopping(false);
+
+extern "C" void requestServerStop(int) {
+    serverStopping = true;
+}
+
+bool setNonBlocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Frames one response of the line protocol: a status line, the command's output with
+// lines that start with "." doubled, then a line holding a single ".".
+void appendResponse(std::string& out, bool ok, const std::string& error, const std::string& body) {
+    out += ok ? "OK\n" : "ERR " + error + "\n";
+    size_t pos = 0;
+    while (pos < body.size()) {
+        size_t end = body.find('\n', pos);
+        if (end == std::string::npos) end = body.size();
+        if (body[pos] == '.') out += '.';
+        out.append(body, pos, end - pos);
+        out += '\n';
+        pos = end + 1;
+    }
+    out += ".\n";
+}
+
+// TCP front end for the batch command language. Each request is one command line and
+// gets one framed response (see appendResponse); "quit" closes the connection. Clients
+// may pipeline: every complete line from a read is executed in order and the replies
+// go back in one write.
+// Each worker thread has its own epoll set and its own SO_REUSEPORT listening socket,
+// so the kernel spreads connections over the threads and no connection is shared.
+class PosServer {
+private:
+    struct Connection {
+        int fd;
+        std::string in;
+        std::string out;
+        size_t written = 0;
+        uint32_t events = 0; // currently registered with epoll
+        bool closing = false;
+    };
+
+    static const size_t kMaxLineLength = 64 * 1024;
+    static const size_t kMaxPendingOutput = 4 * 1024 * 1024; // stop reading until it drains
+
+    LocationGroup& locations;
+    int port;
+    int threadCount;
+    std::atomic<long> connectionsAccepted{0};
+    std::atomic<long> requestsServed{0};
+
+    static int openListener(int port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0) return -1;
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 4096) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Executes every complete line buffered on the connection, unless the replies
+    // already waiting to go out are over the limit
+    void executeLines(Connection& connection) {
+        std::string line, command, error;
+        size_t start = 0;
+        while (!connection.closing && connection.out.size() - connection.written < kMaxPendingOutput) {
+            size_t end = connection.in.find('\n', start);
+            if (end == std::string::npos) break;
+            line.assign(connection.in, start, end - start);
+            start = end + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line == "quit") {
+                connection.closing = true;
+                break;
+            }
+
+            std::ostringstream body;
+            error.clear();
+            bool ok = locations.execute(line, command, error, body);
+            appendResponse(connection.out, ok, error, body.str());
+            requestsServed++;
+        }
+        connection.in.erase(0, start);
+        if (connection.in.size() > kMaxLineLength) {
+            appendResponse(connection.out, false, "line too long", "");
+            connection.closing = true;
+        }
+    }
+
+    // Writes as much pending output as the socket takes; false if the peer is gone
+    static bool flush(Connection& connection) {
+        while (connection.written < connection.out.size()) {
+            ssize_t n = ::send(connection.fd, connection.out.data() + connection.written,
+                               connection.out.size() - connection.written, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            connection.written += static_cast<size_t>(n);
+        }
+        connection.out.clear();
+        connection.written = 0;
+        return true;
+    }
+
+    // Reads until the socket is drained; false once the peer has closed or failed
+    static bool readAll(Connection& connection) {
+        char buffer[16384];
+        while (true) {
+            ssize_t n = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                connection.in.append(buffer, static_cast<size_t>(n));
+                if (connection.in.size() > 4 * kMaxLineLength) return true; // let executeLines catch up
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+
+    void serveLoop(int listener) {
+        int epollFd = ::epoll_create1(0);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = listener;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, listener, &event);
+
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::vector<epoll_event> ready(256);
+
+        auto close = [&](int fd) {
+            ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            ::close(fd);
+            connections.erase(fd);
+        };
+
+        while (!serverStopping) {
+            int count = ::epoll_wait(epollFd, ready.data(), static_cast<int>(ready.size()), 200);
+            for (int i = 0; i < count; i++) {
+                int fd = ready[i].data.fd;
+                if (fd == listener) {
+                    while (true) {
+                        int client = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+                        if (client < 0) break;
+                        int one = 1;
+                        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                        auto connection = std::make_unique<Connection>();
+                        connection->fd = client;
+                        connection->events = EPOLLIN;
+                        epoll_event clientEvent{};
+                        clientEvent.events = EPOLLIN;
+                        clientEvent.data.fd = client;
+                        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &clientEvent);
+                        connections[client] = std::move(connection);
+                        connectionsAccepted++;
+                    }
+                    continue;
+                }
+
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                Connection& connection = *it->second;
+                bool open = true;
+                if (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) open = readAll(connection);
+                // Replies can cap how many lines run per pass; keep going while they drain at once
+                bool flushed;
+                do {
+                    executeLines(connection);
+                    flushed = flush(connection);
+                } while (flushed && connection.out.empty() && !connection.closing &&
+                         connection.in.find('\n') != std::string::npos);
+                bool pending = connection.written < connection.out.size();
+                if (!flushed || ((!open || connection.closing) && !pending)) {
+                    close(fd);
+                    continue;
+                }
+
+                // Read only while replies are not backing up; wait for writability while they are
+                uint32_t wanted = (pending ? EPOLLOUT : 0u) |
+                                  (open && !connection.closing &&
+                                   connection.out.size() - connection.written < kMaxPendingOutput ? EPOLLIN : 0u);
+                if (wanted != connection.events) {
+                    epoll_event update{};
+                    update.events = wanted;
+                    update.data.fd = fd;
+                    ::epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &update);
+                    connection.events = wanted;
+                }
+            }
+        }
+
+        for (auto& [fd, connection] : connections) ::close(fd);
+        ::close(epollFd);
+    }
+
+public:
+    PosServer(LocationGroup& group, int listenPort, int threads)
+        : locations(group), port(listenPort), threadCount(std::max(1, threads)) {}
+
+    // Serves until SIGINT or SIGTERM; returns non-zero if the port could not be opened
+    int run() {
+        std::vector<int> listeners;
+        for (int i = 0; i < threadCount; i++) {
+            int fd = openListener(port);
+            if (fd < 0) {
+                std::cerr << "Could not listen on port " << port << ": " << std::strerror(errno) << std::endl;
+                for (int open : listeners) ::close(open);
+                return 1;
+            }
+            listeners.push_back(fd);
+        }
+
+        std::signal(SIGINT, requestServerStop);
+        std::signal(SIGTERM, requestServerStop);
+        std::cout << "Serving on port " << port << " with " << threadCount << " threads" << std::endl;
+        std::vector<std::thread> workers;
+        for (int fd : listeners) workers.emplace_back(&PosServer::serveLoop, this, fd);
+        for (auto& worker : workers) worker.join();
+        for (int fd : listeners) ::close(fd);
+
+        std::cout << "Server stopped after " << connectionsAccepted << " connections and "
+                  << requestsServed << " requests" << std::endl;
+        return 0;
+    }
+};
+
+// Follows another process's change feed (--tail NAME), one line per event, from sequence
+// from or, when from is 0, from the next event, until SIGINT/SIGTERM. Falling a whole
+// ring behind prints how many events were missed and goes on from the oldest still there;
+// a restarted writer starts the feed over from 1.
+int runFeedTail(const std::string& name, uint64_t from) {
+    std::string error;
+    auto feed = ChangeFeed::attach(name, error);
+    if (!feed) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, requestServerStop);
+    std::signal(SIGTERM, requestServerStop);
+    uint64_t epoch = feed->epoch();
+    uint64_t next = from > 0 ? from : feed->head() + 1;
+    ChangeFeed::Event event;
+    while (!serverStopping) {
+        if (feed->epoch() != epoch) {
+            epoch = feed->epoch();
+            next = 1;
+            std::cout << "# feed restarted\n";
+        }
+        switch (feed->read(next, event)) {
+            case ChangeFeed::Read::Ok:
+                ChangeFeed::print(event, std::cout);
+                next++;
+                break;
+            case ChangeFeed::Read::Overrun: {
+                uint64_t resume = std::max(next + 1, feed->oldest());
+                std::cout << "# missed " << resume - next << " events; resuming at " << resume << "\n";
+                next = resume;
+                break;
+            }
+            case ChangeFeed::Read::NotYet:
+                std::cout.flush();
+                feed->wait(next, std::chrono::milliseconds(100));
+                break;
+        }
+    }
+    std::cout << "# next " << next << std::endl;
+    return 0;
+}
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    int port = 7070;
+    int connections = 1000;
+    int requestsPerConnection = 200;
+    int pipelineDepth = 8;
+    unsigned seed = 42;
+};
+
+// Client side of the line protocol for load testing a --serve process. Opens many
+// connections from one epoll loop, keeps up to pipelineDepth requests in flight on
+// each, and reports throughput and latency per command. The mix is mostly screens,
+// with availability checks and some reservations.
+int runLoadGenerator(const LoadConfig& config) {
+    struct Client {
+        int fd = -1;
+        std::string in, out;
+        size_t written = 0;
+        int sent = 0, received = 0;
+        std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> inFlight;
+    };
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(config.port));
+    if (::inet_pton(AF_INET, config.host.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Bad address " << config.host << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(config.seed);
+    auto pick = [&rng](int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); };
+    auto nextRequest = [&](std::string& command) {
+        char date[16], time[8];
+        std::snprintf(date, sizeof(date), "2031-%02d-%02d", pick(1, 12), pick(1, 28));
+        std::snprintf(time, sizeof(time), "%02d:%02d", pick(17, 21), pick(0, 1) * 30);
+        int roll = pick(1, 100);
+        if (roll <= 40) command = "report";
+        else if (roll <= 60) command = "tables";
+        else if (roll <= 75) command = "available";
+        else if (roll <= 85) command = "menu";
+        else if (roll <= 95) command = "reserve";
+        else command = "grid";
+
+        if (command == "available") return "available " + std::to_string(pick(2, 8)) + " " + date + " " + time;
+        if (command == "reserve") {
+            return "reserve \"Load Test\" 555-0100 " + std::to_string(pick(1, 6)) + " " + date + " " + time +
+                   " minutes=90";
+        }
+        if (command == "grid") return "grid " + std::string(date);
+        return command;
+    };
+
+    int epollFd = ::epoll_create1(0);
+    std::vector<Client> clients(config.connections);
+    for (int i = 0; i < config.connections; i++) {
+        Client& client = clients[i];
+        client.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        int one = 1;
+        ::setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (client.fd < 0 || (::connect(client.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 &&
+                              errno != EINPROGRESS)) {
+            std::cerr << "Could not connect to " << config.host << ":" << config.port << ": "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.u32 = static_cast<uint32_t>(i);
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+    }
+
+    std::map<std::string, std::vector<double>> latencies;
+    std::vector<double> all;
+    long okCount = 0, errorCount = 0;
+    int finished = 0, failed = 0;
+    std::vector<epoll_event> ready(1024);
+    auto start = std::chrono::steady_clock::now();
+
+    auto finish = [&](Client& client, bool ok) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+        ::close(client.fd);
+        client.fd = -1;
+        finished++;
+        if (!ok) failed++;
+    };
+
+    while (finished < config.connections) {
+        int count = ::epoll_wait(epollFd, ready.data(), static_cast<int>(ready.size()), 5000);
+        if (count == 0) {
+            std::cerr << "Timed out waiting for the server" << std::endl;
+            break;
+        }
+        for (int e = 0; e < count; e++) {
+            Client& client = clients[ready[e].data.u32];
+            if (client.fd < 0) continue;
+            bool ok = true;
+
+            if (ready[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                char buffer[16384];
+                while (true) {
+                    ssize_t n = ::recv(client.fd, buffer, sizeof(buffer), 0);
+                    if (n > 0) {
+                        client.in.append(buffer, static_cast<size_t>(n));
+                        continue;
+                    }
+                    ok = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                    break;
+                }
+                // Each response ends with "\n.\n"; stuffed body lines never look like that
+                size_t pos = 0, end;
+                auto now = std::chrono::steady_clock::now();
+                while (!client.inFlight.empty() && (end = client.in.find("\n.\n", pos)) != std::string::npos) {
+                    bool success = client.in.compare(pos, 3, "OK\n") == 0;
+                    (success ? okCount : errorCount)++;
+                    auto& [sentAt, command] = client.inFlight.front();
+                    double micros = std::chrono::duration<double, std::micro>(now - sentAt).count();
+                    latencies[command].push_back(micros);
+                    all.push_back(micros);
+                    client.inFlight.pop_front();
+                    client.received++;
+                    pos = end + 3;
+                }
+                client.in.erase(0, pos);
+            }
+            if (client.received == config.requestsPerConnection) {
+                finish(client, true);
+                continue;
+            }
+            if (!ok) {
+                finish(client, false);
+                continue;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            while (client.sent < config.requestsPerConnection &&
+                   static_cast<int>(client.inFlight.size()) < config.pipelineDepth) {
+                std::string command;
+                client.out += nextRequest(command) + "\n";
+                client.inFlight.push_back({now, command});
+                client.sent++;
+            }
+            while (client.written < client.out.size()) {
+                ssize_t n = ::send(client.fd, client.out.data() + client.written, client.out.size() - client.written,
+                                   MSG_NOSIGNAL);
+                if (n <= 0) break;
+                client.written += static_cast<size_t>(n);
+            }
+            if (client.written == client.out.size()) {
+                client.out.clear();
+                client.written = 0;
+            }
+            epoll_event event{};
+            event.events = EPOLLIN | (client.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+            event.data.u32 = ready[e].data.u32;
+            ::epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (auto& client : clients) {
+        if (client.fd >= 0) ::close(client.fd);
+    }
+    ::close(epollFd);
+
+    std::cout << "\n=== Load Generator ===" << std::endl;
+    std::cout << "Server: " << config.host << ":" << config.port << " | Connections: " << config.connections
+              << " | Requests per connection: " << config.requestsPerConnection
+              << " | Pipeline depth: " << config.pipelineDepth << std::endl;
+    std::cout << "Responses: " << all.size() << " (" << okCount << " OK, " << errorCount << " ERR) in "
+              << std::fixed << std::setprecision(1) << seconds * 1000.0 << " ms | Failed connections: " << failed
+              << std::endl;
+    std::cout << "Throughput: " << std::setprecision(0) << (seconds > 0 ? all.size() / seconds : 0.0)
+              << " requests/sec" << std::endl;
+    latencies["all"] = all;
+    printLatencyTable(latencies, "Request");
+    std::sort(all.begin(), all.end());
+    std::cout << "p99.9 (us): " << std::setprecision(1) << percentile(all, 0.999) << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+struct WorkloadConfig {
+    int menuItems = 600;
+    int tables = 150;
+    int orders = 50000;
+    int reservations = 5000;
+    unsigned seed = 42;
+};
+
+// Synthesizes menus, floor plans and order/reservation streams with realistic skew:
+// item popularity follows a Zipf distribution and arrivals cluster around lunch and dinner.
+class WorkloadGenerator {
+private:
+    std::mt19937_64 rng;
+    std::vector<std::string> itemIds;
+    std::vector<double> popularity; // cumulative Zipf weights, parallel to itemIds
+
+public:
+    explicit WorkloadGenerator(unsigned seed) : rng(seed) {}
+
+    double uniform() {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    }
+
+    int between(int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(rng);
+    }
+
+    void buildMenu(Restaurant& restaurant, int count, double skew = 1.1) {
+        static const char* categories[] = {"Appetizer", "Main Course", "Pasta", "Salad", "Dessert", "Beverage"};
+        static const char* ingredients[] = {"Tomatoes", "Basil", "Beef", "Chicken", "Pasta", "Cream", "Parmesan",
+                                            "Garlic", "Mushrooms", "Shrimp", "Lettuce", "Chocolate"};
+        static const char* allergens[] = {"Gluten", "Dairy", "Nuts", "Shellfish", "Eggs", "Soy"};
+        double total = 0.0;
+        for (int i = 0; i < count; i++) {
+            char id[16];
+            std::snprintf(id, sizeof(id), "GEN%05d", i + 1);
+            const char* category = categories[between(0, 5)];
+            auto item = std::make_shared<MenuItem>(id, std::string("Dish ") + id, category, "Generated dish",
+                                                   between(400, 4500) / 100.0, between(3, 30),
+                                                   between(0, 5), between(80, 1200));
+            for (int k = between(2, 5); k > 0; k--) item->addIngredient(ingredients[between(0, 11)]);
+            for (int k = between(0, 2); k > 0; k--) item->addAllergen(allergens[between(0, 5)]);
+            restaurant.addMenuItem(item);
+
+            itemIds.push_back(id);
+            total += 1.0 / std::pow(i + 1, skew);
+            popularity.push_back(total);
+        }
+        for (auto& weight : popularity) weight /= total;
+    }
+
+    // Returns the table numbers with their capacities
+    std::vector<std::pair<int, int>> buildFloorPlan(Restaurant& restaurant, int count) {
+        static const int capacities[] = {2, 2, 2, 4, 4, 4, 4, 6, 6, 8};
+        static const char* locations[] = {"Main Hall", "Window", "Patio", "Bar", "Private Room"};
+        std::vector<std::pair<int, int>> plan;
+        for (int i = 0; i < count; i++) {
+            int number = 100 + i;
+            int capacity = capacities[between(0, 9)];
+            restaurant.addTable(std::make_shared<Table>(number, capacity, locations[between(0, 4)]));
+            plan.push_back({number, capacity});
+        }
+        return plan;
+    }
 
-    std::string generateOrderId() {
-        return "ORD" + std::to_string(nextOrderId++);
+    const std::string& pickItem() {
+        size_t index = std::lower_bound(popularity.begin(), popularity.end(), uniform()) - popularity.begin();
+        return itemIds[std::min(index, itemIds.size() - 1)];
     }
 
-    std::string generateReservationId() {
-        return "RES" + std::to_string(nextReservationId++);
+    // Minute of day; a third of the traffic around 12:30, the rest around 19:30
+    int pickArrivalMinute() {
+        double peak = uniform() < 0.35 ? 12.5 * 60 : 19.5 * 60;
+        double spread = peak < 15 * 60 ? 50.0 : 75.0;
+        int minute = static_cast<int>(std::normal_distribution<double>(peak, spread)(rng));
+        return std::max(11 * 60, std::min(minute, 23 * 60));
     }
 
-    std::string getCurrentTime() {
-        time_t now = time(0);
-        tm* localTime = localtime(&now);
-        std::stringstream ss;
-        ss << std::setw(2) << std::setfill('0') << localTime->tm_hour << ":"
-           << std::setw(2) << std::setfill('0') << localTime->tm_min;
-        return ss.str();
+    int pickPartySize() {
+        static const int sizes[] = {1, 2, 2, 2, 2, 3, 4, 4, 4, 5, 6, 8};
+        return sizes[between(0, 11)];
     }
 
-    std::string getCurrentDate() {
-        time_t now = time(0);
-        tm* localTime = localtime(&now);
-        std::stringstream ss;
-        ss << (1900 + localTime->tm_year) << "-" 
-           << std::setw(2) << std::setfill('0') << (1 + localTime->tm_mon) << "-" 
-           << std::setw(2) << std::setfill('0') << localTime->tm_mday;
-        return ss.str();
+    // Seated-to-paid time grows with the party size
+    int pickDwellMinutes(int partySize) {
+        return between(35, 60) + partySize * between(4, 8);
     }
 
-public:
-    Restaurant(std::string name) : restaurantName(name), nextOrderId(1001), nextReservationId(2001) {
-        initializeMenu();
-        initializeTables();
+    // One or two items per guest, merged into quantities
+    std::vector<OrderRequestLine> pickOrderLines(int partySize) {
+        std::vector<OrderRequestLine> lines;
+        int itemCount = partySize + between(0, partySize);
+        for (int i = 0; i < itemCount; i++) {
+            const std::string& itemId = pickItem();
+            auto it = std::find_if(lines.begin(), lines.end(),
+                [&itemId](const OrderRequestLine& line) { return line.itemId == itemId; });
+            if (it != lines.end()) it->quantity++;
+            else lines.push_back({itemId, 1});
+        }
+        return lines;
     }
 
-    void initializeMenu() {
-        // Appetizers
-        auto bruschetta = std::make_shared<MenuItem>("APP001", "Bruschetta", "Appetizer", 
-            "Toasted bread topped with tomatoes and basil", 8.99, 10, 1, 180);
-        bruschetta->addIngredient("Bread");
-        bruschetta->addIngredient("Tomatoes");
-        bruschetta->addIngredient("Basil");
-        bruschetta->addAllergen("Gluten");
-        menu.push_back(bruschetta);
+    std::string pickName() {
+        static const char* first[] = {"Ann", "Ben", "Carla", "Dev", "Elif", "Femi", "Grace", "Hiro"};
+        static const char* last[] = {"Lee", "Moreau", "Okafor", "Rossi", "Silva", "Tanaka", "Weber"};
+        return std::string(first[between(0, 7)]) + " " + last[between(0, 6)];
+    }
 
-        // Main Courses
-        auto steak = std::make_shared<MenuItem>("MAIN001", "Ribeye Steak", "Main Course",
-            "12oz ribeye with mashed potatoes", 29.99, 20, 0, 650);
-        steak->addIngredient("Beef");
-        steak->addIngredient("Potatoes");
-        steak->addIngredient("Butter");
-        menu.push_back(steak);
+    std::string pickPhone() {
+        return "555-" + std::to_string(between(1000, 9999));
+    }
+};
 
-        auto pasta = std::make_shared<MenuItem>("MAIN002", "Fettuccine Alfredo", "Main Course",
-            "Creamy pasta with parmesan cheese", 16.99, 15, 0, 480);
-        pasta->addIngredient("Pasta");
-        pasta->addIngredient("Cream");
-        pasta->addIngredient("Parmesan");
-        pasta->addAllergen("Gluten");
-        pasta->addAllergen("Dairy");
-        menu.push_back(pasta);
+double peakRssMegabytes() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // ru_maxrss is in kilobytes on Linux
+}
 
-        // Desserts
-        auto cheesecake = std::make_shared<MenuItem>("DES001", "New York Cheesecake", "Dessert",
-            "Classic cheesecake with berry compote", 7.99, 5, 0, 320);
-        cheesecake->addIngredient("Cream Cheese");
-        cheesecake->addIngredient("Graham Cracker");
-        cheesecake->addIngredient("Berries");
-        cheesecake->addAllergen("Gluten");
-        cheesecake->addAllergen("Dairy");
-        menu.push_back(cheesecake);
-    }
+double currentRssMegabytes() {
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (::sysconf(_SC_PAGESIZE) / 1048576.0);
+}
 
-    void initializeTables() {
-        tables.push_back(std::make_shared<Table>(1, 2, "Window", "Window view"));
-        tables.push_back(std::make_shared<Table>(2, 4, "Main Hall", ""));
-        tables.push_back(std::make_shared<Table>(3, 6, "Private Room", "Private dining"));
-        tables.push_back(std::make_shared<Table>(4, 2, "Patio", "Outdoor seating"));
-        tables.push_back(std::make_shared<Table>(5, 8, "Main Hall", "Round table"));
+// Discards everything written to it; display calls print here while being timed
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Simulates service days against a generated restaurant: parties arrive around lunch and
+// dinner, are seated, order, and move through cooking/ready/served/paid; the console views
+// and the daily report are rendered periodically. Then a reservation stream is replayed.
+// Reports ops/sec and p50/p99 latency per operation, plus peak RSS.
+void runWorkloadBenchmark(const WorkloadConfig& config) {
+    Restaurant restaurant("Benchmark");
+    WorkloadGenerator generator(config.seed);
+    generator.buildMenu(restaurant, config.menuItems);
+    auto floorPlan = generator.buildFloorPlan(restaurant, config.tables);
+
+    std::map<std::string, std::vector<double>> latencies;
+    std::map<std::string, double> totalSeconds;
+    auto timed = [&](const std::string& name, const std::function<void()>& operation) {
+        auto start = std::chrono::steady_clock::now();
+        operation();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        latencies[name].push_back(seconds * 1e6);
+        totalSeconds[name] += seconds;
+    };
+
+    NullBuffer nullBuffer;
+    std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+
+    // Events are (simulated minute, sequence, kind, party); kind 0 is an arrival,
+    // kind 1 moves that party's order to its next status.
+    using Event = std::tuple<int, int, int, int>;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    int sequence = 0;
+    int ordersPerDay = std::max(1, config.tables * 6);
+    for (int i = 0; i < config.orders; i++) {
+        events.push({(i / ordersPerDay) * 24 * 60 + generator.pickArrivalMinute(), sequence++, 0, i});
     }
 
-    void displayMenu() {
-        std::cout << "\n=== " << restaurantName << " Menu ===" << std::endl;
-        std::map<std::string, std::vector<std::shared_ptr<MenuItem>>> categorizedMenu;
-        
-        for (const auto& item : menu) {
-            categorizedMenu[item->getCategory()].push_back(item);
-        }
+    static const OrderStatus statuses[] = {OrderStatus::Cooking, OrderStatus::Ready, OrderStatus::Served,
+                                           OrderStatus::Paid};
+    std::vector<int> partySize(config.orders), partyTable(config.orders, -1), dwell(config.orders);
+    std::vector<std::string> partyOrder(config.orders);
+    std::vector<int> partyStage(config.orders, 0);
+    std::vector<bool> tableFree(floorPlan.size(), true);
+    int turnedAway = 0, failures = 0, processed = 0;
+    std::string error;
 
-        for (const auto& [category, items] : categorizedMenu) {
-            std::cout << "\n--- " << category << " ---" << std::endl;
-            for (const auto& item : items) {
-                if (item->getAvailability()) {
-                    std::cout << item->getItemId() << " - " << std::left << std::setw(25) 
-                              << item->getName() << " - $" << std::fixed << std::setprecision(2) 
-                              << item->getPrice() << " (" << item->getPreparationTime() << " min)" << std::endl;
+    auto wallStart = std::chrono::steady_clock::now();
+    while (!events.empty()) {
+        auto [minute, seq, kind, party] = events.top();
+        (void)seq;
+        events.pop();
+
+        if (kind == 0) {
+            partySize[party] = generator.pickPartySize();
+            int best = -1;
+            for (size_t t = 0; t < floorPlan.size(); t++) {
+                if (tableFree[t] && floorPlan[t].second >= partySize[party] &&
+                    (best < 0 || floorPlan[t].second < floorPlan[best].second)) {
+                    best = static_cast<int>(t);
                 }
             }
-        }
-    }
+            if (best < 0) {
+                turnedAway++;
+                continue;
+            }
+            tableFree[best] = false;
+            partyTable[party] = best;
+            int tableNumber = floorPlan[best].first;
+            auto lines = generator.pickOrderLines(partySize[party]);
+            dwell[party] = generator.pickDwellMinutes(partySize[party]);
 
-    void displayAvailableTables() {
-        std::cout << "\n=== Available Tables ===" << std::endl;
-        bool found = false;
-        for (const auto& table : tables) {
-            if (!table->getOccupancy()) {
-                table->displayInfo();
-                found = true;
+            bool seated = false;
+            timed("seat", [&] { seated = restaurant.seatTable(tableNumber, error); });
+            std::shared_ptr<Order> order;
+            timed("order", [&] { order = restaurant.placeOrder(tableNumber, partySize[party], lines, "", error); });
+            if (!seated || !order) {
+                failures++;
+                continue;
+            }
+            partyOrder[party] = order->getOrderId();
+            events.push({minute + 2, sequence++, 1, party});
+        } else {
+            int stage = partyStage[party]++;
+            bool ok = false;
+            timed("status", [&] { ok = restaurant.setOrderStatus(partyOrder[party], statuses[stage], error); });
+            if (!ok) failures++;
+            // cooking -> ready -> served take kitchen and floor time; paid ends the dwell
+            static const int delays[] = {15, 3, 0};
+            if (stage < 3) {
+                int delay = stage < 2 ? delays[stage] : std::max(1, dwell[party] - 20);
+                events.push({minute + delay, sequence++, 1, party});
+            } else {
+                tableFree[partyTable[party]] = true;
             }
         }
-        if (!found) {
-            std::cout << "No available tables at the moment." << std::endl;
-        }
+
+        processed++;
+        if (processed % 500 == 0) timed("active", [&] { restaurant.displayActiveOrders(); });
+        if (processed % 1000 == 0) timed("menu", [&] { restaurant.displayMenu(); });
+        if (processed % 5000 == 0) timed("report", [&] { restaurant.generateDailyReport(); });
     }
 
-    void makeReservation() {
-        std::string name, phone, date, time;
-        int partySize;
+    char date[16];
+    int reserved = 0;
+    for (int i = 0; i < config.reservations; i++) {
+        std::snprintf(date, sizeof(date), "2026-10-%02d", generator.between(17, 23));
+        int minute = generator.pickArrivalMinute();
+        char time[16];
+        std::snprintf(time, sizeof(time), "%02d:%02d", minute / 60, minute % 60);
+        std::string name = generator.pickName(), phone = generator.pickPhone();
+        int size = generator.pickPartySize();
+        std::shared_ptr<Reservation> reservation;
+        timed("reserve", [&] { reservation = restaurant.reserve(name, phone, size, date, time, "", error); });
+        if (reservation) reserved++;
+    }
+    for (int i = 0; i < 20; i++) timed("today", [&] { restaurant.displayTodayReservations(); });
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
 
-        std::cout << "\n=== Make Reservation ===" << std::endl;
-        std::cin.ignore();
-        std::cout << "Customer Name: ";
-        std::getline(std::cin, name);
-        std::cout << "Phone: ";
-        std::getline(std::cin, phone);
-        std::cout << "Party Size: ";
-        std::cin >> partySize;
-        std::cout << "Date (YYYY-MM-DD): ";
-        std::cin >> date;
-        std::cout << "Time (HH:MM): ";
-        std::cin >> time;
+    std::cout.rdbuf(console);
+    std::cout << "\n=== Workload Benchmark ===" << std::endl;
+    std::cout << "Menu items: " << config.menuItems << " | Tables: " << config.tables
+              << " | Parties: " << config.orders << " | Reservation requests: " << config.reservations
+              << " | Seed: " << config.seed << std::endl;
+    std::cout << "Turned away: " << turnedAway << " | Failed operations: " << failures
+              << " | Reservations confirmed: " << reserved << std::endl;
+    std::cout << "Wall time: " << std::fixed << std::setprecision(1) << wallSeconds * 1000.0 << " ms"
+              << " | Peak RSS: " << peakRssMegabytes() << " MB" << std::endl;
+    std::cout << std::left << std::setw(10) << "Operation" << std::right << std::setw(14) << "ops/sec" << std::endl;
+    for (const auto& [name, seconds] : totalSeconds) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(14) << std::setprecision(0)
+                  << (seconds > 0 ? latencies[name].size() / seconds : 0.0) << std::endl;
+    }
+    printLatencyTable(latencies, "Operation");
+}
 
-        // Find suitable table
-        std::shared_ptr<Table> selectedTable = nullptr;
-        for (const auto& table : tables) {
-            if (!table->getOccupancy() && table->getCapacity() >= partySize) {
-                selectedTable = table;
-                break;
-            }
+// Drives one Restaurant from many terminal threads at once, each working its own
+// section of tables through seat/order/cooking/ready/served/paid, while a kitchen
+// display thread keeps rendering. Repeats for 1, 2, 4, 8 and 16 terminals and
+// reports throughput and scaling, then checks that nothing was lost.
+void runStressTest(int partiesPerTerminal, unsigned seed) {
+    const int tablesPerTerminal = 8;
+    const std::vector<int> terminalCounts = {1, 2, 4, 8, 16};
+    static const OrderStatus statuses[] = {OrderStatus::Cooking, OrderStatus::Ready, OrderStatus::Served,
+                                           OrderStatus::Paid};
+
+    NullBuffer nullBuffer;
+    std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+    std::vector<std::string> results;
+    double baseline = 0.0;
+
+    for (int terminals : terminalCounts) {
+        Restaurant restaurant("Stress");
+        WorkloadGenerator generator(seed);
+        generator.buildMenu(restaurant, 200);
+        for (int t = 0; t < terminals * tablesPerTerminal; t++) {
+            restaurant.addTable(std::make_shared<Table>(100 + t, 8, "Main Hall"));
         }
+        // Order lines are drawn up front so the generator stays out of the timed loop
+        std::vector<std::vector<OrderRequestLine>> orderLines;
+        for (int i = 0; i < 256; i++) orderLines.push_back(generator.pickOrderLines(generator.between(1, 6)));
 
-        if (selectedTable) {
-            std::string reservationId = generateReservationId();
-            auto reservation = std::make_shared<Reservation>(reservationId, name, phone, partySize, date, time, selectedTable->getTableNumber());
-            
-            std::cin.ignore();
-            std::string requests;
-            std::cout << "Special Requests: ";
-            std::getline(std::cin, requests);
-            if (!requests.empty()) {
-                reservation->addSpecialRequests(requests);
+        std::atomic<bool> go(false), done(false);
+        std::atomic<int> failures(0);
+        std::atomic<long> renders(0);
+        std::vector<std::thread> threads;
+        for (int terminal = 0; terminal < terminals; terminal++) {
+            threads.emplace_back([&, terminal] {
+                while (!go) std::this_thread::yield();
+                std::string error;
+                for (int i = 0; i < partiesPerTerminal; i++) {
+                    int tableNumber = 100 + terminal * tablesPerTerminal + i % tablesPerTerminal;
+                    const auto& lines = orderLines[(terminal * 31 + i) % orderLines.size()];
+                    bool ok = restaurant.seatTable(tableNumber, error);
+                    auto order = restaurant.placeOrder(tableNumber, 2, lines, "", error);
+                    if (!ok || !order) {
+                        failures++;
+                        continue;
+                    }
+                    for (OrderStatus status : statuses) {
+                        if (!restaurant.setOrderStatus(order->getOrderId(), status, error)) failures++;
+                    }
+                }
+            });
+        }
+        std::thread display([&] {
+            while (!go) std::this_thread::yield();
+            while (!done) {
+                restaurant.displayKitchenQueue();
+                restaurant.displayWaitlist();
+                restaurant.displayFeed(0);
+                restaurant.generateDailyReport();
+                renders++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
             }
+        });
 
-            selectedTable->reserveTable();
-            reservations.push_back(reservation);
-            std::cout << "Reservation confirmed! ID: " << reservationId << std::endl;
-        } else {
-            std::cout << "No suitable tables available for the requested time." << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+        for (auto& thread : threads) thread.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done = true;
+        display.join();
+
+        // Every party paid, so every table is free again and the report counts them all.
+        // Each party is seven events on the feed: seated, placed, four statuses, freed.
+        long expected = static_cast<long>(terminals) * partiesPerTerminal;
+        std::stringstream report;
+        restaurant.generateDailyReport(report);
+        restaurant.displayActiveOrders(report);
+        bool consistent = failures == 0 && restaurant.changeFeed().head() == static_cast<uint64_t>(expected) * 7 &&
+                          report.str().find("Orders Completed: " + std::to_string(expected) + "\n") != std::string::npos &&
+                          report.str().find("No active orders.") != std::string::npos;
+
+        double opsPerSecond = expected * 6 / seconds;
+        if (terminals == 1) baseline = opsPerSecond;
+        std::stringstream row;
+        row << std::left << std::setw(10) << terminals << std::right << std::fixed << std::setprecision(0)
+            << std::setw(14) << opsPerSecond << std::setprecision(2) << std::setw(10) << opsPerSecond / baseline
+            << "x" << std::setw(10) << renders.load() << std::setw(12) << (consistent ? "ok" : "MISMATCH");
+        results.push_back(row.str());
+    }
+
+    std::cout.rdbuf(console);
+    std::cout << "\n=== Concurrent Terminal Stress Test ===" << std::endl;
+    std::cout << "Parties per terminal: " << partiesPerTerminal << " | Tables per terminal: " << tablesPerTerminal
+              << " | Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::left << std::setw(10) << "Threads" << std::right << std::setw(14) << "ops/sec"
+              << std::setw(11) << "Scaling" << std::setw(10) << "Renders" << std::setw(12) << "Check" << std::endl;
+    for (const auto& row : results) std::cout << row << std::endl;
+}
+
+// Times a full kitchen replan with the given number of in-flight tickets, and the
+// place-one-order path (add a ticket, then replan) at that depth
+void runKitchenBenchmark(int ticketCount, unsigned seed) {
+    KitchenScheduler kitchen;
+    int grill = kitchen.addStation("grill", 2);
+    for (const char* name : {"pasta", "cold", "dessert", "bar"}) kitchen.addStation(name, 1);
+    kitchen.assignCategory("Main Course", grill, true);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> station(0, 4), minutes(3, 30), lineCount(1, 8);
+    auto makeTasks = [&] {
+        std::vector<KitchenScheduler::Task> tasks(lineCount(rng));
+        for (auto& task : tasks) {
+            task.itemId = "GEN";
+            task.station = station(rng);
+            task.minutes = minutes(rng);
         }
+        return tasks;
+    };
+
+    const int64_t now = 29000000; // an arbitrary minute; only differences matter
+    for (int i = 0; i < ticketCount; i++) {
+        kitchen.addTicket("ORD" + std::to_string(1001 + i), now - ticketCount + i, makeTasks());
     }
 
-    void createOrder() {
-        int tableNumber;
-        std::cout << "\n=== Create New Order ===" << std::endl;
-        std::cout << "Table Number: ";
-        std::cin >> tableNumber;
+    std::map<std::string, std::vector<double>> latencies;
+    const int rounds = 2000;
+    for (int i = 0; i < rounds; i++) {
+        auto start = std::chrono::steady_clock::now();
+        kitchen.reschedule(now);
+        latencies["replan"].push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    for (int i = 0; i < rounds; i++) {
+        std::string orderId = "ORD" + std::to_string(1001 + ticketCount + i);
+        auto tasks = makeTasks();
+        auto start = std::chrono::steady_clock::now();
+        kitchen.addTicket(orderId, now, std::move(tasks));
+        kitchen.reschedule(now);
+        latencies["order"].push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+        kitchen.removeTicket(orderId);
+    }
 
-        // Check if table exists and is occupied
-        auto tableIt = std::find_if(tables.begin(), tables.end(),
-            [tableNumber](const std::shared_ptr<Table>& t) {
-                return t->getTableNumber() == tableNumber && t->getOccupancy();
-            });
+    std::cout << "\n=== Kitchen Scheduler Benchmark ===" << std::endl;
+    std::cout << "In-flight tickets: " << ticketCount << " | Seed: " << seed << std::endl;
+    printLatencyTable(latencies, "Operation");
+}
 
-        if (tableIt == tables.end()) {
-            std::cout << "Table not found or not occupied." << std::endl;
-            return;
+// Places orders from the workload generator's menu and mix (every one paid, so they stay in
+// memory as they would over a service day without snapshots) and reports heap
+// allocations per placeOrder call and resident memory per 100k orders
+void runOrderMemoryBenchmark(int orderCount, unsigned seed) {
+    Restaurant restaurant("Benchmark");
+    WorkloadGenerator generator(seed);
+    generator.buildMenu(restaurant, 600);
+    auto floorPlan = generator.buildFloorPlan(restaurant, 150);
+    std::vector<std::vector<OrderRequestLine>> parties;
+    parties.reserve(orderCount);
+    for (int i = 0; i < orderCount; i++) parties.push_back(generator.pickOrderLines(generator.pickPartySize()));
+
+    std::string error;
+    uint64_t allocations = 0;
+    size_t lineCount = 0;
+    int failures = 0;
+    double rssBefore = currentRssMegabytes();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < orderCount; i++) {
+        int tableNumber = floorPlan[i % floorPlan.size()].first;
+        restaurant.seatTable(tableNumber, error);
+        uint64_t before = heapAllocations;
+        auto order = restaurant.placeOrder(tableNumber, 2, parties[i], "", error);
+        allocations += heapAllocations - before;
+        lineCount += parties[i].size();
+        if (!order || !restaurant.setOrderStatus(order->getOrderId(), OrderStatus::Paid, error)) failures++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double rssGrowth = currentRssMegabytes() - rssBefore;
+
+    std::cout << "\n=== Order Memory Benchmark ===" << std::endl;
+    std::cout << "Orders: " << orderCount << " | Lines per order: " << std::fixed << std::setprecision(2)
+              << static_cast<double>(lineCount) / orderCount << " | Failed: " << failures << " | Seed: " << seed
+              << std::endl;
+#ifdef RMS_COUNT_ALLOCATIONS
+    std::cout << "Heap allocations per order: " << static_cast<double>(allocations) / orderCount << std::endl;
+#else
+    std::cout << "Heap allocations per order: not counted (build with -DRMS_COUNT_ALLOCATIONS)" << std::endl;
+#endif
+    std::cout << "RSS per 100k orders: " << std::setprecision(1) << rssGrowth * 100000.0 / orderCount << " MB"
+              << std::endl;
+    std::cout << "Orders/sec (place and pay): " << std::setprecision(0) << orderCount / seconds << std::endl;
+}
+
+// Compares menu queries on the catalogue (bitmask kernel, precomputed ranking) against a
+// scan of MenuItem records comparing allergen and ingredient strings, then sorting
+void runFilterBenchmark(int menuItems, unsigned seed) {
+    Restaurant restaurant("Benchmark");
+    WorkloadGenerator generator(seed);
+    generator.buildMenu(restaurant, menuItems);
+    const MenuCatalog& catalog = restaurant.getMenu();
+
+    std::vector<MenuItem> records;
+    for (uint32_t i = 0; i < catalog.size(); i++) {
+        MenuItem item(std::string(catalog.itemId(i)), std::string(catalog.name(i)), std::string(catalog.category(i)),
+                      std::string(catalog.description(i)), catalog.priceCents(i) / 100.0, catalog.preparationTime(i),
+                      catalog.spiceLevel(i), catalog.calories(i));
+        for (uint32_t symbol : catalog.ingredients(i)) item.addIngredient(std::string(catalog.symbolName(symbol)));
+        for (uint32_t symbol : catalog.allergens(i)) item.addAllergen(std::string(catalog.symbolName(symbol)));
+        records.push_back(item);
+    }
+    auto scan = [&records](const MenuQuery& query) {
+        auto listsAny = [](const std::vector<std::string>& list, const std::vector<std::string>& names) {
+            return std::find_first_of(list.begin(), list.end(), names.begin(), names.end()) != list.end();
+        };
+        std::vector<uint32_t> listed;
+        for (uint32_t i = 0; i < records.size(); i++) {
+            const MenuItem& item = records[i];
+            if (!item.getAvailability() && !query.includeUnavailable) continue;
+            if (!query.category.empty() && item.getCategory() != query.category) continue;
+            if (query.maxCalories >= 0 && (item.getCalories() <= 0 || item.getCalories() > query.maxCalories)) continue;
+            if (query.maxSpice >= 0 && item.getSpiceLevel() > query.maxSpice) continue;
+            if (query.maxCents >= 0 && toCents(item.getPrice()) > query.maxCents) continue;
+            if (listsAny(item.getAllergens(), query.withoutAllergens)) continue;
+            if (listsAny(item.getIngredients(), query.withoutIngredients)) continue;
+            listed.push_back(i);
         }
+        std::stable_sort(listed.begin(), listed.end(), [&records](uint32_t a, uint32_t b) {
+            return records[a].getCategory() < records[b].getCategory();
+        });
+        return listed;
+    };
 
-        int customerCount;
-        std::cout << "Number of customers: ";
-        std::cin >> customerCount;
+    std::vector<std::pair<std::string, MenuQuery>> queries(4);
+    queries[0].first = "no gluten/dairy, <=500 cal, spice <=2";
+    queries[0].second.withoutAllergens = {"Gluten", "Dairy"};
+    queries[0].second.maxCalories = 500;
+    queries[0].second.maxSpice = 2;
+    queries[1].first = "no nuts/shellfish";
+    queries[1].second.withoutAllergens = {"Nuts", "Shellfish"};
+    queries[2].first = "pasta without beef, <= $20";
+    queries[2].second.category = "Pasta";
+    queries[2].second.withoutIngredients = {"Beef"};
+    queries[2].second.maxCents = 2000;
+    queries[3].first = "everything available";
 
-        std::string orderId = generateOrderId();
-        std::string orderTime = getCurrentTime();
-        auto order = std::make_shared<Order>(orderId, tableNumber, orderTime, customerCount);
+    std::cout << "\n=== Menu Filter Benchmark ===" << std::endl;
+    std::cout << "Menu items: " << menuItems << " | Seed: " << seed << std::endl;
+    std::cout << std::left << std::setw(40) << "Query" << std::right << std::setw(9) << "Matches"
+              << std::setw(16) << "scan (us/op)" << std::setw(18) << "catalog (us/op)" << std::setw(10) << "Speedup"
+              << std::endl;
+    const int rounds = 200;
+    for (const auto& [label, query] : queries) {
+        size_t matches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) matches = scan(query).size();
+        double scanMicros = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) matches = catalog.filter(query).size();
+        double filterMicros = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
 
-        bool addingItems = true;
-        while (addingItems) {
-            displayMenu();
-            std::string itemId;
-            int quantity;
+        if (scan(query) != catalog.filter(query)) std::cout << "Result mismatch for " << label << "!" << std::endl;
+        std::cout << std::left << std::setw(40) << label << std::right << std::setw(9) << matches << std::fixed
+                  << std::setprecision(1) << std::setw(16) << scanMicros << std::setw(18) << filterMicros
+                  << std::setw(9) << scanMicros / filterMicros << "x" << std::endl;
+    }
+}
 
-            std::cout << "Enter Item ID (or 'done' to finish): ";
-            std::cin >> itemId;
+// Fills a sales history with `days` days of generated service (six orders per table per
+// day) and times the analytics groupings over the whole range and over the last 30
+// days, on one thread and on every hardware thread
+void runSalesBenchmark(int days, unsigned seed) {
+    Restaurant restaurant("Benchmark");
+    WorkloadGenerator generator(seed);
+    generator.buildMenu(restaurant, 600);
+    auto floorPlan = generator.buildFloorPlan(restaurant, 150);
+    const MenuCatalog& menu = restaurant.getMenu();
 
-            if (itemId == "done") {
-                addingItems = false;
-                continue;
+    SalesHistory history;
+    int firstDay = 0;
+    parseDate("2025-01-01", firstDay);
+    std::vector<SalesHistory::Line> lines;
+    for (int day = firstDay; day < firstDay + days; day++) {
+        for (int round = 0; round < 6; round++) {
+            for (const auto& [tableNumber, capacity] : floorPlan) {
+                int party = std::min(generator.pickPartySize(), capacity);
+                lines.clear();
+                for (const auto& line : generator.pickOrderLines(party)) {
+                    uint32_t index = restaurant.findMenuItem(line.itemId);
+                    lines.push_back({index, line.quantity, menu.priceCents(index)});
+                }
+                history.addOrder(day, generator.pickArrivalMinute() / 60, tableNumber, party, lines, 1);
             }
+        }
+    }
 
-            auto itemIt = std::find_if(menu.begin(), menu.end(),
-                [&itemId](const std::shared_ptr<MenuItem>& m) {
-                    return m->getItemId() == itemId && m->getAvailability();
-                });
+    std::vector<uint32_t> categoryOf(menu.size());
+    std::unordered_map<uint32_t, uint32_t> categories;
+    for (uint32_t i = 0; i < menu.size(); i++) {
+        categoryOf[i] = categories.insert({menu.categorySymbol(i), uint32_t(categories.size())}).first->second;
+    }
+    size_t tableLimit = static_cast<size_t>(history.tableLimit());
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
 
-            if (itemIt == menu.end()) {
-                std::cout << "Item not found or unavailable." << std::endl;
-                continue;
+    // Best of several runs; returns milliseconds and the revenue, to check the runs agree
+    auto timeQuery = [&](int from, int to, const std::string& by, unsigned threads, int64_t& revenue) {
+        double best = 1e18;
+        for (int run = 0; run < 5; run++) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<SalesHistory::Total> totals;
+            if (by == "item") {
+                totals = history.aggregate(from, to, menu.size(),
+                    [](const SalesHistory::Block& block, size_t row, int) { return size_t(block.items[row]); }, threads);
+            } else if (by == "category") {
+                totals = history.aggregate(from, to, categories.size(),
+                    [&categoryOf](const SalesHistory::Block& block, size_t row, int) {
+                        return size_t(categoryOf[block.items[row]]);
+                    }, threads);
+            } else if (by == "hour") {
+                totals = history.aggregate(from, to, 24,
+                    [](const SalesHistory::Block& block, size_t row, int) { return size_t(block.hours[row]); }, threads);
+            } else if (by == "weekday") {
+                totals = history.aggregate(from, to, 7,
+                    [](const SalesHistory::Block&, size_t, int day) { return size_t((day + 3) % 7); }, threads);
+            } else {
+                totals = history.aggregate(from, to, tableLimit,
+                    [](const SalesHistory::Block& block, size_t row, int) { return size_t(block.tables[row]); }, threads);
             }
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+            revenue = 0;
+            for (const auto& total : totals) revenue += total.revenueCents;
+        }
+        return best;
+    };
 
-            std::cout << "Quantity: ";
-            std::cin >> quantity;
+    std::cout << "\n=== Sales History Benchmark ===" << std::endl;
+    std::cout << "Days: " << days << " | Rows: " << history.rows() << " | Column bytes: " << std::fixed
+              << std::setprecision(1) << history.bytes() / (1024.0 * 1024.0) << " MB | Seed: " << seed << std::endl;
+    std::cout << std::left << std::setw(24) << "Query" << std::right << std::setw(14) << "1 thread (ms)"
+              << std::setw(16) << (std::to_string(hardwareThreads) + " threads (ms)") << std::setw(10) << "Speedup"
+              << std::endl;
+    const int lastDay = firstDay + days - 1;
+    for (int from : {firstDay, std::max(firstDay, lastDay - 29)}) {
+        for (const char* by : {"item", "category", "hour", "weekday", "table"}) {
+            int64_t serialRevenue = 0, parallelRevenue = 0;
+            double serial = timeQuery(from, lastDay, by, 1, serialRevenue);
+            double parallel = timeQuery(from, lastDay, by, hardwareThreads, parallelRevenue);
+            if (serialRevenue != parallelRevenue) std::cout << "Result mismatch for " << by << "!" << std::endl;
+            std::string label = std::string(by) + (from == firstDay ? ", all days" : ", last 30");
+            std::cout << std::left << std::setw(24) << label << std::right << std::setprecision(2) << std::setw(14)
+                      << serial << std::setw(16) << parallel << std::setw(9) << serial / parallel << "x" << std::endl;
+        }
+    }
+}
+
+// An hour of service at 50,000 orders an hour, placed as fast as the terminals can.
+// Every order comes off the ingredient stock, and three ingredients are stocked short,
+// so they run out part-way and 86 the items that use them. Then the stock kernel
+// alone: orders taken off one at a time against the same orders in batches.
+void runInventoryBenchmark(int orderCount, unsigned seed) {
+    const int tablesPerTerminal = 8;
+    const int terminals = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    Restaurant restaurant("Benchmark");
+    WorkloadGenerator generator(seed);
+    generator.buildMenu(restaurant, 600);
+    for (int t = 0; t < terminals * tablesPerTerminal; t++) {
+        restaurant.addTable(std::make_shared<Table>(100 + t, 8, "Main Hall"));
+    }
+    const MenuCatalog& menu = restaurant.getMenu();
+    const Inventory& inventory = restaurant.getInventory();
 
-            order->addItem(itemId, quantity, (*itemIt)->getPrice());
-            std::cout << "Added " << quantity << " x " << (*itemIt)->getName() << std::endl;
+    std::vector<std::vector<OrderRequestLine>> parties;
+    std::vector<std::vector<Inventory::Portion>> portions;
+    std::vector<int64_t> demand(inventory.size(), 0);
+    for (int i = 0; i < orderCount; i++) {
+        parties.push_back(generator.pickOrderLines(generator.pickPartySize()));
+        portions.emplace_back();
+        for (const auto& line : parties.back()) {
+            uint32_t item = menu.find(line.itemId);
+            portions.back().push_back({item, line.quantity});
+            for (const auto& component : inventory.recipe(item)) {
+                demand[component.ingredient] += static_cast<int64_t>(component.amount) * line.quantity;
+            }
         }
+    }
 
-        std::cin.ignore();
-        std::string instructions;
-        std::cout << "Special Instructions: ";
-        std::getline(std::cin, instructions);
-        if (!instructions.empty()) {
-            order->addSpecialInstructions(instructions);
+    // Three-quarters of the hour's demand of three ingredients, and plenty of the rest
+    std::string error;
+    std::vector<int64_t> initial(inventory.size());
+    std::vector<uint32_t> shortStocked;
+    for (uint32_t ingredient = 0; ingredient < inventory.size(); ingredient++) {
+        if (demand[ingredient] > 0) shortStocked.push_back(ingredient);
+    }
+    std::shuffle(shortStocked.begin(), shortStocked.end(), std::mt19937(seed));
+    shortStocked.resize(std::min<size_t>(3, shortStocked.size()));
+    for (uint32_t ingredient = 0; ingredient < inventory.size(); ingredient++) {
+        bool isShort = std::find(shortStocked.begin(), shortStocked.end(), ingredient) != shortStocked.end();
+        initial[ingredient] = isShort ? demand[ingredient] * 3 / 4 : demand[ingredient] * 2 + 1;
+        restaurant.adjustStock(std::string(inventory.name(ingredient)), initial[ingredient], false, error);
+    }
+
+    std::vector<std::vector<double>> latencies(terminals);
+    std::vector<std::vector<int>> accepted(terminals);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int terminal = 0; terminal < terminals; terminal++) {
+        threads.emplace_back([&, terminal] {
+            while (!go) std::this_thread::yield();
+            std::string error;
+            for (int i = terminal; i < orderCount; i += terminals) {
+                int tableNumber = 100 + terminal * tablesPerTerminal + (i / terminals) % tablesPerTerminal;
+                restaurant.seatTable(tableNumber, error);
+                auto start = std::chrono::steady_clock::now();
+                auto order = restaurant.placeOrder(tableNumber, 2, parties[i], "", error);
+                latencies[terminal].push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start).count());
+                if (!order) continue;
+                accepted[terminal].push_back(i);
+                restaurant.setOrderStatus(order->getOrderId(), OrderStatus::Paid, error);
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    NullBuffer nullBuffer;
+    std::ostream sink(&nullBuffer);
+    restaurant.displayInventory(sink); // takes off whatever is still queued
+
+    // What is left must be exactly the opening stock less what the accepted orders used
+    std::vector<int64_t> expected = initial;
+    size_t acceptedCount = 0;
+    for (const auto& orders : accepted) {
+        acceptedCount += orders.size();
+        for (int i : orders) {
+            for (const auto& portion : portions[i]) {
+                for (const auto& component : inventory.recipe(portion.item)) {
+                    expected[component.ingredient] -= static_cast<int64_t>(component.amount) * portion.quantity;
+                }
+            }
         }
+    }
+    bool consistent = true;
+    int64_t oversold = 0; // units sold past zero: orders accepted before their batch was taken off
+    int itemsOut = 0;
+    for (uint32_t ingredient = 0; ingredient < inventory.size(); ingredient++) {
+        consistent = consistent && inventory.onHand(ingredient) == expected[ingredient];
+        oversold += std::max<int64_t>(0, -inventory.onHand(ingredient));
+    }
+    for (uint32_t item = 0; item < menu.size(); item++) itemsOut += inventory.isShort(item);
 
-        orders.push_back(order);
-        std::cout << "Order created successfully! Order ID: " << orderId << std::endl;
-        std::cout << "Total Amount: $" << order->getTotalAmount() << std::endl;
+    std::map<std::string, std::vector<double>> table;
+    for (auto& samples : latencies) {
+        table["order"].insert(table["order"].end(), samples.begin(), samples.end());
     }
 
-    void updateOrderStatus() {
-        std::string orderId;
-        std::cout << "Enter Order ID: ";
-        std::cin >> orderId;
+    // The kernel on its own: a fresh inventory with the same recipes and ample stock
+    Inventory kernel;
+    std::vector<Inventory::Change> changes;
+    for (uint32_t ingredient = 0; ingredient < inventory.size(); ingredient++) {
+        kernel.ingredient(inventory.name(ingredient));
+        kernel.setStock(ingredient, INT64_MAX / 2, changes);
+    }
+    for (uint32_t item = 0; item < menu.size(); item++) kernel.setRecipe(item, inventory.recipe(item), changes);
+    auto timeKernel = [&](size_t batchSize) {
+        std::vector<Inventory::Portion> batch;
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < portions.size(); i++) {
+            batch.insert(batch.end(), portions[i].begin(), portions[i].end());
+            if ((i + 1) % batchSize == 0 || i + 1 == portions.size()) {
+                kernel.consume(batch, changes);
+                batch.clear();
+            }
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() /
+               portions.size();
+    };
+    double single = timeKernel(1), batched = timeKernel(32);
+
+    std::cout << "\n=== Inventory Benchmark ===" << std::endl;
+    std::cout << "Orders: " << orderCount << " | Terminals: " << terminals << " | Menu: " << menu.size()
+              << " items, " << inventory.size() << " ingredients (3 stocked short) | Seed: " << seed << std::endl;
+    std::cout << "Accepted: " << acceptedCount << " | Rejected (86'd): " << orderCount - acceptedCount
+              << " | Items 86'd at the end: " << itemsOut << std::endl;
+    std::cout << "Stock batches: " << inventory.batchCount() << " (" << std::fixed << std::setprecision(2)
+              << static_cast<double>(acceptedCount) / std::max<uint64_t>(1, inventory.batchCount())
+              << " orders each) | Units oversold: " << oversold << std::endl;
+    std::cout << "Orders/sec: " << std::setprecision(0) << orderCount / seconds << " ("
+              << orderCount / seconds * 3600 / 50000 << "x a 50,000 orders/hour rush)" << std::endl;
+    printLatencyTable(table, "Operation");
+    std::cout << "Stock kernel per order: " << std::setprecision(0) << single << " ns one at a time, " << batched
+              << " ns in batches of 32" << std::endl;
+    std::cout << "Stock check: " << (consistent ? "ok" : "MISMATCH") << std::endl;
+}
+
+// Runs six hours of a full dining room against the waitlist alone, a simulated minute
+// at a time. Parties arrive faster than tables turn, so the queue grows long; each
+// table is given to the party the waitlist matched to it, orders, gets its food and
+// pays a while later. Reports the cost of each event and of re-matching the
+// queue, and how far the predicted turns were from the real ones.
+void runWaitlistBenchmark(int tableCount, unsigned seed) {
+    WorkloadGenerator generator(seed);
+    Waitlist waitlist;
+    ReservationBook book;
+    static const int capacities[] = {2, 2, 2, 4, 4, 4, 4, 6, 6, 8};
+    static const char* locations[] = {"Main Hall", "Window", "Patio", "Bar", "Private Room"};
+    struct Seating {
+        bool occupied = false;
+        int64_t orderAt = 0, foodAt = 0, paidAt = 0;
+        int64_t predictedSeated = 0, predictedEating = 0;
+    };
+    std::vector<Seating> seatings(tableCount);
+    for (int i = 0; i < tableCount; i++) {
+        int capacity = capacities[generator.between(0, 9)];
+        waitlist.addTable(100 + i, capacity, locations[generator.between(0, 4)]);
+        book.addTable(100 + i, capacity);
+    }
+
+    std::map<std::string, std::vector<double>> latencies;
+    auto timed = [&latencies](const char* name, auto operation) {
+        auto start = std::chrono::steady_clock::now();
+        operation();
+        latencies[name].push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+    };
+    const int64_t opening = (20000 + 17) * 1440, closing = opening + 6 * 60;
+    std::poisson_distribution<int> arrivals(tableCount / 50.0);
+    std::mt19937 rng(seed);
+    double seatedError = 0, eatingError = 0;
+    size_t turns = 0, arrived = 0, longestQueue = 0, seatedCount = 0;
+    for (int64_t now = opening; now < closing; now++) {
+        for (int k = arrivals(rng); k > 0; k--, arrived++) {
+            timed("join", [&] { waitlist.join(generator.pickName(), "", generator.pickPartySize(), now); });
+        }
+        for (int i = 0; i < tableCount; i++) {
+            Seating& seating = seatings[i];
+            if (!seating.occupied) continue;
+            std::string orderId = "ORD" + std::to_string(100 + i);
+            if (now == seating.orderAt) {
+                timed("order", [&] { waitlist.ordered(100 + i, orderId, 0, now + generator.between(10, 25)); });
+            } else if (now == seating.foodAt) {
+                timed("food up", [&] { waitlist.leftKitchen(orderId, now, true); });
+                seating.predictedEating = waitlist.freeAt(100 + i);
+            } else if (now == seating.paidAt) {
+                timed("paid", [&] { waitlist.paid(100 + i, now); });
+                seating.occupied = false;
+                if (now >= opening + 60) {
+                    seatedError += std::abs(static_cast<double>(seating.predictedSeated - now));
+                    eatingError += std::abs(static_cast<double>(seating.predictedEating - now));
+                    turns++;
+                }
+            }
+        }
 
-        auto orderIt = std::find_if(orders.begin(), orders.end(),
-            [&orderId](const std::shared_ptr<Order>& o) {
-                return o->getOrderId() == orderId;
+        longestQueue = std::max(longestQueue, waitlist.waiting());
+        timed("match", [&] { waitlist.match(now, book); });
+        std::vector<Waitlist::Party> ready;
+        for (const auto& party : waitlist.parties()) {
+            if (party.table >= 0 && !seatings[party.table - 100].occupied) ready.push_back(party);
+        }
+        for (const auto& party : ready) {
+            Seating& seating = seatings[party.table - 100];
+            timed("seat", [&] {
+                waitlist.seat(party.table, party.size, now);
+                waitlist.leave(party.id);
             });
+            // Guests stay a while after the food comes up, longer in bigger parties
+            seating.occupied = true;
+            seating.orderAt = now + generator.between(3, 10);
+            seating.foodAt = seating.orderAt + generator.between(10, 30);
+            seating.paidAt = seating.foodAt + generator.between(20, 35) + party.size * generator.between(2, 5);
+            seating.predictedSeated = waitlist.freeAt(party.table);
+            seatedCount++;
+        }
+    }
 
-        if (orderIt != orders.end()) {
-            std::cout << "Current status: " << (*orderIt)->getStatus() << std::endl;
-            std::cout << "New status (pending/cooking/ready/served/paid): ";
-            std::string newStatus;
-            std::cin >> newStatus;
-            (*orderIt)->updateStatus(newStatus);
-            
-            if (newStatus == "paid") {
-                // Free the table
-                auto tableIt = std::find_if(tables.begin(), tables.end(),
-                    [orderIt](const std::shared_ptr<Table>& t) {
-                        return t->getTableNumber() == (*orderIt)->getTableNumber();
-                    });
-                if (tableIt != tables.end()) {
-                    (*tableIt)->freeTable();
+    std::cout << "\n=== Waitlist Benchmark ===" << std::endl;
+    std::cout << "Tables: " << tableCount << " | Service: 6 hours | Seed: " << seed << std::endl;
+    std::cout << "Parties: " << arrived << " arrived, " << seatedCount << " seated, " << waitlist.waiting()
+              << " still waiting | Longest queue: " << longestQueue << std::endl;
+    printLatencyTable(latencies, "Event");
+    std::cout << "Turn prediction error after the first hour (" << turns << " turns): " << std::fixed
+              << std::setprecision(1) << seatedError / std::max<size_t>(1, turns) << " min when seated, "
+              << eatingError / std::max<size_t>(1, turns) << " min once the food is up" << std::endl;
+}
+
+// Publishes `events` order events into a private change feed, alone and then with a
+// reader thread following it, then times the hop to another process: a forked reader
+// tails a shared-memory feed while this process publishes an event every 100 us. Ends
+// with a reader that falls behind a small ring and must resume past the overrun.
+void runFeedBenchmark(int events) {
+    auto makeEvent = [](int i) {
+        ChangeFeed::Event event;
+        event.kind = ChangeFeed::Kind::OrderStatus;
+        event.status = static_cast<OrderStatus>(i % 5);
+        event.table = 100 + i % 997;
+        event.number = static_cast<uint32_t>(1001 + i);
+        event.cents = static_cast<int64_t>(i) * 3;
+        return event;
+    };
+    // Every field must come from the same publish, or the seqlock let a torn read through
+    auto whole = [](const ChangeFeed::Event& event) {
+        int i = static_cast<int>(event.number) - 1001;
+        return event.sequence == static_cast<uint64_t>(i) + 1 && event.table == 100 + i % 997 &&
+               event.cents == static_cast<int64_t>(i) * 3 && event.status == static_cast<OrderStatus>(i % 5);
+    };
+    auto microsNow = [] {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    };
+
+    std::cout << "\n=== Change Feed Benchmark ===" << std::endl;
+    for (bool withReader : {false, true}) {
+        auto feed = ChangeFeed::create();
+        std::atomic<bool> done(false);
+        uint64_t read = 0, overruns = 0, torn = 0;
+        std::thread reader;
+        if (withReader) {
+            reader = std::thread([&] {
+                ChangeFeed::Event event;
+                uint64_t next = 1;
+                while (!done || next <= feed->head()) {
+                    switch (feed->read(next, event)) {
+                        case ChangeFeed::Read::Ok:
+                            if (!whole(event)) torn++;
+                            read++;
+                            next++;
+                            break;
+                        case ChangeFeed::Read::Overrun:
+                            overruns++;
+                            next = std::max(next + 1, feed->oldest());
+                            break;
+                        case ChangeFeed::Read::NotYet:
+                            feed->wait(next, std::chrono::milliseconds(10));
+                            break;
+                    }
                 }
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < events; i++) feed->publish(makeEvent(i));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done = true;
+        if (reader.joinable()) reader.join();
+        std::cout << "Publish " << (withReader ? "with a reader: " : "alone:         ") << std::fixed
+                  << std::setprecision(1) << seconds * 1e9 / events << " ns/event";
+        if (withReader) std::cout << " | read " << read << ", " << overruns << " overruns, " << torn << " torn";
+        std::cout << std::endl;
+    }
+
+    // Another process tails a shared feed; it reports its latencies back through a pipe
+    const int tailed = std::min(events, 20000);
+    std::string error;
+    std::string name = "/rms-feed-bench-" + std::to_string(::getpid());
+    auto shared = ChangeFeed::create(name, error);
+    int ready[2], results[2];
+    if (!shared || ::pipe(ready) != 0 || ::pipe(results) != 0) {
+        std::cerr << "Could not set up the shared feed: " << error << std::endl;
+        return;
+    }
+    std::cout.flush();
+    pid_t child = ::fork();
+    if (child == 0) {
+        auto feed = ChangeFeed::attach(name, error);
+        char attached = feed ? 1 : 0;
+        if (::write(ready[1], &attached, 1) != 1 || !feed) ::_exit(1);
+        std::vector<double> latencies;
+        ChangeFeed::Event event;
+        for (uint64_t next = 1; static_cast<int>(latencies.size()) < tailed;) {
+            ChangeFeed::Read result = feed->read(next, event);
+            if (result == ChangeFeed::Read::Ok) {
+                latencies.push_back(static_cast<double>(microsNow() - event.at));
+                next++;
+            } else if (result == ChangeFeed::Read::Overrun) {
+                next = std::max(next + 1, feed->oldest());
+            } else {
+                feed->wait(next, std::chrono::milliseconds(100));
             }
-            
-            std::cout << "Order status updated!" << std::endl;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::string line = std::to_string(percentile(latencies, 0.50)) + " " + std::to_string(percentile(latencies, 0.99)) +
+                           " " + std::to_string(latencies.back()) + "\n";
+        ssize_t written = ::write(results[1], line.data(), line.size());
+        ::_exit(written == static_cast<ssize_t>(line.size()) ? 0 : 1);
+    }
+    char attached = 0;
+    if (child < 0 || ::read(ready[0], &attached, 1) != 1 || attached != 1) {
+        std::cerr << "The reader process could not attach to " << name << std::endl;
+    } else {
+        for (int i = 0; i < tailed; i++) {
+            shared->publish(makeEvent(i));
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        char text[128] = {};
+        ssize_t got = ::read(results[0], text, sizeof(text) - 1);
+        double p50 = 0, p99 = 0, worst = 0;
+        if (got > 0 && std::sscanf(text, "%lf %lf %lf", &p50, &p99, &worst) == 3) {
+            std::cout << "Another process tailing (" << tailed << " events, one per 100 us): p50 " << std::fixed
+                      << std::setprecision(1) << p50 << " us, p99 " << p99 << " us, max " << worst << " us"
+                      << std::endl;
         } else {
-            std::cout << "Order not found!" << std::endl;
+            std::cerr << "The reader process reported nothing" << std::endl;
         }
     }
+    if (child > 0) ::waitpid(child, nullptr, 0);
+    for (int fd : {ready[0], ready[1], results[0], results[1]}) ::close(fd);
+    ::shm_unlink(name.c_str());
 
-    void displayActiveOrders() {
-        std::cout << "\n=== Active Orders ===" << std::endl;
-        bool found = false;
-        for (const auto& order : orders) {
-            if (order->getStatus() != "paid") {
-                order->displayInfo();
-                found = true;
+    // A reader that stops for a while on a 1024-event ring
+    auto small = ChangeFeed::create(1024);
+    for (int i = 0; i < 5000; i++) small->publish(makeEvent(i));
+    ChangeFeed::Event event;
+    uint64_t next = 1, caughtUp = 0;
+    bool overrun = small->read(next, event) == ChangeFeed::Read::Overrun;
+    if (overrun) next = small->oldest();
+    uint64_t resumedAt = next;
+    while (small->read(next, event) == ChangeFeed::Read::Ok && whole(event)) {
+        next++;
+        caughtUp++;
+    }
+    std::cout << "Slow reader on a " << small->capacity() << "-event ring: " << (overrun ? "overrun" : "NO OVERRUN")
+              << " at 1, resumed at " << resumedAt << ", read " << caughtUp << " events to the head ("
+              << small->head() << ")" << std::endl;
+}
+
+// Writes a menu of `menuItems` items (the generated one with new prices, plus a tenth
+// more) as CSV and as JSON Lines, then imports each into a running restaurant while a
+// terminal keeps looking up orders, and reports the import rate and the longest lookup
+void runImportBenchmark(int menuItems, unsigned seed) {
+    Restaurant restaurant("Benchmark");
+    WorkloadGenerator generator(seed);
+    generator.buildMenu(restaurant, menuItems);
+    generator.buildFloorPlan(restaurant, 20);
+    std::string error;
+    std::vector<std::string> orderIds;
+    for (int t = 0; t < 20; t++) {
+        restaurant.seatTable(100 + t, error);
+        auto order = restaurant.placeOrder(100 + t, 2, generator.pickOrderLines(2), "", error);
+        if (order) orderIds.push_back(order->getOrderId());
+    }
+
+    const MenuCatalog& catalog = restaurant.getMenu();
+    std::string base = "/tmp/rms-import-" + std::to_string(::getpid());
+    std::string csvPath = base + ".csv", jsonPath = base + ".jsonl";
+    {
+        std::ofstream csv(csvPath), json(jsonPath);
+        csv << "id,name,category,price,minutes,description,spice,calories,ingredients,allergens\n";
+        auto listed = [&catalog](auto symbols, const char* separator) {
+            std::string text;
+            for (uint32_t symbol : symbols) {
+                text += (text.empty() ? "" : separator) + std::string(catalog.symbolName(symbol));
             }
-        }
-        if (!found) {
-            std::cout << "No active orders." << std::endl;
+            return text;
+        };
+        uint32_t total = catalog.size() + catalog.size() / 10;
+        for (uint32_t i = 0; i < total; i++) {
+            uint32_t from = i % catalog.size();
+            std::string id = i < catalog.size() ? std::string(catalog.itemId(from)) : "NEW" + std::to_string(i);
+            std::string price = formatMoney(catalog.priceCents(from) + 50);
+            csv << id << ',' << catalog.name(from) << ',' << catalog.category(from) << ',' << price << ','
+                << catalog.preparationTime(from) << ",\"" << catalog.description(from) << ", made to order\","
+                << catalog.spiceLevel(from) << ',' << catalog.calories(from) << ','
+                << listed(catalog.ingredients(from), ";") << ',' << listed(catalog.allergens(from), ";") << '\n';
+            json << "{\"id\":\"" << id << "\",\"name\":\"" << catalog.name(from) << "\",\"category\":\""
+                 << catalog.category(from) << "\",\"price\":" << price << ",\"minutes\":"
+                 << catalog.preparationTime(from) << ",\"description\":\"" << catalog.description(from)
+                 << "\",\"spice\":" << catalog.spiceLevel(from) << ",\"calories\":" << catalog.calories(from)
+                 << ",\"ingredients\":[\"" << listed(catalog.ingredients(from), "\",\"") << "\"],\"allergens\":[\""
+                 << listed(catalog.allergens(from), "\",\"") << "\"]}\n";
         }
     }
 
-    void displayTodayReservations() {
-        std::string today = getCurrentDate();
-        std::cout << "\n=== Reservations for " << today << " ===" << std::endl;
-        bool found = false;
-        for (const auto& reservation : reservations) {
-            if (reservation->getReservationDate() == today) {
-                reservation->displayInfo();
-                found = true;
+    std::cout << "\n=== Import Benchmark ===" << std::endl;
+    std::cout << "Menu items: " << menuItems << " (+" << menuItems / 10 << " new) | Seed: " << seed << std::endl;
+    for (const std::string& path : {csvPath, jsonPath}) {
+        std::atomic<bool> done(false);
+        double longestLookup = 0;
+        size_t lookups = 0;
+        std::thread terminal([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                auto start = std::chrono::steady_clock::now();
+                restaurant.findOrder(orderIds[lookups++ % orderIds.size()]);
+                longestLookup = std::max(longestLookup, std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start).count());
             }
+        });
+        Restaurant::ImportResult result;
+        struct stat info {};
+        ::stat(path.c_str(), &info);
+        auto start = std::chrono::steady_clock::now();
+        bool imported = restaurant.importMenu(path, result, error);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done = true;
+        terminal.join();
+        std::cout << std::left << std::setw(7) << (path == csvPath ? "CSV" : "JSONL") << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(8) << info.st_size / 1048576.0 << " MB"
+                  << std::setprecision(0) << std::setw(11) << result.records / seconds << " records/sec"
+                  << std::setprecision(1) << std::setw(8) << info.st_size / 1048576.0 / seconds << " MB/sec"
+                  << " | " << result.added << " added, " << result.updated << " updated"
+                  << " | longest lookup " << std::setprecision(0) << longestLookup << " us over " << lookups
+                  << (imported ? "" : " | FAILED: " + error) << std::endl;
+    }
+    ::unlink(csvPath.c_str());
+    ::unlink(jsonPath.c_str());
+}
+
+// Compares the old linear find_if order lookup against the hash index
+void runIndexBenchmark() {
+    const std::vector<int> orderCounts = {10000, 100000, 1000000};
+    const int hashedLookups = 1000000;
+    const int linearLookups = 100;
+
+    std::cout << "\n=== Order Lookup Benchmark ===" << std::endl;
+    std::cout << std::left << std::setw(10) << "Orders" << std::right
+              << std::setw(18) << "find_if (ns/op)" << std::setw(18) << "index (ns/op)"
+              << std::setw(12) << "Speedup" << std::endl;
+
+    int day = 0;
+    parseDate("2026-10-17", day);
+    for (int count : orderCounts) {
+        Restaurant restaurant("Benchmark");
+        for (int i = 0; i < count; i++) {
+            auto order = restaurant.makeOrder("ORD" + std::to_string(1001 + i), 1 + i % 5, day, 12 * 60, 2, 0);
+            order->addItem(restaurant.internMenuItem("MAIN001"), 1, 2999);
+            restaurant.addOrder(order);
         }
-        if (!found) {
-            std::cout << "No reservations for today." << std::endl;
+        const auto& orders = restaurant.getOrders();
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> pick(0, count - 1);
+        std::vector<std::string> keys;
+        keys.reserve(hashedLookups);
+        for (int i = 0; i < hashedLookups; i++) {
+            keys.push_back("ORD" + std::to_string(1001 + pick(rng)));
+        }
+
+        size_t hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < linearLookups; i++) {
+            const std::string& orderId = keys[i];
+            auto it = std::find_if(orders.begin(), orders.end(),
+                [&orderId](const std::shared_ptr<Order>& o) {
+                    return o->getOrderId() == orderId;
+                });
+            hits += (it != orders.end());
+        }
+        double linearNs = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / linearLookups;
+
+        start = std::chrono::steady_clock::now();
+        for (const auto& orderId : keys) {
+            hits += (restaurant.findOrder(orderId) != nullptr);
         }
+        double hashedNs = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / hashedLookups;
+
+        if (hits != static_cast<size_t>(linearLookups + hashedLookups)) {
+            std::cout << "Lookup mismatch!" << std::endl;
+        }
+        std::cout << std::left << std::setw(10) << count << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(18) << linearNs << std::setw(18) << hashedNs
+                  << std::setw(11) << linearNs / hashedNs << "x" << std::endl;
     }
+}
 
-    void generateDailyReport() {
-        std::string today = getCurrentDate();
-        double totalRevenue = 0.0;
-        int ordersCompleted = 0;
-        int customersServed = 0;
+int main(int argc, char* argv[]) {
+    std::string dataDirectory = ".";
+    std::string batchFile;
+    bool journaling = true;
+    bool benchmark = false;
+    bool benchKitchen = false;
+    bool benchOrders = false;
+    bool benchFilter = false;
+    bool benchSales = false;
+    bool benchInventory = false;
+    bool benchImport = false;
+    bool benchWaitlist = false;
+    bool benchFeed = false;
+    int salesDays = 365;
+    bool ordersGiven = false;
+    bool menuItemsGiven = false;
+    bool tablesGiven = false;
+    bool stress = false;
+    int servePort = 0;
+    int locationCount = 1;
+    std::string metricsFile;
+    std::string feedName;
+    std::string tailName;
+    uint64_t tailFrom = 0;
+    int metricsInterval = 10;
+    int serverThreads = 4;
+    bool loadgen = false;
+    LoadConfig load;
+    int stressParties = 20000;
+    int kitchenTickets = 500;
+    WorkloadConfig workload;
 
-        for (const auto& order : orders) {
-            if (order->getStatus() == "paid") {
-                totalRevenue += order->getTotalAmount();
-                ordersCompleted++;
-                // Estimate customers from order (simplified)
-                customersServed += order->getItems().size();
-            }
-        }
-
-        std::cout << "\n=== Daily Report - " << today << " ===" << std::endl;
-        std::cout << "Total Revenue: $" << std::fixed << std::setprecision(2) << totalRevenue << std::endl;
-        std::cout << "Orders Completed: " << ordersCompleted << std::endl;
-        std::cout << "Estimated Customers Served: " << customersServed << std::endl;
-        std::cout << "Average Order Value: $" << (ordersCompleted > 0 ? totalRevenue / ordersCompleted : 0) << std::endl;
-    }
-
-    void displayMenu() {
-        std::cout << "\n=== " << restaurantName << " Management System ===" << std::endl;
-        std::cout << "1. Display Menu" << std::endl;
-        std::cout << "2. Display Available Tables" << std::endl;
-        std::cout << "3. Make Reservation" << std::endl;
-        std::cout << "4. Create Order" << std::endl;
-        std::cout << "5. Update Order Status" << std::endl;
-        std::cout << "6. Display Active Orders" << std::endl;
-        std::cout << "7. Display Today's Reservations" << std::endl;
-        std::cout << "8. Generate Daily Report" << std::endl;
-        std::cout << "0. Exit" << std::endl;
-        std::cout << "Enter your choice: ";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench-index") {
+            runIndexBenchmark();
+            return 0;
+        } else if (arg == "--bench-kitchen") {
+            benchKitchen = true;
+        } else if (arg == "--bench-orders") {
+            benchOrders = true;
+        } else if (arg == "--bench-filter") {
+            benchFilter = true;
+        } else if (arg == "--bench-sales") {
+            benchSales = true;
+        } else if (arg == "--bench-inventory") {
+            benchInventory = true;
+        } else if (arg == "--bench-import") {
+            benchImport = true;
+        } else if (arg == "--bench-waitlist") {
+            benchWaitlist = true;
+        } else if (arg == "--bench-feed") {
+            benchFeed = true;
+        } else if (arg == "--days" && i + 1 < argc) {
+            salesDays = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePort = std::atoi(argv[++i]);
+        } else if (arg == "--locations" && i + 1 < argc) {
+            locationCount = std::atoi(argv[++i]);
+            if (locationCount < 1 || locationCount > Restaurant::kMaxLocation) {
+                std::cerr << "--locations takes 1 to " << Restaurant::kMaxLocation << std::endl;
+                return 1;
+            }
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (arg == "--feed" && i + 1 < argc) {
+            feedName = argv[++i];
+        } else if (arg == "--tail" && i + 1 < argc) {
+            tailName = argv[++i];
+        } else if (arg == "--from" && i + 1 < argc) {
+            tailFrom = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            serverThreads = std::atoi(argv[++i]);
+        } else if (arg == "--loadgen" && i + 1 < argc) {
+            // HOST:PORT or just PORT on this machine
+            loadgen = true;
+            std::string target = argv[++i];
+            size_t colon = target.rfind(':');
+            if (colon != std::string::npos) load.host = target.substr(0, colon);
+            load.port = std::atoi(target.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+        } else if (arg == "--connections" && i + 1 < argc) {
+            load.connections = std::atoi(argv[++i]);
+        } else if (arg == "--requests" && i + 1 < argc) {
+            load.requestsPerConnection = std::atoi(argv[++i]);
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            load.pipelineDepth = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--stress") {
+            stress = true;
+        } else if (arg == "--parties" && i + 1 < argc) {
+            stressParties = std::atoi(argv[++i]);
+        } else if (arg == "--data-dir" && i + 1 < argc) {
+            dataDirectory = argv[++i];
+        } else if (arg == "--no-journal") {
+            journaling = false;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (arg == "--bench") {
+            benchmark = true;
+        } else if (arg == "--menu-items" && i + 1 < argc) {
+            workload.menuItems = std::atoi(argv[++i]);
+            menuItemsGiven = true;
+        } else if (arg == "--tables" && i + 1 < argc) {
+            workload.tables = std::atoi(argv[++i]);
+            tablesGiven = true;
+        } else if (arg == "--orders" && i + 1 < argc) {
+            workload.orders = std::atoi(argv[++i]);
+            ordersGiven = true;
+        } else if (arg == "--reservations" && i + 1 < argc) {
+            workload.reservations = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            workload.seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--tickets" && i + 1 < argc) {
+            kitchenTickets = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (benchmark) {
+        runWorkloadBenchmark(workload);
+        return 0;
+    }
+    if (loadgen) {
+        load.seed = workload.seed;
+        return runLoadGenerator(load);
+    }
+    if (stress) {
+        runStressTest(stressParties, workload.seed);
+        return 0;
+    }
+    if (benchKitchen) {
+        runKitchenBenchmark(kitchenTickets, workload.seed);
+        return 0;
+    }
+    if (benchFilter) {
+        runFilterBenchmark(menuItemsGiven ? workload.menuItems : 10000, workload.seed);
+        return 0;
+    }
+    if (benchSales) {
+        runSalesBenchmark(salesDays, workload.seed);
+        return 0;
+    }
+    if (benchInventory) {
+        runInventoryBenchmark(ordersGiven ? workload.orders : 50000, workload.seed);
+        return 0;
+    }
+    if (benchWaitlist) {
+        runWaitlistBenchmark(tablesGiven ? workload.tables : 300, workload.seed);
+        return 0;
+    }
+    if (benchFeed) {
+        runFeedBenchmark(ordersGiven ? workload.orders : 1000000);
+        return 0;
+    }
+    if (!tailName.empty()) {
+        return runFeedTail(tailName, tailFrom);
+    }
+    if (benchImport) {
+        runImportBenchmark(menuItemsGiven ? workload.menuItems : 10000, workload.seed);
+        return 0;
+    }
+    if (benchOrders) {
+        runOrderMemoryBenchmark(ordersGiven ? workload.orders : 100000, workload.seed);
+        return 0;
+    }
+
+    // Each screen reaches stdout as one write (see ScreenWriter), so let stdout hold a
+    // whole screen instead of passing it on line by line to a terminal
+    std::setvbuf(stdout, nullptr, _IOFBF, 1 << 16);
+
+    if (locationCount > 1 && servePort == 0 && batchFile.empty()) {
+        std::cerr << "Several locations need --batch or --serve." << std::endl;
+        return 1;
+    }
+    LocationGroup locations("Bella Cucina", locationCount);
+    if (journaling && !locations.openJournals(dataDirectory)) {
+        std::cerr << "Could not open the journal in " << dataDirectory << "; exiting." << std::endl;
+        return 1;
+    }
+    if (!feedName.empty() && !locations.openFeeds(feedName)) return 1;
+    locations.start();
+    MetricsExporter metrics(locations, metricsFile, metricsInterval);
+    if (!metricsFile.empty()) metrics.start();
+
+    if (servePort > 0) {
+        PosServer server(locations, servePort, serverThreads);
+        return server.run();
     }
-};
 
-int main() {
-    Restaurant restaurant("Bella Cucina");
+    if (!batchFile.empty()) {
+        if (batchFile == "-") {
+            return runBatch(locations, std::cin) == 0 ? 0 : 1;
+        }
+        std::ifstream commands(batchFile);
+        if (!commands) {
+            std::cerr << "Could not open " << batchFile << std::endl;
+            return 1;
+        }
+        return runBatch(locations, commands) == 0 ? 0 : 1;
+    }
+    Restaurant& restaurant = locations.location(0);
     
     int choice;
     do {
-        restaurant.displayMenu();
+        restaurant.displayMainMenu();
         std::cin >> choice;
 
         switch (choice) {
@@ -580,6 +9268,9 @@ int main() {
             case 8:
                 restaurant.generateDailyReport();
                 break;
+            case 9:
+                restaurant.displayKitchenQueue();
+                break;
             case 0:
                 std::cout << "Thank you for using Restaurant Management System!" << std::endl;
                 break;